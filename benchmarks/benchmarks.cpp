@@ -0,0 +1,312 @@
+// CPU热点路径的微基准测试（Google Benchmark）
+// 每个基准测试的输入都是合成数据，参数为输入规模（顶点数、模型数、变换数、光源数、图像边长等），可以观察耗时随规模的变化
+// 用法：TellurionBenchmarks [--benchmark_filter=<正则>] [--benchmark_format=json] [--benchmark_out=<文件>]
+// 不创建OpenGL上下文，只调用不访问OpenGL的函数
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../utils/Model.h"
+#include "../utils/Scene.h"
+#include "../utils/Transform.h"
+#include "../utils/quaternionCamera.h"
+#include "../utils/JobSystem.h"
+#include "../utils/ParallelImage.h"
+#include "../utils/lightmapper.h"
+
+namespace {
+
+/// @brief 生成一个网格状的合成网格：边长为side个顶点，带法线、切线、副切线和纹理坐标，每个格子两个三角形
+/// @param side 每边的顶点数
+/// @param mesh 输出的assimp网格（数组由aiMesh的析构函数释放）
+void makeGridMesh(unsigned int side, aiMesh& mesh) {
+    unsigned int vertexCount = side * side;
+    mesh.mNumVertices = vertexCount;
+    mesh.mVertices = new aiVector3D[vertexCount];
+    mesh.mNormals = new aiVector3D[vertexCount];
+    mesh.mTangents = new aiVector3D[vertexCount];
+    mesh.mBitangents = new aiVector3D[vertexCount];
+    mesh.mTextureCoords[0] = new aiVector3D[vertexCount];
+    for (unsigned int y = 0; y < side; y++) {
+        for (unsigned int x = 0; x < side; x++) {
+            unsigned int i = y * side + x;
+            float u = (float)x / (side - 1);
+            float v = (float)y / (side - 1);
+            mesh.mVertices[i] = aiVector3D{ u * 10.0f, std::sin(u * 6.0f) * std::cos(v * 6.0f), v * 10.0f };
+            mesh.mNormals[i] = aiVector3D{ 0.0f, 1.0f, 0.0f };
+            mesh.mTangents[i] = aiVector3D{ 1.0f, 0.0f, 0.0f };
+            mesh.mBitangents[i] = aiVector3D{ 0.0f, 0.0f, 1.0f };
+            mesh.mTextureCoords[0][i] = aiVector3D{ u, v, 0.0f };
+        }
+    }
+    unsigned int cells = (side - 1) * (side - 1);
+    mesh.mNumFaces = cells * 2;
+    mesh.mFaces = new aiFace[mesh.mNumFaces];
+    unsigned int f = 0;
+    for (unsigned int y = 0; y + 1 < side; y++) {
+        for (unsigned int x = 0; x + 1 < side; x++) {
+            unsigned int i = y * side + x;
+            unsigned int quad[2][3] = { { i, i + side, i + 1 }, { i + 1, i + side, i + side + 1 } };
+            for (int t = 0; t < 2; t++) {
+                aiFace& face = mesh.mFaces[f++];
+                face.mNumIndices = 3;
+                face.mIndices = new unsigned int[3];
+                for (int k = 0; k < 3; k++) {
+                    face.mIndices[k] = quad[t][k];
+                }
+            }
+        }
+    }
+    mesh.mMaterialIndex = 0;
+}
+
+/// @brief 生成一张合成的光照贴图：随机值，约30%的像素为0（模拟没有被任何三角形覆盖的texel）
+std::vector<float> makeLightmapImage(int side, int channels) {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> value(0.0f, 1.0f);
+    std::vector<float> image(side * side * channels);
+    for (int i = 0; i < side * side; i++) {
+        bool empty = value(random) < 0.3f;
+        for (int c = 0; c < channels; c++) {
+            image[i * channels + c] = empty ? 0.0f : value(random);
+        }
+    }
+    return image;
+}
+
+// 光照贴图的通道数（与Scene::bakeLightMap相同）
+const int LIGHTMAP_CHANNELS = 4;
+
+} // namespace
+
+// Model::convertMesh：assimp网格到顶点/索引数组的转换（参数为每边的顶点数）
+static void BM_ConvertMesh(benchmark::State& state) {
+    unsigned int side = (unsigned int)state.range(0);
+    aiMesh mesh;
+    makeGridMesh(side, mesh);
+    for (auto _ : state) {
+        vector<Vertex> vertices;
+        vector<unsigned int> indices;
+        vector<vertex_t> lightVertices;
+        vector<unsigned int> lightIndices;
+        glm::vec3 boundsMin(std::numeric_limits<float>::max());
+        glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+        Model::convertMesh(&mesh, vertices, indices, lightVertices, lightIndices, boundsMin, boundsMax);
+        benchmark::DoNotOptimize(vertices.data());
+        benchmark::DoNotOptimize(indices.data());
+    }
+    state.SetItemsProcessed(state.iterations() * mesh.mNumVertices);
+    state.counters["vertices"] = mesh.mNumVertices;
+}
+BENCHMARK(BM_ConvertMesh)->RangeMultiplier(4)->Range(32, 1024);
+
+// Scene::loadScene：解析场景配置文件（参数为模型数量），控制台输出重定向到空缓冲区，只统计格式化的开销
+static void BM_LoadSceneYaml(benchmark::State& state) {
+    int models = (int)state.range(0);
+    std::filesystem::path fileName = std::filesystem::temp_directory_path() / ("tellurion_bench_scene_" + std::to_string(models) + ".yaml");
+    {
+        std::ofstream out(fileName);
+        out << "models:\n";
+        for (int i = 0; i < models; i++) {
+            out << "  - path: \"./assets/model" << i << ".obj\"\n";
+            out << "    position: { x: " << i << ".0, y: 0.0, z: " << -i << ".5 }\n";
+            out << "    rotation: { x: 0.0, y: " << (i * 7) % 360 << ".0, z: 0.0 }\n";
+            out << "    scale: { x: 1.0, y: 1.0, z: 1.0 }\n";
+            if (i % 4 == 0) {
+                out << "    tilt: 23.433\n    spinSpeed: 10.0\n";
+            }
+        }
+    }
+    std::ostringstream sink;
+    std::streambuf* coutBuffer = std::cout.rdbuf(sink.rdbuf());
+    for (auto _ : state) {
+        auto infos = Scene::loadScene(fileName.string());
+        benchmark::DoNotOptimize(infos.data());
+        // 丢弃已经格式化的输出，避免缓冲区一直增长
+        state.PauseTiming();
+        sink.str("");
+        state.ResumeTiming();
+    }
+    std::cout.rdbuf(coutBuffer);
+    std::filesystem::remove(fileName);
+    state.SetItemsProcessed(state.iterations() * models);
+}
+BENCHMARK(BM_LoadSceneYaml)->RangeMultiplier(4)->Range(4, 1024)->Unit(benchmark::kMicrosecond);
+
+// Transform::update：每帧为带动画的模型重新计算世界矩阵和法线矩阵（参数为模型数量，与renderScene读取的矩阵相同）
+static void BM_TransformUpdateAnimated(benchmark::State& state) {
+    std::vector<Transform> transforms(state.range(0));
+    for (size_t i = 0; i < transforms.size(); i++) {
+        transforms[i].setPosition(glm::vec3((float)i, 0.0f, 0.0f));
+        transforms[i].setTilt(23.433f);
+        transforms[i].setSpinSpeed(10.0f);
+        transforms[i].setScale(glm::vec3(5.0f));
+    }
+    float time = 0.0f;
+    for (auto _ : state) {
+        time += 1.0f / 60.0f;
+        for (auto& transform : transforms) {
+            transform.update(time);
+            benchmark::DoNotOptimize(&transform.getWorldMatrix());
+            benchmark::DoNotOptimize(&transform.getNormalMatrix());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * transforms.size());
+}
+BENCHMARK(BM_TransformUpdateAnimated)->RangeMultiplier(4)->Range(16, 4096);
+
+// Transform::update：位置每帧都改变（脏标记），局部矩阵也需要重建
+static void BM_TransformUpdateDirty(benchmark::State& state) {
+    std::vector<Transform> transforms(state.range(0));
+    for (size_t i = 0; i < transforms.size(); i++) {
+        transforms[i].setRotation(glm::vec3(10.0f, 20.0f, 30.0f));
+        transforms[i].setScale(glm::vec3(2.0f));
+    }
+    float offset = 0.0f;
+    for (auto _ : state) {
+        offset += 0.01f;
+        for (size_t i = 0; i < transforms.size(); i++) {
+            transforms[i].setPosition(glm::vec3((float)i, offset, 0.0f));
+            transforms[i].update(0.0f);
+            benchmark::DoNotOptimize(&transforms[i].getWorldMatrix());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * transforms.size());
+}
+BENCHMARK(BM_TransformUpdateDirty)->RangeMultiplier(4)->Range(16, 4096);
+
+// Camera::ProcessKeyboard：依次处理所有移动方向（参数为每次迭代的调用次数）
+static void BM_CameraProcessKeyboard(benchmark::State& state) {
+    Camera camera(glm::vec3(0.0f, 0.0f, 25.0f));
+    const Camera_Movement movements[] = { FORWARD, BACKWARD, LEFT, RIGHT, UP, DOWN, PITCH_UP, PITCH_DOWN, ROLL_LEFT, ROLL_RIGHT, YAW_LEFT, YAW_RIGHT };
+    int calls = (int)state.range(0);
+    for (auto _ : state) {
+        for (int i = 0; i < calls; i++) {
+            camera.ProcessKeyboard(movements[i % 12], 1.0f / 60.0f);
+        }
+        benchmark::DoNotOptimize(camera.Position);
+    }
+    state.SetItemsProcessed(state.iterations() * calls);
+}
+BENCHMARK(BM_CameraProcessKeyboard)->RangeMultiplier(8)->Range(1, 512);
+
+// Camera::ProcessMouseMovement（参数为每次迭代的调用次数）
+static void BM_CameraProcessMouseMovement(benchmark::State& state) {
+    Camera camera(glm::vec3(0.0f, 0.0f, 25.0f));
+    int calls = (int)state.range(0);
+    for (auto _ : state) {
+        for (int i = 0; i < calls; i++) {
+            camera.ProcessMouseMovement((i & 1) ? 1.5f : -1.5f, (i & 2) ? 0.75f : -0.75f);
+        }
+        benchmark::DoNotOptimize(camera.Front);
+    }
+    state.SetItemsProcessed(state.iterations() * calls);
+}
+BENCHMARK(BM_CameraProcessMouseMovement)->RangeMultiplier(8)->Range(1, 512);
+
+// Scene::setupSceneUniform中uniform名称的拼接（调用与其相同的Scene::buildSceneUniformNames，不访问OpenGL；参数为定向光数量）
+static void BM_SceneUniformNames(benchmark::State& state) {
+    int lights = (int)state.range(0);
+    size_t nameCount = 0;
+    for (auto _ : state) {
+        Scene::SceneUniformNames names;
+        Scene::buildSceneUniformNames(lights, names);
+        benchmark::DoNotOptimize(names);
+        nameCount = names.cascadePlaneDistances.size();
+        for (const auto& light : names.directionalLights) {
+            nameCount += 5 + light.lightSpaceMatrices.size();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * nameCount);
+}
+BENCHMARK(BM_SceneUniformNames)->RangeMultiplier(4)->Range(1, 64);
+
+// lmImageDilate（参数为光照贴图的边长）
+static void BM_LightmapDilate(benchmark::State& state) {
+    int side = (int)state.range(0);
+    std::vector<float> image = makeLightmapImage(side, LIGHTMAP_CHANNELS);
+    std::vector<float> output(image.size());
+    for (auto _ : state) {
+        lmImageDilate(image.data(), output.data(), side, side, LIGHTMAP_CHANNELS);
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetBytesProcessed(state.iterations() * image.size() * sizeof(float));
+}
+BENCHMARK(BM_LightmapDilate)->RangeMultiplier(2)->Range(128, 2048)->Unit(benchmark::kMillisecond);
+
+// lmImageSmooth（参数为光照贴图的边长）
+static void BM_LightmapSmooth(benchmark::State& state) {
+    int side = (int)state.range(0);
+    std::vector<float> image = makeLightmapImage(side, LIGHTMAP_CHANNELS);
+    std::vector<float> output(image.size());
+    for (auto _ : state) {
+        lmImageSmooth(image.data(), output.data(), side, side, LIGHTMAP_CHANNELS);
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetBytesProcessed(state.iterations() * image.size() * sizeof(float));
+}
+BENCHMARK(BM_LightmapSmooth)->RangeMultiplier(2)->Range(128, 2048)->Unit(benchmark::kMillisecond);
+
+// lmImageDownsample（参数为光照贴图的边长）
+static void BM_LightmapDownsample(benchmark::State& state) {
+    int side = (int)state.range(0);
+    std::vector<float> image = makeLightmapImage(side, LIGHTMAP_CHANNELS);
+    std::vector<float> output(image.size() / 4);
+    for (auto _ : state) {
+        lmImageDownsample(image.data(), output.data(), side, side, LIGHTMAP_CHANNELS);
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetBytesProcessed(state.iterations() * image.size() * sizeof(float));
+}
+BENCHMARK(BM_LightmapDownsample)->RangeMultiplier(2)->Range(128, 2048)->Unit(benchmark::kMillisecond);
+
+// lmImagePower（原地gamma，参数为光照贴图的边长；每次迭代前恢复输入，不计入耗时）
+static void BM_LightmapPower(benchmark::State& state) {
+    int side = (int)state.range(0);
+    std::vector<float> source = makeLightmapImage(side, LIGHTMAP_CHANNELS);
+    std::vector<float> image(source.size());
+    for (auto _ : state) {
+        state.PauseTiming();
+        image = source;
+        state.ResumeTiming();
+        lmImagePower(image.data(), side, side, LIGHTMAP_CHANNELS, 1.0f / 2.2f);
+        benchmark::DoNotOptimize(image.data());
+    }
+    state.SetBytesProcessed(state.iterations() * image.size() * sizeof(float));
+}
+BENCHMARK(BM_LightmapPower)->RangeMultiplier(2)->Range(128, 2048)->Unit(benchmark::kMillisecond);
+
+// parallelImageDilate/parallelImageSmooth：烘焙时实际使用的并行版本，与上面的单线程版本对比
+static void BM_ParallelLightmapDilate(benchmark::State& state) {
+    static JobSystem jobs(JobSystem::defaultWorkerCount());
+    int side = (int)state.range(0);
+    std::vector<float> image = makeLightmapImage(side, LIGHTMAP_CHANNELS);
+    std::vector<float> output(image.size());
+    for (auto _ : state) {
+        parallelImageDilate(jobs, image.data(), output.data(), side, side, LIGHTMAP_CHANNELS);
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetBytesProcessed(state.iterations() * image.size() * sizeof(float));
+}
+BENCHMARK(BM_ParallelLightmapDilate)->RangeMultiplier(2)->Range(128, 2048)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_ParallelLightmapSmooth(benchmark::State& state) {
+    static JobSystem jobs(JobSystem::defaultWorkerCount());
+    int side = (int)state.range(0);
+    std::vector<float> image = makeLightmapImage(side, LIGHTMAP_CHANNELS);
+    std::vector<float> output(image.size());
+    for (auto _ : state) {
+        parallelImageSmooth(jobs, image.data(), output.data(), side, side, LIGHTMAP_CHANNELS);
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetBytesProcessed(state.iterations() * image.size() * sizeof(float));
+}
+BENCHMARK(BM_ParallelLightmapSmooth)->RangeMultiplier(2)->Range(128, 2048)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
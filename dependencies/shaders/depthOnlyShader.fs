@@ -0,0 +1,6 @@
+#version 330 core
+
+// 只写深度，不输出颜色（颜色写入在CPU端通过glColorMask关闭）
+void main()
+{
+}
@@ -0,0 +1,14 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+// 与sceneShader.vs相同的表达式和invariant声明，保证深度与主pass逐位相同
+invariant gl_Position;
+
+void main()
+{
+    gl_Position=projection*view*model*vec4(aPos,1.);
+}
@@ -7,8 +7,30 @@ void main()
     // 让片段着色器自己计算深度值
     // gl_FragDepth = gl_FragCoord.z;
     
-    // VSM
     float depth = gl_FragCoord.z;
+#if defined(ESM_EXPONENT)
+    // ESM：只存储exp(c*d)
+    FragColor.r = exp(ESM_EXPONENT * depth);
+#elif defined(MSM_MOMENTS)
+    // MSM：存储深度的前4阶矩
+    float depth2 = depth * depth;
+    vec4 moments = vec4(depth, depth2, depth2 * depth, depth2 * depth2);
+#ifdef MSM_QUANTIZED
+    // 16位定点数存储时使用优化的量化（Peters and Klein 2015），与sceneShader.fs中的反量化保持一致
+    moments = mat4(-2.07224649, 13.7948857237, .105877704, 9.7924062118,
+        32.23703778, -59.4683975703, -1.9077466311, -33.7652110555,
+        -68.571074599, 82.0359750338, 9.3496555107, 47.9456096605,
+        39.3703274134, -35.364903257, -6.6543490743, -23.9728048165) * moments;
+    moments.x += .035955884801;
+#endif
+    FragColor = moments;
+#else
+    // VSM
+#ifdef EVSM_EXPONENT
+    // EVSM：存储指数变换后的深度的矩，减少漏光
+    depth = exp(EVSM_EXPONENT * depth);
+#endif
     FragColor.r=depth;
     FragColor.g=depth*depth;
-}
\ No newline at end of file
+#endif
+}
@@ -0,0 +1,77 @@
+#version 330 core
+// 延迟渲染的几何pass：把光照需要的表面属性写入G-buffer，光照在全屏pass中对每个可见像素只计算一次
+/// 输出
+// 漫反射颜色
+layout(location=0)out vec4 gAlbedo;
+// 镜面反射颜色
+layout(location=1)out vec4 gSpecular;
+// 世界空间法线（xyz）和反射光泽度（w）
+layout(location=2)out vec4 gNormalShininess;
+
+/// 输入
+// 纹理坐标
+in vec2 TexCoords;
+// 法线
+in vec3 Normal;
+// 片段位置
+in vec3 FragPos;
+// TBN矩阵
+in mat3 TBN;
+
+/// uniform
+// 材质结构体（与sceneShader.fs相同）
+struct Material{
+    // 环境光系数
+    vec3 ambient;
+    // 漫反射系数
+    vec3 diffuse;
+    // 镜面反射系数
+    vec3 specular;
+    // 漫反射贴图
+    sampler2D diffuseMap;
+    // 是否使用法线贴图
+    bool sampleNormalMap;
+    // 法线贴图（凹凸贴图）
+    sampler2D normalMap;
+    // 是否使用镜面反射贴图
+    bool sampleSpecularMap;
+    // 镜面反射贴图
+    sampler2D specularMap;
+    // 反射光泽度
+    float shininess;
+};
+// 材质
+uniform Material material0;
+
+// 着色器变体，与sceneShader.fs相同
+#ifdef HAS_NORMAL_MAP
+#define SAMPLE_NORMAL_MAP bool(HAS_NORMAL_MAP)
+#else
+#define SAMPLE_NORMAL_MAP material0.sampleNormalMap
+#endif
+#ifdef HAS_SPECULAR_MAP
+#define SAMPLE_SPECULAR_MAP bool(HAS_SPECULAR_MAP)
+#else
+#define SAMPLE_SPECULAR_MAP material0.sampleSpecularMap
+#endif
+
+void main()
+{
+    vec3 sampledNormal=Normal;
+    // 判断是否进行法线贴图
+    if(SAMPLE_NORMAL_MAP){
+        // 从法线贴图采样法线
+        vec3 normalMap=texture(material0.normalMap,TexCoords).rgb;
+        sampledNormal=normalize(normalMap*2.-1.);
+        sampledNormal=normalize(TBN*sampledNormal);
+    }
+    
+    vec3 albedo=texture(material0.diffuseMap,TexCoords).rgb;
+    gAlbedo=vec4(albedo,1.);
+    // 没有镜面反射贴图时使用漫反射颜色，与前向渲染一致
+    if(SAMPLE_SPECULAR_MAP)
+    gSpecular=vec4(texture(material0.specularMap,TexCoords).rgb,1.);
+    else
+    gSpecular=vec4(albedo,1.);
+    gNormalShininess=vec4(normalize(sampledNormal),material0.shininess);
+}
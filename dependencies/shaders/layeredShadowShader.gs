@@ -0,0 +1,23 @@
+#version 330 core
+// 把每个三角形输出到实例对应的阴影贴图层（顶点着色器不能写gl_Layer时使用）
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+// 最大层数（定向光数量 * 级联数量）
+#define MAX_SHADOW_LAYERS 16
+
+// 每一层的光空间矩阵
+uniform mat4 lightSpaceMatrices[MAX_SHADOW_LAYERS];
+
+flat in int vInstance[];
+
+void main()
+{
+    int layer = vInstance[0];
+    for (int i = 0; i < 3; ++i) {
+        gl_Position = lightSpaceMatrices[layer] * gl_in[i].gl_Position;
+        gl_Layer = layer;
+        EmitVertex();
+    }
+    EndPrimitive();
+}
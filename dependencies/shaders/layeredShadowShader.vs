@@ -0,0 +1,19 @@
+#version 330 core
+// 单次提交渲染所有定向光的所有级联：每个实例对应阴影贴图数组的一层，在顶点着色器中写gl_Layer
+// 需要GL_ARB_shader_viewport_layer_array或GL_AMD_vertex_shader_layer扩展，不支持时使用几何着色器版本
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_layer : enable
+layout (location = 0) in vec3 aPos;
+
+// 最大层数（定向光数量 * 级联数量）
+#define MAX_SHADOW_LAYERS 16
+
+// 每一层的光空间矩阵
+uniform mat4 lightSpaceMatrices[MAX_SHADOW_LAYERS];
+uniform mat4 model;
+
+void main()
+{
+    gl_Position = lightSpaceMatrices[gl_InstanceID] * model * vec4(aPos, 1.0);
+    gl_Layer = gl_InstanceID;
+}
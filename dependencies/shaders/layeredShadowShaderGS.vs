@@ -0,0 +1,14 @@
+#version 330 core
+// 几何着色器版本的顶点着色器：只做模型变换，由几何着色器选择输出的层
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+
+// 实例序号，对应阴影贴图数组的层
+flat out int vInstance;
+
+void main()
+{
+    gl_Position = model * vec4(aPos, 1.0);
+    vInstance = gl_InstanceID;
+}
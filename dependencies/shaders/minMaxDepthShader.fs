@@ -0,0 +1,30 @@
+#version 330 core
+// 构建阴影贴图的最小/最大深度层级（PCSS分层遮挡物搜索使用）
+// 每个输出纹素保存上一级2x2纹素的最小深度和最大深度
+
+// 输出：r为最小深度，g为最大深度
+out vec4 FragColor;
+
+// 上一级的贴图数组（第0级的来源是深度贴图数组，其他级的来源是最小/最大深度贴图数组）
+// C++端把来源的GL_TEXTURE_BASE_LEVEL设置为上一级，所以这里总是读取第0级
+uniform sampler2DArray sourceMap;
+// 来源是否是深度贴图
+uniform bool fromDepth;
+// 当前处理的层
+uniform int layer;
+
+void main(){
+    ivec2 dst=ivec2(gl_FragCoord.xy);
+    ivec2 sourceSize=textureSize(sourceMap,0).xy;
+    vec2 result=vec2(1.,0.);
+    for(int y=0;y<2;++y){
+        for(int x=0;x<2;++x){
+            ivec2 src=min(dst*2+ivec2(x,y),sourceSize-1);
+            vec4 texel=texelFetch(sourceMap,ivec3(src,layer),0);
+            vec2 d=fromDepth?texel.rr:texel.rg;
+            result.x=min(result.x,d.x);
+            result.y=max(result.y,d.y);
+        }
+    }
+    FragColor=vec4(result,0.,1.);
+}
@@ -0,0 +1,8 @@
+#version 330 core
+out vec4 FragColor;
+
+// 每个着色的片段叠加一次（加法混合），红、绿、蓝分别在4、8、16层重叠时饱和：暗红 -> 红 -> 黄 -> 白
+void main()
+{
+    FragColor = vec4(0.25, 0.125, 0.0625, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 330 core
+in vec3 FragPos;
+
+// 光源位置
+uniform vec3 lightPos;
+// 光源的影响范围，深度存储到光源的距离除以影响范围
+uniform float lightRange;
+
+// 存储线性距离而不是透视深度，采样时不需要知道片段落在哪个面的投影矩阵
+void main()
+{
+    gl_FragDepth = length(FragPos - lightPos) / lightRange;
+}
@@ -0,0 +1,30 @@
+#version 330 core
+// 一次提交渲染点光源立方体阴影贴图的6个面：每个三角形输出到与之相交的面对应的层
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 18) out;
+
+// 立方体6个面的光空间矩阵（+X, -X, +Y, -Y, +Z, -Z）
+uniform mat4 faceMatrices[6];
+// 当前物体与哪些面的视锥体相交（第i位对应第i个面），由CPU端按光源的影响范围剔除
+uniform int faceMask;
+// 当前光源的第一个面在阴影贴图数组中的层
+uniform int layerOffset;
+
+// 世界空间位置，片段着色器用来计算到光源的距离
+out vec3 FragPos;
+
+void main()
+{
+    for (int face = 0; face < 6; ++face) {
+        if ((faceMask & (1 << face)) == 0) {
+            continue;
+        }
+        for (int i = 0; i < 3; ++i) {
+            FragPos = gl_in[i].gl_Position.xyz;
+            gl_Position = faceMatrices[face] * gl_in[i].gl_Position;
+            gl_Layer = layerOffset + face;
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+}
@@ -0,0 +1,10 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+
+// 输出世界空间位置，由几何着色器投影到立方体的各个面
+void main()
+{
+    gl_Position = model * vec4(aPos, 1.0);
+}
@@ -4,14 +4,19 @@
 out vec4 FragColor;
 
 /// 输入
-// 纹理坐标
+// 纹理坐标（延迟光照时是全屏四边形的纹理坐标）
 in vec2 TexCoords;
+#ifdef DEFERRED_LIGHTING
+// 延迟光照：片段位置从G-buffer的深度重建
+vec3 FragPos;
+#else
 // 法线
 in vec3 Normal;
 // 片段位置
 in vec3 FragPos;
 // TBN矩阵
 in mat3 TBN;
+#endif
 
 /// uniform
 // 材质结构体
@@ -44,31 +49,17 @@ uniform bool blinn;
 // 阴影计算算法选择
 uniform int shadowMapType;
 
+// 最大级联数量
+#define MAX_CASCADES 4
+
 struct DirLight{
     vec3 direction;
     vec3 lightColor;
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
-    // 光空间矩阵
-    mat4 lightSpaceMatrix;
-    // 阴影贴图
-    sampler2D shadowMap;
-    // 阴影方差与均值贴图
-    sampler2D d_d2_filter;
-};
-
-struct PointLight{
-    vec3 position;
-    vec3 lightColor;
-    
-    float constant;
-    float linear;
-    float quadratic;
-    
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+    // 每个级联的光空间矩阵
+    mat4 lightSpaceMatrices[MAX_CASCADES];
 };
 
 #define MAX_DIRECTIONAL_LIGHTS 4
@@ -76,6 +67,35 @@ struct PointLight{
 uniform int numDirectionalLights;
 // 定向光数组
 uniform DirLight directionalLights[MAX_DIRECTIONAL_LIGHTS];
+// 所有定向光共用的阴影贴图数组，第i个定向光的第c个级联位于第i*cascadeCount+c层
+uniform sampler2DArray shadowMapArray;
+// 所有定向光共用的阴影方差与均值贴图数组（VSM），层的排列与shadowMapArray相同
+uniform sampler2DArray d_d2_filterArray;
+// EVSM的指数，0表示普通VSM（矩是深度本身而不是指数变换后的深度）
+uniform float vsmExponent;
+// VSM的最小方差，避免低精度的矩相减产生的负方差和噪点
+uniform float vsmMinVariance;
+// ESM的指数（与阴影渲染时使用的指数相同）
+uniform float esmExponent;
+// MSM的矩偏移量，把矩向一个合法的分布偏移，避免矩的精度误差造成的瑕疵
+uniform float msmMomentBias;
+// MSM的矩是否经过了16位定点数的优化量化
+uniform bool msmQuantized;
+// 硬件比较的阴影贴图数组：与shadowMapArray是同一个纹理，但绑定了开启GL_COMPARE_REF_TO_TEXTURE和线性过滤的采样器对象
+// 每次采样由硬件完成2x2邻域的深度比较和双线性插值
+uniform sampler2DArrayShadow shadowMapArrayCompare;
+// 硬件PCF的采样点数量（1~32）
+uniform int pcfTaps;
+// 硬件PCF的采样图案：0为泊松圆盘（每个像素随机旋转），1为旋转网格
+uniform int pcfPattern;
+// 硬件PCF的滤波半径（纹素）
+uniform float hwPCFRadius;
+// 阴影贴图的最小/最大深度层级（r为最小深度，g为最大深度），第0级是阴影贴图的一半分辨率
+uniform sampler2DArray shadowMinMaxArray;
+// 最小/最大深度层级的级数
+uniform int shadowMinMaxLevels;
+// PCSS是否使用分层遮挡物搜索和自适应滤波核
+uniform bool pcssHierarchical;
 // 光源宽度
 uniform float lightWidth;
 // PCF采样半径
@@ -84,50 +104,183 @@ uniform float PCFSampleRadius;
 uniform float near_plane;
 // 远裁剪面
 uniform float far_plane;
+// 视图矩阵，用来计算片段在视空间中的深度以选择级联
+uniform mat4 view;
+// 级联数量
+uniform int cascadeCount;
+// 每个级联在视空间中的远平面距离
+uniform float cascadePlaneDistances[MAX_CASCADES];
 
-#define NR_POINT_LIGHTS 4
+// 点光源数量
 uniform int numPointLights;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
+// 分簇光照：点光源数据，每个光源5个texel（位置和影响范围、环境光和常数项、漫反射和一次项、镜面反射和二次项、阴影的第一层，颜色已经乘上了光的颜色）
+uniform samplerBuffer pointLightData;
+#define POINT_LIGHT_TEXELS 5
+// 点光源的立方体阴影贴图，每个有阴影的点光源占用连续的6层（+X, -X, +Y, -Y, +Z, -Z），存储到光源的距离除以影响范围
+uniform sampler2DArray pointShadowMaps;
+// 分簇光照：每个簇的光源列表在索引数组中的偏移和数量
+uniform usamplerBuffer clusterGrid;
+// 分簇光照：所有簇的光源索引
+uniform usamplerBuffer clusterLightIndices;
+// 簇在屏幕x、y方向和深度方向的数量
+uniform ivec3 clusterCounts;
+// 像素坐标到屏幕簇坐标的缩放
+uniform vec2 clusterTileScale;
+// 视空间深度到深度切片的映射：slice = log(z) * clusterDepthScale - clusterDepthBias
+uniform float clusterDepthScale;
+uniform float clusterDepthBias;
 
 uniform bool useLightMap;
 uniform sampler2D lightMap;
 
+#ifdef DEFERRED_LIGHTING
+// G-buffer：漫反射颜色
+uniform sampler2D gAlbedo;
+// G-buffer：镜面反射颜色
+uniform sampler2D gSpecular;
+// G-buffer：世界空间法线（xyz）和反射光泽度（w）
+uniform sampler2D gNormalShininess;
+// G-buffer：深度
+uniform sampler2D gDepth;
+// 投影矩阵*视图矩阵的逆矩阵，用于从深度重建世界空间位置
+uniform mat4 inverseViewProjection;
+// 渲染分辨率与G-buffer大小的比例（动态分辨率时只有G-buffer的左下角区域有效）
+uniform vec2 gBufferUVScale;
+#endif
+
+// 着色器变体：以下宏由C++端（ShaderPermutations）按需定义，把运行时分支变成编译期常量
+// 没有定义时退化为读取uniform的通用版本（uber-shader）
+#ifdef SHADOW_ALGORITHM
+#define SHADOW_MAP_TYPE SHADOW_ALGORITHM
+#else
+#define SHADOW_MAP_TYPE shadowMapType
+#endif
+#ifdef NUM_DIRECTIONAL_LIGHTS
+#define DIRECTIONAL_LIGHT_COUNT NUM_DIRECTIONAL_LIGHTS
+#else
+#define DIRECTIONAL_LIGHT_COUNT numDirectionalLights
+#endif
+#ifdef HAS_NORMAL_MAP
+#define SAMPLE_NORMAL_MAP bool(HAS_NORMAL_MAP)
+#else
+#define SAMPLE_NORMAL_MAP material0.sampleNormalMap
+#endif
+#ifdef HAS_SPECULAR_MAP
+#define SAMPLE_SPECULAR_MAP bool(HAS_SPECULAR_MAP)
+#else
+#define SAMPLE_SPECULAR_MAP material0.sampleSpecularMap
+#endif
+#ifdef USE_LIGHT_MAP
+#define SAMPLE_LIGHT_MAP bool(USE_LIGHT_MAP)
+#else
+#define SAMPLE_LIGHT_MAP useLightMap
+#endif
+#ifdef PCF_TAP_COUNT
+#define HW_PCF_TAPS PCF_TAP_COUNT
+#else
+#define HW_PCF_TAPS pcfTaps
+#endif
+#ifdef PCF_PATTERN
+#define HW_PCF_PATTERN PCF_PATTERN
+#else
+#define HW_PCF_PATTERN pcfPattern
+#endif
+#ifdef PCSS_HIERARCHICAL
+#define USE_PCSS_HIERARCHY bool(PCSS_HIERARCHICAL)
+#else
+#define USE_PCSS_HIERARCHY pcssHierarchical
+#endif
+
 // 存储了从光源视角看当前fragment位置的深度值，这个深度值是从阴影贴图中采样得到的，用于判断当前fragment是否在阴影中
 float closestDepth;
 // 存储了从摄像机是将看当前fragment位置的深度值，这个深度值计算是在摄像机移动时计算的
 float currentDepth;
+// 当前片段所在的级联，-1表示超出了阴影覆盖范围
+int cascadeLayer;
+// 当前定向光的当前级联在阴影贴图数组中的层
+int shadowLayer;
+// PCSS的阴影贴图采样次数（定义OUTPUT_FETCH_COUNT时输出，用来统计每个片段的平均采样次数）
+int shadowFetches=0;
 // PCF采样邻域大小
 #define PCF_RADIUS 6
 // 块半径
 #define BLOCK_RADIUS 5
+// 泊松圆盘采样点（单位圆内，按最佳候选法逐个生成，任意前N个点都分布均匀）
+const vec2 poissonDisk[32]=vec2[](
+    vec2(-.3523,-.6983),vec2(.3306,.8975),vec2(.8795,-.2688),vec2(-.8629,.5014),
+    vec2(.0750,.0658),vec2(.4089,-.8670),vec2(-.9375,-.2450),vec2(.8903,.4509),
+    vec2(-.3211,.8863),vec2(-.4819,.1042),vec2(.3776,-.3384),vec2(-.0034,.5371),
+    vec2(.5592,.0998),vec2(-.2246,-.2828),vec2(-.0223,-.9941),vec2(.4711,.5065),
+    vec2(.0637,-.6013),vec2(-.4296,.4963),vec2(-.7602,-.6369),vec2(.7019,-.6158),
+    vec2(-.9923,.1211),vec2(.9490,.0901),vec2(-.5838,-.3236),vec2(-.6473,.7571),
+    vec2(.0073,.9827),vec2(-.1821,.2533),vec2(.0781,-.2452),vec2(.6500,.7559),
+    vec2(.2234,.3267),vec2(-.7411,-.0312),vec2(-.7267,.2529),vec2(.6125,-.1745)
+);
 
 // 计算定向光贡献
-vec3 CalcDirLight(DirLight light,vec3 normal,vec3 viewDir);
+vec3 CalcDirLight(DirLight light,int lightIndex,vec3 normal,vec3 viewDir);
 // 计算点光源贡献
-vec3 CalcPointLight(PointLight light,vec3 normal,vec3 fragPos,vec3 viewDir);
+vec3 CalcPointLight(int lightIndex,vec3 normal,vec3 fragPos,vec3 viewDir);
+// 计算当前片段所在的簇中所有点光源的贡献
+vec3 CalcClusteredPointLights(vec3 normal,vec3 fragPos,vec3 viewDir);
+// 计算点光源的阴影（立方体阴影贴图，按方向选择面后做PCF）
+float PointShadow(int firstLayer,vec3 lightPos,float range,vec3 fragPos,vec3 normal,vec3 lightDir);
+// 根据片段在视空间中的深度选择级联
+int selectCascade(vec3 fragPos);
 // 使用SM计算阴影
-float SM(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2D shadowMap);
+float SM(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2DArray shadowMap);
 // 使用PCF计算阴影
-float PCF(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2D shadowMap);
+float PCF(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2DArray shadowMap);
 // 使用PCSS计算阴影
-float PCSS(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2D shadowMap);
+float PCSS(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2DArray shadowMap);
 // 找到阴影贴图中遮挡当前片段的遮挡者，并计算遮挡者的平均深度值（阴影软化效果
 // uv: 当前片段在阴影贴图中的纹理坐标
 // zReceiver: 当前片段在光源视角看到的深度值
 // shadowMap: 阴影贴图
 // bias: 阴影偏移量
-float findBlocker(vec2 uv,float zReceiver,sampler2D shadowMap,float bias);
+float findBlocker(vec2 uv,float zReceiver,sampler2DArray shadowMap,float bias);
+// 使用最小/最大深度层级分层搜索遮挡者，返回-1表示完全照亮，-2表示完全被遮挡，否则返回估计的遮挡者平均深度
+// 搜索范围与findBlocker相同，先在一个纹素覆盖整个搜索范围的层级上读取2x2纹素提前退出，再在下一级估计平均深度
+float findBlockerHierarchical(vec2 uv,float zReceiver,float bias);
 // 使用VSM计算阴影
-float VSM(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2D d_d2_filter);
+float VSM(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2DArray d_d2_filter);
+// 使用硬件比较的PCF计算阴影（泊松圆盘或旋转网格采样）
+float HWPCF(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir);
+// 使用ESM计算阴影（单通道，存储exp(c*d)，与VSM共用过滤）
+float ESM(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2DArray momentsMap);
+// 使用4个矩的MSM计算阴影（Hamburger 4MSM，与VSM共用过滤）
+float MSM(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2DArray momentsMap);
 
 vec2 d_d2;
 float depth;
+// 当前片段的表面属性（前向渲染时从材质贴图采样，延迟光照时从G-buffer读取），所有光源共用
+vec3 albedo;
+vec3 specularColor;
+float shininess;
 
 void main()
 {
+#ifdef DEFERRED_LIGHTING
+    vec2 gBufferUV=TexCoords*gBufferUVScale;
+    float sceneDepth=texture(gDepth,gBufferUV).r;
+    // 没有几何体的像素（背景）保留原来的颜色和深度，留给天空盒
+    if(sceneDepth>=1.){
+        discard;
+    }
+    // 写入场景的深度，之后的天空盒等前向pass可以正常做深度测试
+    gl_FragDepth=sceneDepth;
+    vec4 worldPos=inverseViewProjection*vec4(vec3(TexCoords,sceneDepth)*2.-1.,1.);
+    FragPos=worldPos.xyz/worldPos.w;
+    albedo=texture(gAlbedo,gBufferUV).rgb;
+    specularColor=texture(gSpecular,gBufferUV).rgb;
+    vec4 normalShininess=texture(gNormalShininess,gBufferUV);
+    shininess=normalShininess.w;
+    vec3 norm=normalize(normalShininess.xyz);
+    vec3 viewDir=normalize(viewPos-FragPos);
+#else
     vec3 sampledNormal=Normal;
     // 判断是否进行法线贴图
-    if(material0.sampleNormalMap){
+    if(SAMPLE_NORMAL_MAP){
         // 从法线贴图采样法线
         vec3 normalMap=texture(material0.normalMap,TexCoords).rgb;
         sampledNormal=normalize(normalMap*2.-1.);
@@ -140,95 +293,197 @@ void main()
     vec3 norm=normalize(sampledNormal);
     vec3 viewDir=normalize(viewPos-FragPos);
     
-    if (useLightMap)
+    if (SAMPLE_LIGHT_MAP)
     {
         FragColor = vec4(texture(lightMap, TexCoords).rgb, gl_FrontFacing ? 1.0 : 0.0);
         return;
     }
+    
+    // 材质贴图每个片段只采样一次
+    albedo=texture(material0.diffuseMap,TexCoords).rgb;
+    if(SAMPLE_SPECULAR_MAP)
+    specularColor=texture(material0.specularMap,TexCoords).rgb;
+    else
+    specularColor=albedo;
+    shininess=material0.shininess;
+#endif
 
+    // 选择级联，所有方向光共用
+    cascadeLayer=selectCascade(FragPos);
+    
     // 计算所有方向光的贡献
     vec3 result=vec3(0.);
-    for(int i=0;i<numDirectionalLights;i++)
-    result+=CalcDirLight(directionalLights[i],norm,viewDir);
+    for(int i=0;i<DIRECTIONAL_LIGHT_COUNT;i++)
+    result+=CalcDirLight(directionalLights[i],i,norm,viewDir);
+    // 计算所在簇的点光源的贡献
+    if(numPointLights>0)
+    result+=CalcClusteredPointLights(norm,FragPos,viewDir);
     
     FragColor=vec4(result,1.);
+#ifdef OUTPUT_FETCH_COUNT
+    FragColor=vec4(float(shadowFetches),0.,0.,1.);
+#endif
     
     // DEBUG：测试阴影贴图
-    // vec4 FragPosLightSpace=directionalLights[0].lightSpaceMatrix*vec4(FragPos,1.);
-    // float temp=VSM(FragPosLightSpace, norm, viewDir, directionalLights[0].d_d2_filter);
+    // vec4 FragPosLightSpace=directionalLights[0].lightSpaceMatrices[max(cascadeLayer,0)]*vec4(FragPos,1.);
+    // shadowLayer=max(cascadeLayer,0);
+    // float temp=VSM(FragPosLightSpace, norm, viewDir, d_d2_filterArray);
     // FragColor=vec4(vec3(1.-temp),1.);
     // DEBUG：VSM，显示光源视角的深度值
     // FragColor=vec4(vec3(d_d2.x),1.);
+    // DEBUG：显示级联
+    // FragColor=vec4(result*vec3(cascadeLayer==0?1.5:1.,cascadeLayer==1?1.5:1.,cascadeLayer==2?1.5:1.),1.);
+}
+
+int selectCascade(vec3 fragPos){
+    // 片段在视空间中的深度
+    float depthValue=abs((view*vec4(fragPos,1.)).z);
+    for(int i=0;i<cascadeCount;++i){
+        if(depthValue<cascadePlaneDistances[i]){
+            return i;
+        }
+    }
+    // 超出了阴影覆盖范围
+    return-1;
 }
 
-vec3 CalcDirLight(DirLight light,vec3 normal,vec3 viewDir){
+vec3 CalcDirLight(DirLight light,int lightIndex,vec3 normal,vec3 viewDir){
     vec3 lightDir=normalize(-light.direction);
     // diffuse shading
     float diff=max(dot(normal,lightDir),0.);
     // specular shading
     vec3 halfVector=normalize(lightDir+viewDir);
-    float spec=pow(max(dot(normal,halfVector),0.),material0.shininess);
+    float spec=pow(max(dot(normal,halfVector),0.),shininess);
     if(!blinn){
         vec3 reflectDir=reflect(-lightDir,normal);
-        spec=pow(max(dot(reflectDir,viewDir),0.),material0.shininess);
+        spec=pow(max(dot(reflectDir,viewDir),0.),shininess);
     }
     // combine results
-    vec3 ambient=light.ambient*light.lightColor*vec3(texture(material0.diffuseMap,TexCoords));
-    vec3 diffuse=light.diffuse*light.lightColor*diff*vec3(texture(material0.diffuseMap,TexCoords));
-    vec3 specular;
-    if(material0.sampleSpecularMap)
-    specular=light.specular*light.lightColor*spec*vec3(texture(material0.specularMap,TexCoords));
-    else
-    specular=light.specular*light.lightColor*spec*vec3(texture(material0.diffuseMap,TexCoords));
+    vec3 ambient=light.ambient*light.lightColor*albedo;
+    vec3 diffuse=light.diffuse*light.lightColor*diff*albedo;
+    vec3 specular=light.specular*light.lightColor*spec*specularColor;
     
-    // 计算阴影
-    vec4 FragPosLightSpace=light.lightSpaceMatrix*vec4(FragPos,1.);
+    // 计算阴影，超出阴影覆盖范围的片段不在阴影中
+    if(cascadeLayer<0){
+        return(ambient+diffuse+specular);
+    }
+    vec4 FragPosLightSpace=light.lightSpaceMatrices[cascadeLayer]*vec4(FragPos,1.);
+    shadowLayer=lightIndex*cascadeCount+cascadeLayer;
     float shadow;
-    if(shadowMapType==0){
-        shadow=SM(FragPosLightSpace,normal,lightDir,light.shadowMap);
+    if(SHADOW_MAP_TYPE==0){
+        shadow=SM(FragPosLightSpace,normal,lightDir,shadowMapArray);
+    }
+    else if(SHADOW_MAP_TYPE==1){
+        shadow=PCF(FragPosLightSpace,normal,lightDir,shadowMapArray);
+    }
+    else if(SHADOW_MAP_TYPE==2){
+        shadow=PCSS(FragPosLightSpace,normal,lightDir,shadowMapArray);
+    }
+    else if(SHADOW_MAP_TYPE==3){
+        shadow=VSM(FragPosLightSpace,normal,lightDir,d_d2_filterArray);
     }
-    else if(shadowMapType==1){
-        shadow=PCF(FragPosLightSpace,normal,lightDir,light.shadowMap);
+    else if(SHADOW_MAP_TYPE==4){
+        shadow=HWPCF(FragPosLightSpace,normal,lightDir);
     }
-    else if(shadowMapType==2){
-        shadow=PCSS(FragPosLightSpace,normal,lightDir,light.shadowMap);
+    else if(SHADOW_MAP_TYPE==5){
+        shadow=ESM(FragPosLightSpace,normal,lightDir,d_d2_filterArray);
     }
-    else if(shadowMapType==3){
-        shadow=VSM(FragPosLightSpace,normal,lightDir,light.d_d2_filter);
+    else if(SHADOW_MAP_TYPE==6){
+        shadow=MSM(FragPosLightSpace,normal,lightDir,d_d2_filterArray);
     }
     
     return(ambient+(1.-shadow)*(diffuse+specular));
 }
 
-vec3 CalcPointLight(PointLight light,vec3 normal,vec3 fragPos,vec3 viewDir){
-    vec3 lightDir=normalize(light.position-fragPos);
+vec3 CalcClusteredPointLights(vec3 normal,vec3 fragPos,vec3 viewDir){
+    // 片段所在的簇：屏幕块由像素坐标决定，深度切片由视空间深度按指数划分
+    float viewDepth=-(view*vec4(fragPos,1.)).z;
+    ivec2 tile=clamp(ivec2(gl_FragCoord.xy*clusterTileScale),ivec2(0),clusterCounts.xy-1);
+    int slice=clamp(int(log(max(viewDepth,1e-4))*clusterDepthScale-clusterDepthBias),0,clusterCounts.z-1);
+    int cluster=(slice*clusterCounts.y+tile.y)*clusterCounts.x+tile.x;
+    uvec2 offsetCount=texelFetch(clusterGrid,cluster).rg;
+    vec3 result=vec3(0.);
+    for(uint i=0u;i<offsetCount.y;i++){
+        int lightIndex=int(texelFetch(clusterLightIndices,int(offsetCount.x+i)).r);
+        result+=CalcPointLight(lightIndex,normal,fragPos,viewDir);
+    }
+    return result;
+}
+
+vec3 CalcPointLight(int lightIndex,vec3 normal,vec3 fragPos,vec3 viewDir){
+    int base=lightIndex*POINT_LIGHT_TEXELS;
+    vec4 positionRange=texelFetch(pointLightData,base);
+    vec4 ambientConstant=texelFetch(pointLightData,base+1);
+    vec4 diffuseLinear=texelFetch(pointLightData,base+2);
+    vec4 specularQuadratic=texelFetch(pointLightData,base+3);
+    int pointShadowLayer=int(texelFetch(pointLightData,base+4).r);
+    vec3 lightDir=normalize(positionRange.xyz-fragPos);
     // diffuse shading
     float diff=max(dot(normal,lightDir),0.);
     // specular shading
     vec3 halfVector=normalize(lightDir+viewDir);
-    float spec=pow(max(dot(normal,halfVector),0.),material0.shininess);
+    float spec=pow(max(dot(normal,halfVector),0.),shininess);
     if(!blinn){
         vec3 reflectDir=reflect(-lightDir,normal);
-        spec=pow(max(dot(reflectDir,viewDir),0.),material0.shininess);
+        spec=pow(max(dot(reflectDir,viewDir),0.),shininess);
     }
     // attenuation
-    float distance=length(light.position-fragPos);
-    float attenuation=1./(light.constant+light.linear*distance+light.quadratic*(distance*distance));
+    float distance=length(positionRange.xyz-fragPos);
+    float attenuation=1./(ambientConstant.w+diffuseLinear.w*distance+specularQuadratic.w*(distance*distance));
+    // 在影响范围的边界平滑衰减到0，避免簇的边界处光照突变
+    float window=clamp(1.-pow(distance/positionRange.w,4.),0.,1.);
+    attenuation*=window*window;
     // combine results
-    vec3 ambient=light.ambient*light.lightColor*vec3(texture(material0.diffuseMap,TexCoords));
-    vec3 diffuse=light.diffuse*light.lightColor*diff*vec3(texture(material0.diffuseMap,TexCoords));
-    vec3 specular;
-    if(material0.sampleSpecularMap)
-    specular=light.specular*light.lightColor*spec*vec3(texture(material0.specularMap,TexCoords));
-    else
-    specular=light.specular*light.lightColor*spec*vec3(texture(material0.diffuseMap,TexCoords));
+    vec3 ambient=ambientConstant.rgb*albedo;
+    vec3 diffuse=diffuseLinear.rgb*diff*albedo;
+    vec3 specular=specularQuadratic.rgb*spec*specularColor;
     ambient*=attenuation;
     diffuse*=attenuation;
     specular*=attenuation;
-    return(ambient+diffuse+specular);
+    // 没有分配到阴影贴图的点光源不投射阴影
+    float shadow=0.;
+    if(pointShadowLayer>=0&&diff>0.){
+        shadow=PointShadow(pointShadowLayer,positionRange.xyz,positionRange.w,fragPos,normal,lightDir);
+    }
+    return(ambient+(1.-shadow)*(diffuse+specular));
+}
+
+// 立方体每个面的朝向和上方向，与CPU端渲染点光源阴影时使用的lookAt相同
+const vec3 cubeFaceForward[6]=vec3[](vec3(1.,0.,0.),vec3(-1.,0.,0.),vec3(0.,1.,0.),vec3(0.,-1.,0.),vec3(0.,0.,1.),vec3(0.,0.,-1.));
+const vec3 cubeFaceUp[6]=vec3[](vec3(0.,-1.,0.),vec3(0.,-1.,0.),vec3(0.,0.,1.),vec3(0.,0.,-1.),vec3(0.,-1.,0.),vec3(0.,-1.,0.));
+
+float PointShadow(int firstLayer,vec3 lightPos,float range,vec3 fragPos,vec3 normal,vec3 lightDir){
+    vec3 toFragment=fragPos-lightPos;
+    // 按主轴选择立方体的面
+    vec3 absDir=abs(toFragment);
+    int face;
+    if(absDir.x>=absDir.y&&absDir.x>=absDir.z)
+    face=toFragment.x>0.?0:1;
+    else if(absDir.y>=absDir.z)
+    face=toFragment.y>0.?2:3;
+    else
+    face=toFragment.z>0.?4:5;
+    // 90度透视投影到面上：与lookAt的视图空间坐标一致
+    vec3 forward=cubeFaceForward[face];
+    vec3 side=cross(forward,cubeFaceUp[face]);
+    vec3 up=cross(side,forward);
+    float depthAlongAxis=dot(forward,toFragment);
+    vec2 uv=vec2(dot(side,toFragment),dot(up,toFragment))/depthAlongAxis*.5+.5;
+    // 距离按影响范围归一化，与阴影贴图中存储的值相同
+    float currentDistance=length(toFragment)/range;
+    float bias=max(.02*(1.-dot(normal,lightDir)),.005);
+    // 8个泊松圆盘采样点的PCF，采样点限制在当前面内
+    vec2 texelSize=1./vec2(textureSize(pointShadowMaps,0).xy);
+    float shadow=0.;
+    for(int i=0;i<8;i++){
+        vec2 sampleUV=clamp(uv+poissonDisk[i]*1.5*texelSize,texelSize*.5,1.-texelSize*.5);
+        float closest=texture(pointShadowMaps,vec3(sampleUV,float(firstLayer+face))).r;
+        shadow+=currentDistance-bias>closest?1.:0.;
+    }
+    return shadow/8.;
 }
 
-float SM(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2D shadowMap){
+float SM(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2DArray shadowMap){
     // 转换为标准齐次坐标 z[-1, 1]
     vec3 projCoords=fragPosLightSpace.xyz/fragPosLightSpace.w;
     // xyz: [-1, 1] -> [0, 1]
@@ -238,7 +493,7 @@ float SM(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2D shadowMap){
     return 0.;
     
     // 从光源视角看到的深度值（从阴影贴图获取
-    closestDepth=texture(shadowMap,projCoords.xy).r;
+    closestDepth=texture(shadowMap,vec3(projCoords.xy,shadowLayer)).r;
     // 从摄像机视角看到的深度值
     currentDepth=projCoords.z;
     // 偏移量，解决阴影失真的问题, 根据表面朝向光线的角度更改偏移量
@@ -249,7 +504,7 @@ float SM(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2D shadowMap){
     return shadow;
 }
 
-float PCF(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2D shadowMap){
+float PCF(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2DArray shadowMap){
     // 转换为标准齐次坐标 z[-1, 1]
     vec3 projCoords=fragPosLightSpace.xyz/fragPosLightSpace.w;
     // xyz: [-1, 1] -> [0, 1]
@@ -259,7 +514,7 @@ float PCF(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2D shadowMap){
     return 0.;
     
     // 从光源视角看到的深度值（从阴影贴图获取
-    closestDepth=texture(shadowMap,projCoords.xy).r;
+    closestDepth=texture(shadowMap,vec3(projCoords.xy,shadowLayer)).r;
     // 从摄像机视角看到的深度值
     currentDepth=projCoords.z;
     // 偏移量，解决阴影失真的问题, 根据表面朝向光线的角度更改偏移量
@@ -267,14 +522,14 @@ float PCF(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2D shadowMap){
     /// PCF:
     float shadow=0.;
     // 计算每个纹素的大小
-    vec2 texelSize=1./textureSize(shadowMap,0);
+    vec2 texelSize=1./textureSize(shadowMap,0).xy;
     // 遍历3x3的邻域
     for(int x=-PCF_RADIUS;x<=PCF_RADIUS;++x)
     {
         for(int y=-PCF_RADIUS;y<=PCF_RADIUS;++y)
         {
             // 从阴影贴图中采样深度值
-            float pcfDepth=texture(shadowMap,projCoords.xy+vec2(x,y)*texelSize).r;
+            float pcfDepth=texture(shadowMap,vec3(projCoords.xy+vec2(x,y)*texelSize,shadowLayer)).r;
             // 如果当前片段的深度值大于采样的深度值，则在阴影中
             shadow+=currentDepth-bias>pcfDepth?1.:0.;
         }
@@ -286,7 +541,7 @@ float PCF(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2D shadowMap){
     return shadow;
 }
 
-float PCSS(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2D shadowMap){
+float PCSS(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2DArray shadowMap){
     // 转换为标准齐次坐标 z[-1, 1]
     vec3 projCoords=fragPosLightSpace.xyz/fragPosLightSpace.w;
     // xyz: [-1, 1] -> [0, 1]
@@ -296,18 +551,22 @@ float PCSS(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2D shadowMap)
     return 0.;
     
     // 从光源视角看到的深度值（从阴影贴图获取
-    closestDepth=texture(shadowMap,projCoords.xy).r;
+    closestDepth=texture(shadowMap,vec3(projCoords.xy,shadowLayer)).r;
     // 从摄像机视角看到的深度值
     currentDepth=projCoords.z;
     // 偏移量，解决阴影失真的问题, 根据表面朝向光线的角度更改偏移量
     float bias=max(.05*(1.-dot(normal,lightDir)),.005);
     /// PCSS:
     // 计算平均遮挡物体的深度值
-    float avgDepth=findBlocker(projCoords.xy,currentDepth,shadowMap,bias);
+    float avgDepth=USE_PCSS_HIERARCHY?findBlockerHierarchical(projCoords.xy,currentDepth,bias):findBlocker(projCoords.xy,currentDepth,shadowMap,bias);
     // 如果没有遮挡物体，则直接返回0.0(不在阴影中)
     if(avgDepth==-1.){
         return 0.;
     }
+    // 搜索范围内全部是遮挡物体，直接返回1.0(完全在阴影中)
+    if(avgDepth==-2.){
+        return 1.;
+    }
     // 半影大小
     float penumbra=(currentDepth-avgDepth)/avgDepth*lightWidth;
     // 采样半径
@@ -316,38 +575,48 @@ float PCSS(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2D shadowMap)
     filterRadius*=PCFSampleRadius;
     float shadow=0.;
     // 计算每个纹素的大小
-    vec2 texelSize=1./textureSize(shadowMap,0);
+    vec2 texelSize=1./textureSize(shadowMap,0).xy;
+    // 滤波核每个方向的采样点数量和间距（纹素）
+    int kernelRadius=PCF_RADIUS;
+    float kernelStep=filterRadius;
+    if(USE_PCSS_HIERARCHY){
+        // 自适应滤波核：覆盖范围与原来相同（半径PCF_RADIUS*filterRadius个纹素），半影越小采样点越少
+        kernelRadius=clamp(int(ceil(float(PCF_RADIUS)*filterRadius)),1,PCF_RADIUS);
+        kernelStep=float(PCF_RADIUS)*filterRadius/float(kernelRadius);
+    }
     // 遍历邻域
-    for(int x=-PCF_RADIUS;x<=PCF_RADIUS;++x)
+    for(int x=-kernelRadius;x<=kernelRadius;++x)
     {
-        for(int y=-PCF_RADIUS;y<=PCF_RADIUS;++y)
+        for(int y=-kernelRadius;y<=kernelRadius;++y)
         {
             // 从阴影贴图中采样深度值
-            float shadowMapDepth=texture(shadowMap,projCoords.xy+filterRadius*vec2(x,y)*texelSize).r;
+            float shadowMapDepth=texture(shadowMap,vec3(projCoords.xy+kernelStep*vec2(x,y)*texelSize,shadowLayer)).r;
+            ++shadowFetches;
             // 如果当前片段的深度值大于采样的深度值，则在阴影中
             shadow+=currentDepth-bias>shadowMapDepth?1.:0.;
         }
     }
     // 计算平均阴影值
-    float total=2*PCF_RADIUS+1;
+    float total=2*kernelRadius+1;
     shadow/=(total*total);
     
     return shadow;
 }
 
-float findBlocker(vec2 uv,float zReceiver,sampler2D shadowMap,float bias){
+float findBlocker(vec2 uv,float zReceiver,sampler2DArray shadowMap,float bias){
     // 遮挡者计数
     int blockers=0;
     // 遮挡者深度值累加
     float ret=0.;
     
     // 计算每个纹素的大小
-    vec2 texelSize=1./textureSize(shadowMap,0);
+    vec2 texelSize=1./textureSize(shadowMap,0).xy;
     // 遍历以当前片段为中心的BLOCK_RADIUS*2+1的区域
     for(int x=-BLOCK_RADIUS;x<=BLOCK_RADIUS;++x){
         for(int y=-BLOCK_RADIUS;y<=BLOCK_RADIUS;++y){
             // 从阴影贴图中采样深度值
-            float shadowMapDepth=texture(shadowMap,uv+vec2(x,y)*texelSize).r;
+            float shadowMapDepth=texture(shadowMap,vec3(uv+vec2(x,y)*texelSize,shadowLayer)).r;
+            ++shadowFetches;
             // 如果当前片段的深度值大于采样的深度值，则认为是遮挡者
             if(zReceiver-bias>shadowMapDepth){
                 // 累加遮挡者的深度值
@@ -366,7 +635,65 @@ float findBlocker(vec2 uv,float zReceiver,sampler2D shadowMap,float bias){
     return ret/blockers;
 }
 
-float VSM(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2D d_d2_filter){
+float findBlockerHierarchical(vec2 uv,float zReceiver,float bias){
+    // 遮挡判断的阈值：深度小于它的纹素是遮挡者
+    float threshold=zReceiver-bias;
+    // 搜索范围（阴影贴图纹素下标），与findBlocker的(2*BLOCK_RADIUS+1)^2邻域相同
+    ivec2 depthSize=textureSize(shadowMapArray,0).xy;
+    ivec2 center=ivec2(floor(uv*vec2(depthSize)));
+    ivec2 lo=center-BLOCK_RADIUS;
+    ivec2 hi=center+BLOCK_RADIUS;
+    // 超出阴影贴图的部分使用边框深度1.0，不可能是遮挡者
+    bool outside=any(lessThan(lo,ivec2(0)))||any(greaterThanEqual(hi,depthSize));
+    
+    // 粗层级：一个纹素覆盖2^(level+1)个阴影贴图纹素，选择覆盖整个搜索范围的层级，最多读取2x2个纹素
+    int coarseLevel=clamp(int(ceil(log2(float(2*BLOCK_RADIUS+1))))-1,0,shadowMinMaxLevels-1);
+    ivec2 levelSize=textureSize(shadowMinMaxArray,coarseLevel).xy;
+    ivec2 coarseLo=clamp(lo>>(coarseLevel+1),ivec2(0),levelSize-1);
+    ivec2 coarseHi=clamp(hi>>(coarseLevel+1),ivec2(0),levelSize-1);
+    float minDepth=1.;
+    float maxDepth=outside?1.:0.;
+    for(int y=coarseLo.y;y<=coarseHi.y;++y){
+        for(int x=coarseLo.x;x<=coarseHi.x;++x){
+            vec2 minMax=texelFetch(shadowMinMaxArray,ivec3(x,y,shadowLayer),coarseLevel).rg;
+            ++shadowFetches;
+            minDepth=min(minDepth,minMax.x);
+            maxDepth=max(maxDepth,minMax.y);
+        }
+    }
+    // 最近的深度都不遮挡当前片段：完全照亮
+    if(threshold<=minDepth){
+        return-1.;
+    }
+    // 最远的深度也遮挡当前片段：完全被遮挡
+    if(threshold>maxDepth){
+        return-2.;
+    }
+    
+    // 细层级：最多读取3x3个纹素，包含遮挡者的纹素取其遮挡深度范围[min, min(max, threshold)]的中点
+    int fineLevel=max(coarseLevel-1,0);
+    levelSize=textureSize(shadowMinMaxArray,fineLevel).xy;
+    ivec2 fineLo=clamp(lo>>(fineLevel+1),ivec2(0),levelSize-1);
+    ivec2 fineHi=clamp(hi>>(fineLevel+1),ivec2(0),levelSize-1);
+    float blockerDepth=0.;
+    int blockers=0;
+    for(int y=fineLo.y;y<=fineHi.y;++y){
+        for(int x=fineLo.x;x<=fineHi.x;++x){
+            vec2 minMax=texelFetch(shadowMinMaxArray,ivec3(x,y,shadowLayer),fineLevel).rg;
+            ++shadowFetches;
+            if(minMax.x<threshold){
+                blockerDepth+=.5*(minMax.x+min(minMax.y,threshold));
+                ++blockers;
+            }
+        }
+    }
+    if(blockers==0){
+        return-1.;
+    }
+    return blockerDepth/float(blockers);
+}
+
+float VSM(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2DArray d_d2_filter){
     vec3 projCoords=fragPosLightSpace.xyz/fragPosLightSpace.w;
     // [-1, 1] => [0, 1]
     projCoords=projCoords*.5+.5;
@@ -375,21 +702,145 @@ float VSM(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2D d_d2_filter
     
     depth=projCoords.z;
     
-    // 从模糊后的纹理中获得深度值均值和方差
-    d_d2=texture(d_d2_filter,projCoords.xy).rg;
-    float var=d_d2.y-d_d2.x*d_d2.x;// E(X-EX)^2 = EX^2-E^2X
+    // 从过滤后的纹理中获得深度值均值和方差（模糊后的贴图或者带mipmap的矩贴图，由纹理的过滤方式决定）
+    d_d2=texture(d_d2_filter,vec3(projCoords.xy,shadowLayer)).rg;
     
     // 偏移量，解决阴影失真的问题, 根据表面朝向光线的角度更改偏移量
     float bias=max(.05*(1.-dot(normal,lightDir)),.005);
     // float bias=.005;
+    float receiver=depth;
+    float biasedReceiver=depth-bias;
+    float minVariance=vsmMinVariance;
+    if(vsmExponent>0.){
+        // EVSM：矩是exp(c*d)的矩，接收者深度做同样的变换，最小方差按变换的导数c*exp(c*d)缩放
+        receiver=exp(vsmExponent*depth);
+        biasedReceiver=exp(vsmExponent*(depth-bias));
+        minVariance*=(vsmExponent*receiver)*(vsmExponent*receiver);
+    }
+    float var=max(d_d2.y-d_d2.x*d_d2.x,minVariance);// E(X-EX)^2 = EX^2-E^2X
     float visibility;
-    if(depth-bias<d_d2.x){
+    if(biasedReceiver<d_d2.x){
         visibility=1.;// 没有阴影
     }
     else{
         // 使用切比雪夫不等式计算阴影
-        float t_minus_mu=depth-d_d2.x;
+        float t_minus_mu=receiver-d_d2.x;
         visibility=var/(var+t_minus_mu*t_minus_mu);
     }
     return 1.-visibility;
 }
+
+float HWPCF(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir){
+    // 转换为标准齐次坐标 z[-1, 1]
+    vec3 projCoords=fragPosLightSpace.xyz/fragPosLightSpace.w;
+    // xyz: [-1, 1] -> [0, 1]
+    projCoords=projCoords*.5+.5;
+    if(projCoords.z>1.||projCoords.z<0.)
+    return 0.;
+    
+    // 从摄像机视角看到的深度值
+    currentDepth=projCoords.z;
+    // 偏移量，与PCF相同
+    float bias=max(.05*(1.-dot(normal,lightDir)),.005);
+    // 参考深度，硬件返回2x2邻域中参考深度不大于贴图深度（即未被遮挡）的比例
+    float ref=currentDepth-bias;
+    // 滤波半径
+    vec2 filterRadius=hwPCFRadius/textureSize(shadowMapArrayCompare,0).xy;
+    int taps=clamp(HW_PCF_TAPS,1,32);
+    float visibility=0.;
+    if(HW_PCF_PATTERN==0){
+        // 每个像素随机旋转泊松圆盘（interleaved gradient noise），把条带状的走样变成高频噪声
+        float angle=6.2831853*fract(52.9829189*fract(dot(gl_FragCoord.xy,vec2(.06711056,.00583715))));
+        mat2 rotation=mat2(cos(angle),sin(angle),-sin(angle),cos(angle));
+        for(int i=0;i<taps;++i){
+            vec2 offset=rotation*poissonDisk[i]*filterRadius;
+            visibility+=texture(shadowMapArrayCompare,vec4(projCoords.xy+offset,shadowLayer,ref));
+        }
+    }
+    else{
+        // 旋转网格：边长为ceil(sqrt(taps))的网格旋转atan(1/2)，采样点在水平和垂直方向上的投影互不重合
+        int gridSize=int(ceil(sqrt(float(taps))));
+        mat2 rotation=mat2(.8944272,.4472136,-.4472136,.8944272);
+        for(int i=0;i<taps;++i){
+            vec2 cell=(vec2(i%gridSize,i/gridSize)+.5)/float(gridSize)*2.-1.;
+            vec2 offset=rotation*cell*filterRadius;
+            visibility+=texture(shadowMapArrayCompare,vec4(projCoords.xy+offset,shadowLayer,ref));
+        }
+    }
+    return 1.-visibility/float(taps);
+}
+
+float ESM(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2DArray momentsMap){
+    vec3 projCoords=fragPosLightSpace.xyz/fragPosLightSpace.w;
+    // [-1, 1] => [0, 1]
+    projCoords=projCoords*.5+.5;
+    if(projCoords.z>1.||projCoords.z<0.)
+    return 0.;
+    
+    // 偏移量，与VSM相同
+    float bias=max(.05*(1.-dot(normal,lightDir)),.005);
+    // 过滤后的exp(c*遮挡物深度)
+    float occluder=texture(momentsMap,vec3(projCoords.xy,shadowLayer)).r;
+    // exp(c*(遮挡物深度-接收者深度))，遮挡物在接收者后面时大于1，即没有阴影
+    float visibility=clamp(occluder*exp(-esmExponent*(projCoords.z-bias)),0.,1.);
+    return 1.-visibility;
+}
+
+// 16位定点数存储的优化量化矩转换回原始的矩（Peters and Klein 2015），与directionLightShadowShader.fs中的量化保持一致
+vec4 msmDequantize(vec4 quantized){
+    quantized.x-=.035955884801;
+    return mat4(.2227744146,.1549679261,.1451988946,.163127443,
+        .0771972861,.1394629426,.2120202157,.2591432266,
+        .7926986636,.7963415838,.7258694464,.6539092497,
+        .0319417555,-.1722823173,-.2758014811,-.3376131734)*quantized;
+}
+
+float MSM(vec4 fragPosLightSpace,vec3 normal,vec3 lightDir,sampler2DArray momentsMap){
+    vec3 projCoords=fragPosLightSpace.xyz/fragPosLightSpace.w;
+    // [-1, 1] => [0, 1]
+    projCoords=projCoords*.5+.5;
+    if(projCoords.z>1.||projCoords.z<0.)
+    return 0.;
+    
+    // 偏移量，与VSM相同
+    float bias=max(.05*(1.-dot(normal,lightDir)),.005);
+    vec4 moments=texture(momentsMap,vec3(projCoords.xy,shadowLayer));
+    if(msmQuantized){
+        moments=msmDequantize(moments);
+    }
+    // 向均匀分布的矩偏移，保证Hankel矩阵正定
+    vec4 b=mix(moments,vec4(.5),msmMomentBias);
+    vec3 z;
+    z.x=projCoords.z-bias;
+    
+    // Hankel矩阵的Cholesky分解，只保存用得到的项
+    float L32D22=-b.x*b.y+b.z;
+    float D22=-b.x*b.x+b.y;
+    float squaredDepthVariance=-b.y*b.y+b.w;
+    float D33D22=dot(vec2(squaredDepthVariance,-L32D22),vec2(D22,L32D22));
+    float InvD22=1./D22;
+    float L32=L32D22*InvD22;
+    
+    // 求解 B*c = (1, z, z^2)
+    vec3 c=vec3(1.,z.x,z.x*z.x);
+    c.y-=b.x;
+    c.z-=b.y+L32*c.y;
+    c.y*=InvD22;
+    c.z*=D22/D33D22;
+    c.y-=L32*c.z;
+    c.x-=dot(c.yz,b.xy);
+    
+    // 求解二次方程 c.x + c.y*z + c.z*z^2 = 0 得到另外两个支撑点
+    float p=c.y/c.z;
+    float q=c.x/c.z;
+    float D=p*p*.25-q;
+    float r=sqrt(D);
+    z.y=-p*.5-r;
+    z.z=-p*.5+r;
+    
+    // 按接收者深度与支撑点的位置关系累加被遮挡的权重
+    vec4 switchVal=(z.z<z.x)?vec4(z.y,z.x,1.,1.):
+    ((z.y<z.x)?vec4(z.x,z.y,0.,1.):vec4(0.));
+    float quotient=(switchVal.x*z.z-b.x*(switchVal.x+z.z)+b.y)/((z.z-switchVal.y)*(z.x-z.y));
+    return clamp(switchVal.z+switchVal.w*quotient,0.,1.);
+}
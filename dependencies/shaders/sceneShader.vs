@@ -26,6 +26,8 @@ out mat3 TBN;
 /// uniform
 // 模型矩阵
 uniform mat4 model;
+// 法线矩阵（在CPU端预先计算 transpose(inverse(model))）
+uniform mat3 normalMatrix;
 // 视图矩阵
 uniform mat4 view;
 // 投影矩阵
@@ -33,18 +35,21 @@ uniform mat4 projection;
 // 光空间矩阵
 // uniform mat4 lightSpaceMatrix;
 
+// 深度预pass使用完全相同的表达式计算gl_Position，声明为invariant保证两个pass的深度逐位相同，主pass可以使用GL_EQUAL
+invariant gl_Position;
+
 void main()
 {
     gl_Position=projection*view*model*vec4(aPos,1.);
     
-    Normal=mat3(transpose(inverse(model)))*aNormal;
+    Normal=normalMatrix*aNormal;
     FragPos=vec3(model*vec4(aPos,1.));
     TexCoords=vec2(aTexCoords.x,aTexCoords.y);
     
     // 计算TBN矩阵
     vec3 T=normalize(vec3(model*vec4(aTangent,0.)));
     vec3 B=normalize(vec3(model*vec4(aBitangent,0.)));
-    vec3 N=normalize(vec3(model*vec4(aNormal,0.)));
+    vec3 N=normalize(normalMatrix*aNormal);
     TBN=mat3(T,B,N);
     
     // FragPosLightSpace=lightSpaceMatrix*vec4(FragPos,1.);
@@ -0,0 +1,34 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// 内部渲染目标的颜色和深度（只有左下角的渲染分辨率区域有效）
+uniform sampler2D sceneColor;
+uniform sampler2D sceneDepth;
+// 渲染分辨率与内部渲染目标大小的比例
+uniform vec2 uvScale;
+// 锐化强度，0为双线性过滤
+uniform float sharpness;
+
+void main()
+{
+    vec2 texelSize=1./vec2(textureSize(sceneColor,0));
+    // 限制在有效区域内，双线性过滤不会采样到区域之外的像素
+    vec2 uv=clamp(TexCoords*uvScale,texelSize*.5,uvScale-texelSize*.5);
+    vec3 color=texture(sceneColor,uv).rgb;
+    if(sharpness>0.){
+        // 十字形邻域的反锐化掩模，结果限制在邻域的最小/最大值之间，避免边缘出现光晕
+        vec3 north=texture(sceneColor,uv+vec2(0.,texelSize.y)).rgb;
+        vec3 south=texture(sceneColor,uv-vec2(0.,texelSize.y)).rgb;
+        vec3 east=texture(sceneColor,uv+vec2(texelSize.x,0.)).rgb;
+        vec3 west=texture(sceneColor,uv-vec2(texelSize.x,0.)).rgb;
+        vec3 minColor=min(color,min(min(north,south),min(east,west)));
+        vec3 maxColor=max(color,max(max(north,south),max(east,west)));
+        vec3 sharpened=color+sharpness*(4.*color-north-south-east-west)*.25;
+        color=clamp(sharpened,minColor,maxColor);
+    }
+    FragColor=vec4(color,1.);
+    // 写入场景的深度，之后的天空盒可以正常做深度测试
+    gl_FragDepth=texture(sceneDepth,uv).r;
+}
@@ -6,8 +6,10 @@ in vec2 TexCoords;
 // 输出颜色
 out vec4 FragColor;
 
-// 深度纹理
-uniform sampler2D d_d2;
+// 深度纹理（每层对应一个级联）
+uniform sampler2DArray d_d2;
+// 当前处理的级联
+uniform int layer;
 // 决定模糊操作的方向，true表示垂直方向模糊，false表示水平方向模糊
 uniform bool vertical;
 
@@ -17,17 +19,17 @@ uniform bool vertical;
 #define TOTAL_SAMPLES 11
 
 void main(){
-    // 初始化累积值，存储深度和深度平方的总和
-    vec2 d=vec2(0,0);
+    // 初始化累积值，存储深度和深度平方的总和（ESM只有第一个通道，MSM有4个通道，所有通道一起模糊）
+    vec4 d=vec4(0);
     // 计算纹素的大小
-    vec2 texelSize=1./textureSize(d_d2,0);
+    vec2 texelSize=1./textureSize(d_d2,0).xy;
     if(vertical){
         // 垂直方向模糊
         // 垂直方向上一个纹素的大小
         float r=texelSize.y;
         for(int i=-R;i<=R;++i){
             // 在垂直方向上采样，并累加深度值和深度平方值
-            d+=texture(d_d2,vec2(TexCoords.x,TexCoords.y+i*r)).rg;
+            d+=texture(d_d2,vec3(TexCoords.x,TexCoords.y+i*r,layer));
         }
     }else{
         // 水平方向模糊
@@ -35,11 +37,11 @@ void main(){
         float r=texelSize.x;
         for(int i=-R;i<=R;++i){
             // 在水平方向上采样，并累加深度值和深度平方值
-            d+=texture(d_d2,vec2(TexCoords.x+i*r,TexCoords.y)).rg;
+            d+=texture(d_d2,vec3(TexCoords.x+i*r,TexCoords.y,layer));
         }
     }
     // 计算平均值，将累积的深度值和深度平方值除以采样点总数
-    FragColor.rg=d/TOTAL_SAMPLES;
+    FragColor=d/TOTAL_SAMPLES;
     // DEBUG：原始纹理值
-    // FragColor = vec4(texture(d_d2, TexCoords).rgb, 1.0);
+    // FragColor = vec4(texture(d_d2, vec3(TexCoords, layer)).rgb, 1.0);
 }
\ No newline at end of file
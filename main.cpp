@@ -1,21 +1,58 @@
+#include <cstring>
 #include "utils/WindowFactory.h"
 #include "utils/Scene.h"
 #include "utils/SkyBox.h"
+#include "utils/HeadlessBenchmark.h"
+#include "utils/RegressionHarness.h"
+
+/// @brief 获取命令行中某个参数后面的值
+/// @return 没有这个参数时返回NULL
+static const char* getArgumentValue(int argc, char** argv, const char* name) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::strcmp(argv[i], name) == 0) {
+            return argv[i + 1];
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    // 离屏基准测试：不创建窗口，渲染固定数量的帧后输出统计
+    if (isHeadlessBenchmarkRequested(argc, argv)) {
+        return runHeadlessBenchmark(parseHeadlessBenchmarkOptions(argc, argv));
+    }
+    // 图像和性能回归测试：离屏渲染固定视角，与基准图像和基准耗时比较
+    if (isRegressionRequested(argc, argv)) {
+        return runRegression(parseRegressionOptions(argc, argv));
+    }
 
-int main() {
     // 创建一个窗口Factory对象
     GLFWWindowFactory myWindow(800, 600, "地球仪");
+    // --record录制每帧的摄像机姿态和按键，--replay按固定的时间步长回放录制的输入
+    if (const char* recordFile = getArgumentValue(argc, argv, "--record")) {
+        myWindow.startInputRecording(recordFile);
+    }
+    if (const char* replayFile = getArgumentValue(argc, argv, "--replay")) {
+        myWindow.startInputReplay(replayFile);
+    }
     // 创建一个地球仪模型对象
     Scene tellurion(&myWindow);
     // 创建一个天空盒对象
     SkyBox skyBox(&myWindow);
 
-    // 运行窗口，传入一个lambda表达式，用于自定义渲染逻辑
-    myWindow.run([&]() {
+    // 运行窗口，传入两个lambda表达式：模拟（主线程）和渲染（拥有上下文的线程）
+    myWindow.run([&](FrameSnapshot& frame) {
+        // 模拟地球仪场景
+        tellurion.simulate(frame);
+        }, [&]() {
         // 绘制地球仪
         tellurion.draw();
         // 绘制天空盒
         skyBox.draw();
+        }, [&]() {
+        // 释放OpenGL对象（上下文销毁之前）
+        tellurion.release();
+        skyBox.release();
         });
     return 0;
 }
\ No newline at end of file
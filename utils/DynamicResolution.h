@@ -0,0 +1,78 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+// 定义了DynamicResolution类，按测量的GPU帧时间调整渲染分辨率的缩放，使帧时间保持在预算之内
+// 帧时间超出预算时立即按面积比例降低分辨率，低于预算较多时缓慢提高；每次调整后等待几帧，
+// 因为计时查询的结果比CPU落后几帧，立即再次调整会造成振荡
+
+#include <algorithm>
+#include <cmath>
+
+class DynamicResolution {
+public:
+    DynamicResolution() {}
+
+    /// @brief 构造函数
+    /// @param budgetMs 帧时间预算（ms）
+    /// @param minScale 最小缩放（每个方向）
+    /// @param maxScale 最大缩放（每个方向）
+    /// @param settleFrames 每次调整后等待的帧数（不小于计时查询落后的帧数）
+    DynamicResolution(float budgetMs, float minScale, float maxScale, int settleFrames) :
+        budgetMs(budgetMs), minScale(minScale), maxScale(maxScale), settleFrames(settleFrames), scale(maxScale) {}
+
+    /// @brief 输入一帧的GPU耗时，返回新的缩放
+    /// @param gpuMs 最近一次可用的GPU帧时间（ms），0表示还没有结果
+    float update(float gpuMs) {
+        if (gpuMs <= 0.0f) {
+            return this->scale;
+        }
+        // 指数滑动平均，过滤单帧的抖动；超出预算的帧直接计入，尽快响应
+        this->smoothedMs = this->smoothedMs <= 0.0f ? gpuMs : this->smoothedMs + SMOOTHING * (gpuMs - this->smoothedMs);
+        float measuredMs = std::max(this->smoothedMs, gpuMs > this->budgetMs ? gpuMs : 0.0f);
+        if (this->cooldown > 0) {
+            this->cooldown--;
+            return this->scale;
+        }
+        // 目标留出一部分余量，在[下界, 目标]之间不调整（滞回）
+        float targetMs = this->budgetMs * HEADROOM;
+        if (measuredMs > targetMs || measuredMs < targetMs * LOWER_BAND) {
+            // GPU耗时大致与像素数量（缩放的平方）成正比
+            float ratio = std::sqrt(targetMs / measuredMs);
+            // 降低时一次最多降低25%，提高时一次最多提高5%
+            ratio = std::clamp(ratio, 0.75f, 1.05f);
+            float newScale = std::clamp(this->scale * ratio, this->minScale, this->maxScale);
+            // 按1/64量化，避免细微的变化
+            newScale = std::round(newScale * 64.0f) / 64.0f;
+            if (newScale != this->scale) {
+                this->scale = newScale;
+                this->cooldown = this->settleFrames;
+            }
+        }
+        return this->scale;
+    }
+
+    /// @brief 当前缩放
+    float getScale() const { return this->scale; }
+    /// @brief 平滑后的GPU帧时间（ms）
+    float getSmoothedMs() const { return this->smoothedMs; }
+    /// @brief 帧时间预算（ms）
+    float getBudgetMs() const { return this->budgetMs; }
+
+private:
+    // 目标帧时间占预算的比例
+    static constexpr float HEADROOM = 0.9f;
+    // 帧时间低于目标的这个比例时提高分辨率
+    static constexpr float LOWER_BAND = 0.75f;
+    // 滑动平均的系数
+    static constexpr float SMOOTHING = 0.1f;
+
+    float budgetMs = 16.0f;
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    int settleFrames = 4;
+    float scale = 1.0f;
+    float smoothedMs = 0.0f;
+    int cooldown = 0;
+};
+
+#endif // DYNAMIC_RESOLUTION_H
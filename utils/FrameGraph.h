@@ -0,0 +1,446 @@
+#ifndef FRAME_GRAPH_H
+#define FRAME_GRAPH_H
+
+// 定义了TransientTexturePool和FrameGraph，管理每帧临时使用的渲染目标
+// 每帧先声明所有pass以及它们创建、读取和写入的资源，编译时剔除输出没有被使用的pass，并计算每个临时资源从第一次到最后一次使用的pass区间
+// 执行时临时资源在第一次使用之前从池中取出，在最后一次使用之后还给池，之后的pass可以复用格式和大小相同的纹理（OpenGL 3.3不能让不同格式的资源共用显存，复用以纹理为单位）
+// 池中的纹理跨帧保留，连续若干帧没有使用时才删除，尺寸不变时每帧不会重新分配
+// 导入的资源（阴影贴图等跨帧保留的渲染目标、默认帧缓冲）由调用者管理，写入导入资源的pass不会被剔除
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "GpuResources.h"
+
+// 临时纹理的描述，描述完全相同的纹理才能复用
+struct FrameGraphTextureDesc {
+    // GL_TEXTURE_2D或GL_TEXTURE_2D_ARRAY
+    GLenum target = GL_TEXTURE_2D;
+    int width = 1;
+    int height = 1;
+    // 纹理数组的层数
+    int layers = 1;
+    GLenum internalFormat = GL_RGBA8;
+    // 缩小和放大的过滤方式（环绕方式固定为GL_CLAMP_TO_EDGE）
+    GLenum filter = GL_NEAREST;
+
+    bool operator==(const FrameGraphTextureDesc& other) const {
+        return this->target == other.target && this->width == other.width && this->height == other.height && this->layers == other.layers
+            && this->internalFormat == other.internalFormat && this->filter == other.filter;
+    }
+
+    /// @brief 按内部格式计算的大小（字节）
+    unsigned long long getBytes() const {
+        return (unsigned long long)this->width * this->height * this->layers * GpuResources::getBytesPerPixel(this->internalFormat);
+    }
+};
+
+class TransientTexturePool {
+public:
+    /// @param maxIdleFrames 纹理连续多少帧没有使用时删除
+    explicit TransientTexturePool(unsigned int maxIdleFrames = 60) : maxIdleFrames(maxIdleFrames) {}
+
+    /// @brief 取出一个符合描述的空闲纹理，没有时创建
+    /// @param desc 纹理描述
+    /// @param label 新建纹理时在显存统计中使用的名称
+    /// @return 纹理ID
+    GLuint acquire(const FrameGraphTextureDesc& desc, const char* label) {
+        for (auto& entry : this->entries) {
+            if (!entry.inUse && entry.desc == desc) {
+                entry.inUse = true;
+                entry.lastUsedFrame = this->frame;
+                return entry.texture;
+            }
+        }
+        Entry entry;
+        entry.desc = desc;
+        entry.texture = createTexture(desc, label);
+        entry.inUse = true;
+        entry.lastUsedFrame = this->frame;
+        this->entries.push_back(entry);
+        return entry.texture;
+    }
+
+    /// @brief 把纹理还给池，之后可以被其他资源复用
+    void release(GLuint texture) {
+        for (auto& entry : this->entries) {
+            if (entry.texture == texture) {
+                entry.inUse = false;
+                entry.lastUsedFrame = this->frame;
+                return;
+            }
+        }
+    }
+
+    /// @brief 结束一帧，删除连续maxIdleFrames帧没有使用的纹理（例如窗口大小改变之后旧尺寸的纹理）
+    void endFrame() {
+        this->frame++;
+        for (size_t i = 0; i < this->entries.size();) {
+            Entry& entry = this->entries[i];
+            if (!entry.inUse && this->frame - entry.lastUsedFrame > this->maxIdleFrames) {
+                GpuResources::deleteTexture(entry.texture);
+                this->entries.erase(this->entries.begin() + i);
+            }
+            else {
+                ++i;
+            }
+        }
+    }
+
+    /// @brief 删除池中的所有纹理（在上下文销毁之前调用）
+    void clear() {
+        for (auto& entry : this->entries) {
+            GpuResources::deleteTexture(entry.texture);
+        }
+        this->entries.clear();
+    }
+
+    /// @brief 池中所有纹理的大小（字节）
+    unsigned long long getAllocatedBytes() const {
+        unsigned long long bytes = 0;
+        for (const auto& entry : this->entries) {
+            bytes += entry.desc.getBytes();
+        }
+        return bytes;
+    }
+
+    /// @brief 池中纹理的数量
+    size_t getTextureCount() const {
+        return this->entries.size();
+    }
+
+private:
+    struct Entry {
+        FrameGraphTextureDesc desc;
+        GLuint texture = 0;
+        bool inUse = false;
+        // 最后一次取出或者归还的帧
+        unsigned long long lastUsedFrame = 0;
+    };
+    std::vector<Entry> entries;
+    unsigned long long frame = 0;
+    unsigned int maxIdleFrames;
+
+    static GLuint createTexture(const FrameGraphTextureDesc& desc, const char* label) {
+        GLuint texture = GpuResources::createTexture(desc.target, label, "FrameGraph");
+        // 分配存储时不上传数据，格式和类型只需要与内部格式兼容
+        bool depth = desc.internalFormat == GL_DEPTH_COMPONENT || desc.internalFormat == GL_DEPTH_COMPONENT16
+            || desc.internalFormat == GL_DEPTH_COMPONENT24 || desc.internalFormat == GL_DEPTH_COMPONENT32 || desc.internalFormat == GL_DEPTH_COMPONENT32F;
+        bool depthStencil = desc.internalFormat == GL_DEPTH24_STENCIL8 || desc.internalFormat == GL_DEPTH32F_STENCIL8;
+        GLenum format = depthStencil ? GL_DEPTH_STENCIL : (depth ? GL_DEPTH_COMPONENT : GL_RGBA);
+        GLenum type = depthStencil ? GL_UNSIGNED_INT_24_8 : GL_FLOAT;
+        glBindTexture(desc.target, texture);
+        if (desc.target == GL_TEXTURE_2D_ARRAY) {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, desc.internalFormat, desc.width, desc.height, desc.layers, 0, format, type, NULL);
+        }
+        else {
+            glTexImage2D(GL_TEXTURE_2D, 0, desc.internalFormat, desc.width, desc.height, 0, format, type, NULL);
+        }
+        glTexParameteri(desc.target, GL_TEXTURE_MIN_FILTER, desc.filter);
+        glTexParameteri(desc.target, GL_TEXTURE_MAG_FILTER, desc.filter);
+        glTexParameteri(desc.target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(desc.target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(desc.target, 0);
+        return texture;
+    }
+};
+
+class FrameGraph {
+public:
+    // 资源句柄（资源数组的下标）
+    typedef int Resource;
+    static const Resource INVALID_RESOURCE = -1;
+
+    // 一帧的统计
+    struct Stats {
+        // 声明的pass数量和被剔除的pass数量
+        size_t passes = 0;
+        size_t culledPasses = 0;
+        // 被剔除的pass名称，以空格分隔
+        std::string culledPassNames;
+        // 声明的临时资源数量，以及剔除之后实际使用的数量
+        size_t declaredResources = 0;
+        size_t usedResources = 0;
+        // 所有声明的临时资源的大小（每个资源单独常驻时的大小）
+        unsigned long long declaredBytes = 0;
+        // 剔除之后、复用之前的大小
+        unsigned long long usedBytes = 0;
+        // 执行时同时存在的临时资源的最大大小（复用之后）
+        unsigned long long peakBytes = 0;
+        // 执行结束时池中所有纹理的大小
+        unsigned long long pooledBytes = 0;
+    };
+
+    // 声明pass时使用，记录pass对资源的使用方式
+    class Builder {
+    public:
+        /// @brief 创建一个临时纹理，由这个pass写入
+        Resource create(const std::string& name, const FrameGraphTextureDesc& desc) {
+            Resource resource = this->graph.addResource(name, desc, false, 0);
+            this->graph.passes[this->pass].writes.push_back(resource);
+            return resource;
+        }
+
+        /// @brief 声明这个pass读取资源
+        Resource read(Resource resource) {
+            if (resource != INVALID_RESOURCE) {
+                this->graph.passes[this->pass].reads.push_back(resource);
+            }
+            return resource;
+        }
+
+        /// @brief 声明这个pass写入资源（创建的资源已经是写入）
+        Resource write(Resource resource) {
+            if (resource != INVALID_RESOURCE) {
+                this->graph.passes[this->pass].writes.push_back(resource);
+            }
+            return resource;
+        }
+
+        /// @brief 声明这个pass有图之外的效果（例如调试输出），不会被剔除
+        void sideEffect() {
+            this->graph.passes[this->pass].sideEffect = true;
+        }
+
+    private:
+        friend class FrameGraph;
+        Builder(FrameGraph& graph, size_t pass) : graph(graph), pass(pass) {}
+        FrameGraph& graph;
+        size_t pass;
+    };
+
+    // 执行pass时使用，查询资源对应的纹理
+    class Resources {
+    public:
+        /// @brief 资源对应的纹理ID（导入的资源为导入时的ID）
+        GLuint getTexture(Resource resource) const {
+            return resource == INVALID_RESOURCE ? 0 : this->graph.resources[resource].texture;
+        }
+
+        /// @brief 资源的描述
+        const FrameGraphTextureDesc& getDesc(Resource resource) const {
+            return this->graph.resources[resource].desc;
+        }
+
+    private:
+        friend class FrameGraph;
+        explicit Resources(const FrameGraph& graph) : graph(graph) {}
+        const FrameGraph& graph;
+    };
+
+    explicit FrameGraph(TransientTexturePool* pool = nullptr) : pool(pool) {}
+
+    /// @brief 设置临时纹理池
+    void setPool(TransientTexturePool* pool) { this->pool = pool; }
+
+    /// @brief 清空上一帧声明的pass和资源
+    void reset() {
+        this->passes.clear();
+        this->resources.clear();
+        this->compiled = false;
+    }
+
+    /// @brief 导入一个由调用者管理的纹理（跨帧保留的渲染目标），ID为0表示默认帧缓冲
+    Resource importTexture(const std::string& name, GLuint texture) {
+        return addResource(name, FrameGraphTextureDesc(), true, texture);
+    }
+
+    /// @brief 声明一个pass
+    /// @param name 名称
+    /// @param setup 声明阶段立即调用，通过Builder声明创建、读取和写入的资源
+    /// @param execute 执行阶段按声明的顺序调用（被剔除的pass不调用）
+    void addPass(const std::string& name, const std::function<void(Builder&)>& setup, std::function<void(const Resources&)> execute) {
+        Pass pass;
+        pass.name = name;
+        pass.execute = std::move(execute);
+        this->passes.push_back(std::move(pass));
+        Builder builder(*this, this->passes.size() - 1);
+        setup(builder);
+        this->compiled = false;
+    }
+
+    /// @brief 剔除没有用的pass，计算临时资源的生存区间
+    void compile() {
+        // 引用计数：pass被写入的资源数量，资源被读取的pass数量
+        std::vector<int> passRefs(this->passes.size(), 0);
+        std::vector<int> resourceRefs(this->resources.size(), 0);
+        std::vector<std::vector<size_t>> producers(this->resources.size());
+        for (size_t p = 0; p < this->passes.size(); ++p) {
+            Pass& pass = this->passes[p];
+            pass.culled = false;
+            passRefs[p] = (int)pass.writes.size();
+            for (Resource resource : pass.writes) {
+                producers[resource].push_back(p);
+            }
+            for (Resource resource : pass.reads) {
+                resourceRefs[resource]++;
+            }
+        }
+
+        // 从没有被读取的临时资源出发，依次剔除所有输出都没有被读取的pass（导入的资源视为总是被读取）
+        std::vector<Resource> unused;
+        for (size_t r = 0; r < this->resources.size(); ++r) {
+            if (!this->resources[r].imported && resourceRefs[r] == 0) {
+                unused.push_back((Resource)r);
+            }
+        }
+        auto cullPass = [&](size_t p) {
+            this->passes[p].culled = true;
+            for (Resource resource : this->passes[p].reads) {
+                if (--resourceRefs[resource] == 0 && !this->resources[resource].imported) {
+                    unused.push_back(resource);
+                }
+            }
+        };
+        // 不写入任何资源的pass
+        for (size_t p = 0; p < this->passes.size(); ++p) {
+            if (passRefs[p] == 0 && !this->passes[p].sideEffect) {
+                cullPass(p);
+            }
+        }
+        while (!unused.empty()) {
+            Resource resource = unused.back();
+            unused.pop_back();
+            for (size_t p : producers[resource]) {
+                if (!this->passes[p].culled && --passRefs[p] == 0 && !this->passes[p].sideEffect) {
+                    cullPass(p);
+                }
+            }
+        }
+
+        // 临时资源的生存区间：第一次和最后一次使用它的（没有被剔除的）pass
+        for (auto& resource : this->resources) {
+            resource.firstPass = resource.lastPass = -1;
+        }
+        for (size_t p = 0; p < this->passes.size(); ++p) {
+            if (this->passes[p].culled) {
+                continue;
+            }
+            auto use = [&](Resource r) {
+                Entry& resource = this->resources[r];
+                if (resource.firstPass < 0) {
+                    resource.firstPass = (int)p;
+                }
+                resource.lastPass = (int)p;
+            };
+            for (Resource resource : this->passes[p].reads) {
+                use(resource);
+            }
+            for (Resource resource : this->passes[p].writes) {
+                use(resource);
+            }
+        }
+
+        this->stats = Stats();
+        this->stats.passes = this->passes.size();
+        for (const auto& pass : this->passes) {
+            if (pass.culled) {
+                this->stats.culledPasses++;
+                this->stats.culledPassNames += (this->stats.culledPassNames.empty() ? "" : " ") + pass.name;
+            }
+        }
+        for (const auto& resource : this->resources) {
+            if (resource.imported) {
+                continue;
+            }
+            this->stats.declaredResources++;
+            this->stats.declaredBytes += resource.desc.getBytes();
+            if (resource.firstPass >= 0) {
+                this->stats.usedResources++;
+                this->stats.usedBytes += resource.desc.getBytes();
+            }
+        }
+        this->compiled = true;
+    }
+
+    /// @brief 按声明的顺序执行没有被剔除的pass，临时资源在第一次使用之前从池中取出，在最后一次使用之后归还
+    void execute() {
+        if (!this->compiled) {
+            compile();
+        }
+        if (this->pool == nullptr) {
+            std::cout << "[frame graph] no transient texture pool" << std::endl;
+            return;
+        }
+        Resources view(*this);
+        unsigned long long liveBytes = 0;
+        for (size_t p = 0; p < this->passes.size(); ++p) {
+            Pass& pass = this->passes[p];
+            if (pass.culled) {
+                continue;
+            }
+            for (auto& resource : this->resources) {
+                if (!resource.imported && resource.firstPass == (int)p) {
+                    resource.texture = this->pool->acquire(resource.desc, resource.name.c_str());
+                    liveBytes += resource.desc.getBytes();
+                }
+            }
+            this->stats.peakBytes = std::max(this->stats.peakBytes, liveBytes);
+            pass.execute(view);
+            for (auto& resource : this->resources) {
+                if (!resource.imported && resource.lastPass == (int)p) {
+                    this->pool->release(resource.texture);
+                    liveBytes -= resource.desc.getBytes();
+                }
+            }
+        }
+        this->pool->endFrame();
+        this->stats.pooledBytes = this->pool->getAllocatedBytes();
+    }
+
+    /// @brief 最近一次编译和执行的统计
+    const Stats& getStats() const {
+        return this->stats;
+    }
+
+    /// @brief 输出最近一帧的统计：剔除的pass、所有临时资源单独常驻时的大小、剔除之后的大小、复用之后的峰值和池的大小
+    void printStats() const {
+        const double MB = 1024.0 * 1024.0;
+        std::cout << "[frame graph] " << this->stats.passes << " passes, " << this->stats.culledPasses << " culled"
+            << (this->stats.culledPassNames.empty() ? "" : " (" + this->stats.culledPassNames + ")")
+            << "; transient targets: " << this->stats.declaredResources << " declared " << this->stats.declaredBytes / MB << " MB, "
+            << this->stats.usedResources << " used " << this->stats.usedBytes / MB << " MB, peak " << this->stats.peakBytes / MB
+            << " MB after aliasing, pool " << this->stats.pooledBytes / MB << " MB" << std::endl;
+    }
+
+private:
+    struct Pass {
+        std::string name;
+        std::function<void(const Resources&)> execute;
+        std::vector<Resource> reads;
+        std::vector<Resource> writes;
+        bool sideEffect = false;
+        bool culled = false;
+    };
+    struct Entry {
+        std::string name;
+        FrameGraphTextureDesc desc;
+        // 导入的资源不由池管理，也不会被剔除
+        bool imported = false;
+        GLuint texture = 0;
+        // 生存区间（pass序号），-1表示没有被使用
+        int firstPass = -1;
+        int lastPass = -1;
+    };
+
+    TransientTexturePool* pool;
+    std::vector<Pass> passes;
+    std::vector<Entry> resources;
+    bool compiled = false;
+    Stats stats;
+
+    Resource addResource(const std::string& name, const FrameGraphTextureDesc& desc, bool imported, GLuint texture) {
+        Entry entry;
+        entry.name = name;
+        entry.desc = desc;
+        entry.imported = imported;
+        entry.texture = texture;
+        this->resources.push_back(entry);
+        return (Resource)this->resources.size() - 1;
+    }
+};
+
+#endif // FRAME_GRAPH_H
@@ -0,0 +1,221 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+// 定义了FramePacer类，控制帧的节奏：垂直同步/自适应同步、可选的帧率上限，以及用glFenceSync限制CPU领先GPU的帧数
+// 每帧开始时先等待，等待结束后再采样输入和时间，这样提交给GPU的帧使用的是尽量新的输入
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+class FramePacer {
+public:
+    // 交换缓冲区的同步方式
+    enum SwapMode {
+        // 不等待垂直同步
+        SWAP_IMMEDIATE = 0,
+        // 垂直同步
+        SWAP_VSYNC = 1,
+        // 自适应同步：按时完成的帧等待垂直同步，错过的帧立即交换（需要*_EXT_swap_control_tear，不支持时回退到垂直同步）
+        SWAP_ADAPTIVE = 2,
+    };
+    // 允许同时在GPU上的最大帧数
+    static const int MAX_FENCES = 4;
+    // 帧时间统计的窗口大小（帧）
+    static const int HISTORY_SIZE = 256;
+    // 帧率上限的等待中，最后这段时间（ms）不用sleep而是让出时间片，sleep的精度通常只有1ms左右（Windows默认更差）
+    static constexpr double SPIN_MARGIN_MS = 2.0;
+
+    FramePacer() {}
+
+    /// @brief 构造函数（需要在创建上下文之后调用）
+    /// @param swapMode 交换缓冲区的同步方式
+    /// @param frameRateLimit 帧率上限，0为不限制
+    /// @param maxFramesInFlight 允许CPU领先GPU的帧数，0为不限制
+    FramePacer(SwapMode swapMode, float frameRateLimit, int maxFramesInFlight) {
+        setSwapMode(swapMode);
+        setFrameRateLimit(frameRateLimit);
+        this->maxFramesInFlight = std::min(std::max(maxFramesInFlight, 0), MAX_FENCES);
+        this->lastFrameStart = std::chrono::steady_clock::now();
+    }
+
+    /// @brief 设置交换缓冲区的同步方式（需要当前上下文）
+    /// @param swapMode 同步方式
+    void setSwapMode(SwapMode swapMode) {
+        if (swapMode == SWAP_ADAPTIVE && !glfwExtensionSupported("WGL_EXT_swap_control_tear") && !glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+            std::cout << "[frame pacing] adaptive sync is not supported, falling back to vsync" << std::endl;
+            swapMode = SWAP_VSYNC;
+        }
+        this->swapMode = swapMode;
+        glfwSwapInterval(swapMode == SWAP_ADAPTIVE ? -1 : (swapMode == SWAP_VSYNC ? 1 : 0));
+    }
+
+    /// @brief 设置帧率上限
+    /// @param frameRateLimit 帧率上限，0为不限制
+    void setFrameRateLimit(float frameRateLimit) {
+        this->frameRateLimit = std::max(frameRateLimit, 0.0f);
+    }
+
+    /// @brief 开始一帧：等待GPU追上（最多maxFramesInFlight帧在GPU上），再按帧率上限等待，然后记录帧时间
+    void beginFrame() {
+        auto waitStart = std::chrono::steady_clock::now();
+        // 等待最旧的一帧完成，之后提交的命令不会再排在更多的帧后面
+        if (this->maxFramesInFlight > 0 && (int)this->fenceCount >= this->maxFramesInFlight) {
+            GLsync fence = this->fences[this->fenceHead];
+            GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+            while (result == GL_TIMEOUT_EXPIRED) {
+                result = glClientWaitSync(fence, 0, FENCE_TIMEOUT_NS);
+            }
+            glDeleteSync(fence);
+            this->fenceHead = (this->fenceHead + 1) % MAX_FENCES;
+            this->fenceCount--;
+        }
+        auto fenceDone = std::chrono::steady_clock::now();
+
+        // 帧率上限：先sleep到截止时间前一小段，剩下的时间让出时间片直到截止时间
+        if (this->frameRateLimit > 0.0f) {
+            auto deadline = this->lastFrameStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(1.0 / this->frameRateLimit));
+            auto sleepUntil = deadline - std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double, std::milli>(SPIN_MARGIN_MS));
+            if (std::chrono::steady_clock::now() < sleepUntil) {
+                std::this_thread::sleep_until(sleepUntil);
+            }
+            while (std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::yield();
+            }
+        }
+        auto frameStart = std::chrono::steady_clock::now();
+
+        // 记录统计数据
+        this->fenceWaitMs += std::chrono::duration<double, std::milli>(fenceDone - waitStart).count();
+        this->limiterWaitMs += std::chrono::duration<double, std::milli>(frameStart - fenceDone).count();
+        float frameMs = (float)std::chrono::duration<double, std::milli>(frameStart - this->lastFrameStart).count();
+        if (this->started) {
+            this->history[this->historyIndex] = frameMs;
+            this->historyIndex = (this->historyIndex + 1) % HISTORY_SIZE;
+            this->historySize = std::min(this->historySize + 1, (unsigned int)HISTORY_SIZE);
+            this->sampleCount++;
+        }
+        this->started = true;
+        this->lastFrameStart = frameStart;
+    }
+
+    /// @brief 结束一帧（在交换缓冲区之后调用）：插入栅栏，标记这一帧的所有命令
+    void endFrame() {
+        if (this->maxFramesInFlight <= 0) {
+            return;
+        }
+        int tail = (this->fenceHead + this->fenceCount) % MAX_FENCES;
+        this->fences[tail] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        this->fenceCount++;
+    }
+
+    /// @brief 获取最近若干帧的平均帧时间（ms）
+    float getAverageFrameMs() const {
+        if (this->historySize == 0) {
+            return 0.0f;
+        }
+        double total = 0.0;
+        for (unsigned int i = 0; i < this->historySize; i++) {
+            total += this->history[i];
+        }
+        return (float)(total / this->historySize);
+    }
+
+    /// @brief 获取最近若干帧的帧时间百分位数（ms），例如0.99为99%的帧不超过的帧时间
+    /// @param percentile 百分位，0~1
+    float getPercentileFrameMs(float percentile) const {
+        if (this->historySize == 0) {
+            return 0.0f;
+        }
+        std::vector<float> sorted(this->history, this->history + this->historySize);
+        size_t k = std::min((size_t)(percentile * (sorted.size() - 1) + 0.5f), sorted.size() - 1);
+        std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+        return sorted[k];
+    }
+
+    /// @brief 获取最近若干帧中最长的帧时间（ms）
+    float getMaxFrameMs() const {
+        return this->historySize > 0 ? *std::max_element(this->history, this->history + this->historySize) : 0.0f;
+    }
+
+    /// @brief 获取自上次reset以来每帧等待GPU（栅栏）的平均时间（ms）
+    float getAverageFenceWaitMs() const {
+        return this->sampleCount > 0 ? (float)(this->fenceWaitMs / this->sampleCount) : 0.0f;
+    }
+
+    /// @brief 获取自上次reset以来每帧因帧率上限等待的平均时间（ms）
+    float getAverageLimiterWaitMs() const {
+        return this->sampleCount > 0 ? (float)(this->limiterWaitMs / this->sampleCount) : 0.0f;
+    }
+
+    /// @brief 获取自上次reset以来的帧数
+    unsigned int getSampleCount() const {
+        return this->sampleCount;
+    }
+
+    /// @brief 获取当前的同步方式
+    SwapMode getSwapMode() const {
+        return this->swapMode;
+    }
+
+    /// @brief 获取帧率上限，0为不限制
+    float getFrameRateLimit() const {
+        return this->frameRateLimit;
+    }
+
+    /// @brief 获取允许CPU领先GPU的帧数，0为不限制
+    int getMaxFramesInFlight() const {
+        return this->maxFramesInFlight;
+    }
+
+    /// @brief 清空等待时间的统计（帧时间历史保留）
+    void reset() {
+        this->fenceWaitMs = 0.0;
+        this->limiterWaitMs = 0.0;
+        this->sampleCount = 0;
+    }
+
+    /// @brief 释放还没有等待的栅栏
+    void release() {
+        for (unsigned int i = 0; i < this->fenceCount; i++) {
+            glDeleteSync(this->fences[(this->fenceHead + i) % MAX_FENCES]);
+        }
+        this->fenceHead = 0;
+        this->fenceCount = 0;
+    }
+
+private:
+    // 每次等待栅栏的超时时间（ns），超时后继续等待，只是避免驱动一直阻塞在一次调用中
+    static const GLuint64 FENCE_TIMEOUT_NS = 100000000;
+
+    // 交换缓冲区的同步方式
+    SwapMode swapMode = SWAP_VSYNC;
+    // 帧率上限，0为不限制
+    float frameRateLimit = 0.0f;
+    // 允许CPU领先GPU的帧数，0为不限制
+    int maxFramesInFlight = 0;
+    // 还在GPU上的帧的栅栏（环形队列）
+    GLsync fences[MAX_FENCES] = { 0 };
+    int fenceHead = 0;
+    unsigned int fenceCount = 0;
+    // 上一帧开始（等待结束）的时间
+    std::chrono::steady_clock::time_point lastFrameStart;
+    // 是否已经开始过一帧（第一帧没有帧时间）
+    bool started = false;
+    // 最近若干帧的帧时间（ms）
+    float history[HISTORY_SIZE] = { 0.0f };
+    int historyIndex = 0;
+    unsigned int historySize = 0;
+    // 自上次reset以来的等待时间和帧数
+    double fenceWaitMs = 0.0;
+    double limiterWaitMs = 0.0;
+    unsigned int sampleCount = 0;
+};
+
+#endif // FRAME_PACER_H
@@ -0,0 +1,48 @@
+#ifndef FRAME_SNAPSHOT_H
+#define FRAME_SNAPSHOT_H
+
+// 定义了FrameSnapshot结构体，主线程（事件、输入和场景模拟）每帧生成一份，渲染线程只读取这一份数据
+// 渲染线程不再访问摄像机、按键状态等主线程会修改的数据
+
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <bitset>
+#include <vector>
+#include "Transform.h"
+
+struct FrameSnapshot {
+    // 帧序号
+    unsigned long long frameIndex = 0;
+    // 本帧的时间（s），同一帧内所有渲染pass共用
+    float frameTime = 0.0f;
+    // 与上一帧的时间间隔（s）
+    float deltaTime = 0.0f;
+
+    /// 摄像机
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    // 视野（度）
+    float cameraZoom = 45.0f;
+    // 是否使用Blinn-Phong
+    bool blinn = false;
+
+    /// 窗口
+    // 帧缓冲的大小（最小化时为0）
+    int framebufferWidth = 0;
+    int framebufferHeight = 0;
+    // 本帧按下的键（下标为GLFW的键值）
+    std::bitset<GLFW_KEY_LAST + 1> keys;
+    // 上一份快照中按下的键，用于检测按键刚刚按下的那一帧
+    std::bitset<GLFW_KEY_LAST + 1> previousKeys;
+
+    /// 场景模拟的结果
+    // 每个定向光的方向
+    std::vector<glm::vec3> directionLightDirections;
+    // 每个模型的变换（矩阵已经更新）
+    std::vector<Transform> transforms;
+    // 每个模型的变换自上一份快照以来是否发生了变化
+    std::vector<bool> transformsChanged;
+};
+
+#endif // FRAME_SNAPSHOT_H
@@ -0,0 +1,59 @@
+#ifndef GL_UTILS_H
+#define GL_UTILS_H
+
+// 定义了一些与OpenGL上下文相关的工具函数
+
+#include <glad/glad.h>
+#include <cstring>
+
+// 各向异性过滤（GL_EXT_texture_filter_anisotropic / GL_ARB_texture_filter_anisotropic）的枚举值，OpenGL 4.6之前不在核心规范中
+#ifndef GL_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_TEXTURE_MAX_ANISOTROPY_EXT 0x84FE
+#endif
+#ifndef GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
+#endif
+
+/// @brief 查询当前上下文是否支持某个扩展（需要在创建上下文并加载glad之后调用）
+/// @param name 扩展名，例如"GL_ARB_shader_viewport_layer_array"
+/// @return 是否支持
+inline bool hasGLExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension != nullptr && std::strcmp(extension, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief 查询当前上下文支持的最大各向异性
+/// @return 最大各向异性，不支持各向异性过滤时返回0
+inline float getMaxTextureAnisotropy() {
+    if (!hasGLExtension("GL_EXT_texture_filter_anisotropic") && !hasGLExtension("GL_ARB_texture_filter_anisotropic")) {
+        return 0.0f;
+    }
+    GLfloat maxAnisotropy = 0.0f;
+    glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+    return maxAnisotropy;
+}
+
+// 在作用域内保存当前的视口，离开作用域时恢复（对比和基准测试函数会临时修改视口）
+class ViewportScope {
+public:
+    ViewportScope() {
+        glGetIntegerv(GL_VIEWPORT, this->viewport);
+    }
+    ~ViewportScope() {
+        glViewport(this->viewport[0], this->viewport[1], this->viewport[2], this->viewport[3]);
+    }
+    ViewportScope(const ViewportScope&) = delete;
+    ViewportScope& operator=(const ViewportScope&) = delete;
+
+private:
+    GLint viewport[4];
+};
+
+#endif // GL_UTILS_H
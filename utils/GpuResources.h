@@ -0,0 +1,508 @@
+#ifndef GPU_RESOURCES_H
+#define GPU_RESOURCES_H
+
+// 定义了GpuResources，登记所有通过它创建的纹理、缓冲、帧缓冲、渲染缓冲、VAO和采样器，用于统计显存占用和在退出时检查泄漏
+// 每个对象记录类别、名称和所属者（模型路径、"Scene"、"SkyBox"等），大小和格式在生成报告时从OpenGL查询（glTexImage*、glBufferData等调用处不需要改动）
+// 统计的是按内部格式计算的名义大小，不包括驱动的对齐、压缩和填充（例如RGB8通常按4字节存储）
+// 着色器程序和查询对象不占用显存，不登记
+// 只能在拥有上下文的线程中调用（与其他GL调用相同），内部的互斥锁只保护登记表本身
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "GLUtils.h"
+
+// GL_NVX_gpu_memory_info的枚举值（单位为KB）
+#ifndef GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX
+#define GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX 0x9048
+#endif
+#ifndef GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX
+#define GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#endif
+
+// 资源类别
+enum class GpuResourceType {
+    Texture,
+    Buffer,
+    Framebuffer,
+    Renderbuffer,
+    VertexArray,
+    Sampler
+};
+
+// 一个登记的OpenGL对象
+struct GpuResource {
+    GpuResourceType type = GpuResourceType::Texture;
+    GLuint id = 0;
+    // 纹理的目标（GL_TEXTURE_2D、GL_TEXTURE_2D_ARRAY、GL_TEXTURE_CUBE_MAP、GL_TEXTURE_BUFFER）
+    GLenum target = 0;
+    // 名称，例如"scene color"
+    std::string label;
+    // 所属者，例如模型路径
+    std::string owner;
+    // 按内部格式计算的大小（字节，updateSizes之后有效）
+    unsigned long long bytes = 0;
+    // 内部格式的名称和尺寸描述，例如"RGBA16F 1920x1080"
+    std::string format;
+};
+
+class GpuResources {
+public:
+    // 设置当前线程中之后创建的对象的默认所属者，作用域结束时恢复（例如加载模型时设置为模型路径，网格和纹理就归属于这个模型）
+    class OwnerScope {
+    public:
+        explicit OwnerScope(const std::string& owner) : previous(currentOwner) {
+            currentOwner = owner;
+        }
+        ~OwnerScope() {
+            currentOwner = this->previous;
+        }
+        OwnerScope(const OwnerScope&) = delete;
+        OwnerScope& operator=(const OwnerScope&) = delete;
+
+    private:
+        std::string previous;
+    };
+
+    /// @brief 创建并登记纹理
+    /// @param target 纹理目标，生成报告时按这个目标查询大小
+    /// @param label 名称
+    /// @param owner 所属者，为nullptr时使用当前的OwnerScope
+    static GLuint createTexture(GLenum target, const char* label, const char* owner = nullptr) {
+        GLuint id = 0;
+        glGenTextures(1, &id);
+        add(GpuResourceType::Texture, id, target, label, owner);
+        return id;
+    }
+
+    /// @brief 创建并登记缓冲
+    static GLuint createBuffer(const char* label, const char* owner = nullptr) {
+        GLuint id = 0;
+        glGenBuffers(1, &id);
+        add(GpuResourceType::Buffer, id, 0, label, owner);
+        return id;
+    }
+
+    /// @brief 创建并登记帧缓冲
+    static GLuint createFramebuffer(const char* label, const char* owner = nullptr) {
+        GLuint id = 0;
+        glGenFramebuffers(1, &id);
+        add(GpuResourceType::Framebuffer, id, 0, label, owner);
+        return id;
+    }
+
+    /// @brief 创建并登记渲染缓冲
+    static GLuint createRenderbuffer(const char* label, const char* owner = nullptr) {
+        GLuint id = 0;
+        glGenRenderbuffers(1, &id);
+        add(GpuResourceType::Renderbuffer, id, 0, label, owner);
+        return id;
+    }
+
+    /// @brief 创建并登记VAO
+    static GLuint createVertexArray(const char* label, const char* owner = nullptr) {
+        GLuint id = 0;
+        glGenVertexArrays(1, &id);
+        add(GpuResourceType::VertexArray, id, 0, label, owner);
+        return id;
+    }
+
+    /// @brief 创建并登记采样器
+    static GLuint createSampler(const char* label, const char* owner = nullptr) {
+        GLuint id = 0;
+        glGenSamplers(1, &id);
+        add(GpuResourceType::Sampler, id, 0, label, owner);
+        return id;
+    }
+
+    /// @brief 删除纹理并取消登记，之后把id置为0（id为0时不做任何事）
+    static void deleteTexture(GLuint& id) {
+        if (id != 0) {
+            remove(GpuResourceType::Texture, id);
+            glDeleteTextures(1, &id);
+            id = 0;
+        }
+    }
+
+    static void deleteBuffer(GLuint& id) {
+        if (id != 0) {
+            remove(GpuResourceType::Buffer, id);
+            glDeleteBuffers(1, &id);
+            id = 0;
+        }
+    }
+
+    static void deleteFramebuffer(GLuint& id) {
+        if (id != 0) {
+            remove(GpuResourceType::Framebuffer, id);
+            glDeleteFramebuffers(1, &id);
+            id = 0;
+        }
+    }
+
+    static void deleteRenderbuffer(GLuint& id) {
+        if (id != 0) {
+            remove(GpuResourceType::Renderbuffer, id);
+            glDeleteRenderbuffers(1, &id);
+            id = 0;
+        }
+    }
+
+    static void deleteVertexArray(GLuint& id) {
+        if (id != 0) {
+            remove(GpuResourceType::VertexArray, id);
+            glDeleteVertexArrays(1, &id);
+            id = 0;
+        }
+    }
+
+    static void deleteSampler(GLuint& id) {
+        if (id != 0) {
+            remove(GpuResourceType::Sampler, id);
+            glDeleteSamplers(1, &id);
+            id = 0;
+        }
+    }
+
+    /// @brief 从OpenGL查询所有登记对象的内部格式和大小（会临时改变纹理、缓冲和渲染缓冲的绑定，结束后恢复）
+    static void updateSizes() {
+        std::lock_guard<std::mutex> lock(mutex);
+        GLint activeTexture = 0;
+        glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+        glActiveTexture(GL_TEXTURE0);
+        GLint previousTexture2D = 0;
+        GLint previousTexture2DArray = 0;
+        GLint previousTextureCubeMap = 0;
+        GLint previousCopyReadBuffer = 0;
+        GLint previousRenderbuffer = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture2D);
+        glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &previousTexture2DArray);
+        glGetIntegerv(GL_TEXTURE_BINDING_CUBE_MAP, &previousTextureCubeMap);
+        glGetIntegerv(GL_COPY_READ_BUFFER_BINDING, &previousCopyReadBuffer);
+        glGetIntegerv(GL_RENDERBUFFER_BINDING, &previousRenderbuffer);
+
+        for (auto& entry : resources) {
+            GpuResource& resource = entry.second;
+            switch (resource.type) {
+            case GpuResourceType::Texture:
+                queryTexture(resource);
+                break;
+            case GpuResourceType::Buffer: {
+                // 使用GL_COPY_READ_BUFFER查询，不影响VAO中的索引缓冲绑定
+                GLint size = 0;
+                glBindBuffer(GL_COPY_READ_BUFFER, resource.id);
+                glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+                resource.bytes = (unsigned long long)size;
+                resource.format = "";
+                break;
+            }
+            case GpuResourceType::Renderbuffer: {
+                GLint width = 0, height = 0, internalFormat = 0, samples = 0;
+                glBindRenderbuffer(GL_RENDERBUFFER, resource.id);
+                glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_WIDTH, &width);
+                glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_HEIGHT, &height);
+                glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_INTERNAL_FORMAT, &internalFormat);
+                glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_SAMPLES, &samples);
+                resource.bytes = (unsigned long long)width * height * getBytesPerPixel(internalFormat) * std::max(samples, 1);
+                resource.format = std::string(getFormatName(internalFormat)) + " " + std::to_string(width) + "x" + std::to_string(height);
+                if (samples > 1) {
+                    resource.format += " " + std::to_string(samples) + "x MSAA";
+                }
+                break;
+            }
+            default:
+                // 帧缓冲、VAO和采样器只是状态对象
+                resource.bytes = 0;
+                break;
+            }
+        }
+
+        glBindTexture(GL_TEXTURE_2D, previousTexture2D);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, previousTexture2DArray);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, previousTextureCubeMap);
+        glBindBuffer(GL_COPY_READ_BUFFER, previousCopyReadBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, previousRenderbuffer);
+        glActiveTexture(activeTexture);
+    }
+
+    /// @brief 获取所有登记对象（大小为最近一次updateSizes的结果）
+    static std::vector<GpuResource> getResources() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<GpuResource> result;
+        result.reserve(resources.size());
+        for (const auto& entry : resources) {
+            result.push_back(entry.second);
+        }
+        return result;
+    }
+
+    /// @brief 登记对象的数量
+    static size_t getResourceCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return resources.size();
+    }
+
+    /// @brief 所有登记对象的总大小（字节）
+    static unsigned long long getTotalBytes() {
+        unsigned long long total = 0;
+        for (const auto& resource : getResources()) {
+            total += resource.bytes;
+        }
+        return total;
+    }
+
+    /// @brief 按类别统计的大小（字节）
+    static std::map<std::string, unsigned long long> getBytesByType() {
+        std::map<std::string, unsigned long long> result;
+        for (const auto& resource : getResources()) {
+            result[getTypeName(resource.type)] += resource.bytes;
+        }
+        return result;
+    }
+
+    /// @brief 按所属者统计的大小（字节）
+    static std::map<std::string, unsigned long long> getBytesByOwner() {
+        std::map<std::string, unsigned long long> result;
+        for (const auto& resource : getResources()) {
+            result[resource.owner] += resource.bytes;
+        }
+        return result;
+    }
+
+    /// @brief 查询大小后输出报告：总量、按类别、按所属者和最大的若干个对象，支持GL_NVX_gpu_memory_info时同时输出驱动报告的显存
+    /// @param topCount 输出的最大对象数量
+    static void printReport(size_t topCount = 10) {
+        updateSizes();
+        std::vector<GpuResource> all = getResources();
+        std::map<std::string, std::pair<size_t, unsigned long long>> byType;
+        std::map<std::string, std::pair<size_t, unsigned long long>> byOwner;
+        unsigned long long total = 0;
+        for (const auto& resource : all) {
+            auto& type = byType[getTypeName(resource.type)];
+            type.first++;
+            type.second += resource.bytes;
+            auto& owner = byOwner[resource.owner];
+            owner.first++;
+            owner.second += resource.bytes;
+            total += resource.bytes;
+        }
+
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "[gpu memory] " << all.size() << " objects, " << toMegabytes(total) << " MB" << std::endl;
+        if (hasGLExtension("GL_NVX_gpu_memory_info")) {
+            GLint totalKb = 0, availableKb = 0;
+            glGetIntegerv(GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &totalKb);
+            glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &availableKb);
+            std::cout << "[gpu memory] driver: " << availableKb / 1024.0 << " MB available of " << totalKb / 1024.0 << " MB" << std::endl;
+        }
+        std::cout << "[gpu memory] by type:" << std::endl;
+        for (const auto& type : byType) {
+            std::cout << "  " << std::setw(14) << std::left << type.first << std::right << std::setw(6) << type.second.first
+                << " objects " << std::setw(10) << toMegabytes(type.second.second) << " MB" << std::endl;
+        }
+        // 所属者按大小从大到小输出
+        std::vector<std::pair<std::string, std::pair<size_t, unsigned long long>>> owners(byOwner.begin(), byOwner.end());
+        std::sort(owners.begin(), owners.end(), [](const auto& a, const auto& b) {
+            return a.second.second > b.second.second;
+            });
+        std::cout << "[gpu memory] by owner:" << std::endl;
+        for (const auto& owner : owners) {
+            std::cout << "  " << std::setw(6) << owner.second.first << " objects " << std::setw(10) << toMegabytes(owner.second.second)
+                << " MB  " << owner.first << std::endl;
+        }
+        std::sort(all.begin(), all.end(), [](const GpuResource& a, const GpuResource& b) {
+            return a.bytes > b.bytes;
+            });
+        std::cout << "[gpu memory] largest objects:" << std::endl;
+        for (size_t i = 0; i < std::min(topCount, all.size()) && all[i].bytes > 0; i++) {
+            std::cout << "  " << std::setw(10) << toMegabytes(all[i].bytes) << " MB  " << all[i].owner << " / " << all[i].label
+                << " (" << getTypeName(all[i].type) << (all[i].format.empty() ? "" : ", " + all[i].format) << ")" << std::endl;
+        }
+        std::cout.unsetf(std::ios::fixed);
+    }
+
+    /// @brief 输出仍然登记着的对象（在所有所属者释放之后、销毁上下文之前调用）
+    /// @return 泄漏的对象数量
+    static size_t reportLeaks() {
+        updateSizes();
+        std::vector<GpuResource> all = getResources();
+        if (all.empty()) {
+            std::cout << "[gpu memory] no leaked objects" << std::endl;
+            return 0;
+        }
+        unsigned long long total = 0;
+        for (const auto& resource : all) {
+            total += resource.bytes;
+        }
+        std::cout << "[gpu memory] " << all.size() << " objects (" << total << " bytes) were not released:" << std::endl;
+        for (const auto& resource : all) {
+            std::cout << "  " << getTypeName(resource.type) << " " << resource.id << " " << resource.owner << " / " << resource.label
+                << (resource.format.empty() ? "" : " (" + resource.format + ")") << ", " << resource.bytes << " bytes" << std::endl;
+        }
+        return all.size();
+    }
+
+    /// @brief 类别的名称
+    static const char* getTypeName(GpuResourceType type) {
+        switch (type) {
+        case GpuResourceType::Texture: return "texture";
+        case GpuResourceType::Buffer: return "buffer";
+        case GpuResourceType::Framebuffer: return "framebuffer";
+        case GpuResourceType::Renderbuffer: return "renderbuffer";
+        case GpuResourceType::VertexArray: return "vertex array";
+        case GpuResourceType::Sampler: return "sampler";
+        }
+        return "unknown";
+    }
+
+    /// @brief 内部格式每个像素的字节数（未知格式按4字节计算）
+    static unsigned int getBytesPerPixel(GLint internalFormat) {
+        switch (internalFormat) {
+        case GL_R8: case GL_RED: return 1;
+        case GL_RG8: case GL_R16: case GL_R16F: case GL_DEPTH_COMPONENT16: return 2;
+        case GL_RGB8: case GL_SRGB8: case GL_RGB: return 3;
+        case GL_RGBA8: case GL_SRGB8_ALPHA8: case GL_RGBA: case GL_RG16: case GL_RG16F: case GL_R32F: case GL_R32UI: case GL_R32I:
+        case GL_R11F_G11F_B10F: case GL_RGB10_A2: case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32: case GL_DEPTH_COMPONENT32F:
+        case GL_DEPTH_COMPONENT: case GL_DEPTH24_STENCIL8: return 4;
+        case GL_RGB16F: return 6;
+        case GL_RGBA16: case GL_RGBA16F: case GL_RG32F: case GL_RG32UI: case GL_DEPTH32F_STENCIL8: return 8;
+        case GL_RGB32F: return 12;
+        case GL_RGBA32F: case GL_RGBA32UI: return 16;
+        default: return 4;
+        }
+    }
+
+    /// @brief 内部格式的名称
+    static const char* getFormatName(GLint internalFormat) {
+        switch (internalFormat) {
+        case GL_R8: return "R8";
+        case GL_RED: return "RED";
+        case GL_RG8: return "RG8";
+        case GL_R16: return "R16";
+        case GL_R16F: return "R16F";
+        case GL_RGB8: return "RGB8";
+        case GL_SRGB8: return "SRGB8";
+        case GL_RGB: return "RGB";
+        case GL_RGBA8: return "RGBA8";
+        case GL_SRGB8_ALPHA8: return "SRGB8_ALPHA8";
+        case GL_RGBA: return "RGBA";
+        case GL_RG16: return "RG16";
+        case GL_RG16F: return "RG16F";
+        case GL_R32F: return "R32F";
+        case GL_R32UI: return "R32UI";
+        case GL_R32I: return "R32I";
+        case GL_R11F_G11F_B10F: return "R11F_G11F_B10F";
+        case GL_RGB10_A2: return "RGB10_A2";
+        case GL_RGB16F: return "RGB16F";
+        case GL_RGBA16: return "RGBA16";
+        case GL_RGBA16F: return "RGBA16F";
+        case GL_RG32F: return "RG32F";
+        case GL_RG32UI: return "RG32UI";
+        case GL_RGB32F: return "RGB32F";
+        case GL_RGBA32F: return "RGBA32F";
+        case GL_RGBA32UI: return "RGBA32UI";
+        case GL_DEPTH_COMPONENT: return "DEPTH";
+        case GL_DEPTH_COMPONENT16: return "DEPTH16";
+        case GL_DEPTH_COMPONENT24: return "DEPTH24";
+        case GL_DEPTH_COMPONENT32: return "DEPTH32";
+        case GL_DEPTH_COMPONENT32F: return "DEPTH32F";
+        case GL_DEPTH24_STENCIL8: return "DEPTH24_STENCIL8";
+        case GL_DEPTH32F_STENCIL8: return "DEPTH32F_STENCIL8";
+        default: return "unknown";
+        }
+    }
+
+private:
+    // 登记的对象，键为类别和id（不同类别的对象id可以相同）
+    inline static std::map<std::pair<int, GLuint>, GpuResource> resources;
+    inline static std::mutex mutex;
+    // 当前线程的默认所属者
+    inline static thread_local std::string currentOwner;
+
+    static void add(GpuResourceType type, GLuint id, GLenum target, const char* label, const char* owner) {
+        GpuResource resource;
+        resource.type = type;
+        resource.id = id;
+        resource.target = target;
+        resource.label = label != nullptr ? label : "";
+        resource.owner = owner != nullptr ? owner : (currentOwner.empty() ? "unowned" : currentOwner);
+        std::lock_guard<std::mutex> lock(mutex);
+        resources[{ (int)type, id }] = resource;
+    }
+
+    static void remove(GpuResourceType type, GLuint id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (resources.erase({ (int)type, id }) == 0) {
+            std::cout << "[gpu memory] deleting unregistered " << getTypeName(type) << " " << id << std::endl;
+        }
+    }
+
+    // 查询纹理所有mip层级的大小（立方体贴图的6个面分别查询）
+    static void queryTexture(GpuResource& resource) {
+        resource.bytes = 0;
+        resource.format = "";
+        // 纹理缓冲只是缓冲的视图，数据已经计入对应的缓冲
+        if (resource.target == GL_TEXTURE_BUFFER) {
+            resource.format = "buffer view";
+            return;
+        }
+        glBindTexture(resource.target, resource.id);
+        bool cubeMap = resource.target == GL_TEXTURE_CUBE_MAP;
+        GLenum queryTarget = cubeMap ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : resource.target;
+        int faces = cubeMap ? 6 : 1;
+        GLint baseWidth = 0, baseHeight = 0, baseDepth = 0, internalFormat = 0;
+        int levels = 0;
+        for (GLint level = 0; level < 16; level++) {
+            GLint width = 0, height = 0, depth = 0, compressed = 0;
+            glGetTexLevelParameteriv(queryTarget, level, GL_TEXTURE_WIDTH, &width);
+            if (width == 0) {
+                break;
+            }
+            glGetTexLevelParameteriv(queryTarget, level, GL_TEXTURE_HEIGHT, &height);
+            glGetTexLevelParameteriv(queryTarget, level, GL_TEXTURE_DEPTH, &depth);
+            glGetTexLevelParameteriv(queryTarget, level, GL_TEXTURE_COMPRESSED, &compressed);
+            if (level == 0) {
+                glGetTexLevelParameteriv(queryTarget, level, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+                baseWidth = width;
+                baseHeight = height;
+                baseDepth = depth;
+            }
+            unsigned long long levelBytes = 0;
+            if (compressed) {
+                GLint compressedSize = 0;
+                glGetTexLevelParameteriv(queryTarget, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &compressedSize);
+                levelBytes = (unsigned long long)compressedSize;
+            }
+            else {
+                levelBytes = (unsigned long long)width * std::max(height, 1) * std::max(depth, 1) * getBytesPerPixel(internalFormat);
+            }
+            resource.bytes += levelBytes * faces;
+            levels++;
+        }
+        if (levels == 0) {
+            resource.format = "no storage";
+            return;
+        }
+        resource.format = std::string(getFormatName(internalFormat)) + " " + std::to_string(baseWidth) + "x" + std::to_string(baseHeight);
+        if (baseDepth > 1) {
+            resource.format += "x" + std::to_string(baseDepth);
+        }
+        if (cubeMap) {
+            resource.format += " cube";
+        }
+        if (levels > 1) {
+            resource.format += ", " + std::to_string(levels) + " levels";
+        }
+    }
+
+    static double toMegabytes(unsigned long long bytes) {
+        return bytes / (1024.0 * 1024.0);
+    }
+};
+
+#endif // GPU_RESOURCES_H
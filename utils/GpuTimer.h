@@ -0,0 +1,202 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+// 定义了GpuTimer和GpuTimestampTimer（测量一段GPU命令的耗时）以及SampleCounter（统计通过深度测试的片段数量）
+// 三者共用BasicGpuTimer：内部使用一个查询对象环形缓冲区，只读取已经可用的结果，不会让CPU等待GPU
+// 区别只在于查询的方式（TimeElapsedQuery / TimestampQuery / SamplesPassedQuery）
+
+#include <glad/glad.h>
+
+// 基于GL_TIME_ELAPSED查询，每个样本一个查询对象
+struct TimeElapsedQuery {
+    // 每个样本使用的查询对象数量
+    static const int QUERIES_PER_SAMPLE = 1;
+
+    static void begin(const GLuint* queries) {
+        glBeginQuery(GL_TIME_ELAPSED, queries[0]);
+    }
+
+    static void end(const GLuint*) {
+        glEndQuery(GL_TIME_ELAPSED);
+    }
+
+    /// @brief 结果是否已经可用
+    static bool isAvailable(const GLuint* queries) {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[0], GL_QUERY_RESULT_AVAILABLE, &available);
+        return available != 0;
+    }
+
+    /// @brief 读取耗时（ms），结果还没有准备好时会等待
+    static double getResult(const GLuint* queries) {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &elapsed);
+        return elapsed / 1.0e6;
+    }
+};
+
+// 基于GL_TIMESTAMP查询，每个样本开始和结束各一个查询对象
+// GL_TIME_ELAPSED查询不能嵌套，时间戳查询可以包含其他GpuTimer计时的区间（例如测量整帧的GPU耗时）
+struct TimestampQuery {
+    // 每个样本使用的查询对象数量
+    static const int QUERIES_PER_SAMPLE = 2;
+
+    static void begin(const GLuint* queries) {
+        glQueryCounter(queries[0], GL_TIMESTAMP);
+    }
+
+    static void end(const GLuint* queries) {
+        glQueryCounter(queries[1], GL_TIMESTAMP);
+    }
+
+    /// @brief 结果是否已经可用（结束时间戳可用时开始时间戳一定可用）
+    static bool isAvailable(const GLuint* queries) {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        return available != 0;
+    }
+
+    /// @brief 读取耗时（ms），结果还没有准备好时会等待
+    static double getResult(const GLuint* queries) {
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+        return (end - start) / 1.0e6;
+    }
+};
+
+// 基于GL_SAMPLES_PASSED查询，每个样本一个查询对象，结果为通过深度测试的片段数量
+struct SamplesPassedQuery {
+    // 每个样本使用的查询对象数量
+    static const int QUERIES_PER_SAMPLE = 1;
+
+    static void begin(const GLuint* queries) {
+        glBeginQuery(GL_SAMPLES_PASSED, queries[0]);
+    }
+
+    static void end(const GLuint*) {
+        glEndQuery(GL_SAMPLES_PASSED);
+    }
+
+    /// @brief 结果是否已经可用
+    static bool isAvailable(const GLuint* queries) {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[0], GL_QUERY_RESULT_AVAILABLE, &available);
+        return available != 0;
+    }
+
+    /// @brief 读取片段数量，结果还没有准备好时会等待
+    static double getResult(const GLuint* queries) {
+        GLuint64 samples = 0;
+        glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &samples);
+        return (double)samples;
+    }
+};
+
+template <typename Query>
+class BasicGpuTimer {
+public:
+    // 环形缓冲区大小，需要大于GPU落后CPU的帧数
+    static const int QUERY_COUNT = 4;
+
+    BasicGpuTimer() {}
+
+    /// @brief 开始计时
+    void begin() {
+        if (!this->initialized) {
+            glGenQueries(QUERY_COUNT * Query::QUERIES_PER_SAMPLE, &this->queries[0][0]);
+            this->initialized = true;
+        }
+        // 如果即将复用的查询对象还没有读取过结果，先尝试读取
+        if (this->pending[this->writeIndex]) {
+            collect(this->writeIndex, true);
+        }
+        Query::begin(this->queries[this->writeIndex]);
+    }
+
+    /// @brief 结束计时
+    void end() {
+        Query::end(this->queries[this->writeIndex]);
+        this->pending[this->writeIndex] = true;
+        this->writeIndex = (this->writeIndex + 1) % QUERY_COUNT;
+        // 从最旧的查询开始，读取所有已经可用的结果
+        for (int k = 0; k < QUERY_COUNT; k++) {
+            int i = (this->writeIndex + k) % QUERY_COUNT;
+            if (this->pending[i]) {
+                collect(i, false);
+            }
+        }
+    }
+
+    /// @brief 获取最近一次可用的结果（计时器为ms，片段计数器为片段数量）
+    double getLast() const {
+        return this->last;
+    }
+
+    /// @brief 获取自上次reset以来的平均结果
+    double getAverage() const {
+        return this->sampleCount > 0 ? this->total / this->sampleCount : 0.0;
+    }
+
+    /// @brief 计时器：获取最近一次可用的耗时（ms）
+    float getLastMs() const {
+        return (float)getLast();
+    }
+
+    /// @brief 计时器：获取自上次reset以来的平均耗时（ms）
+    float getAverageMs() const {
+        return (float)getAverage();
+    }
+
+    /// @brief 获取自上次reset以来的样本数
+    unsigned int getSampleCount() const {
+        return this->sampleCount;
+    }
+
+    /// @brief 清空统计数据
+    void reset() {
+        this->total = 0.0;
+        this->sampleCount = 0;
+    }
+
+    /// @brief 释放查询对象
+    void release() {
+        if (this->initialized) {
+            glDeleteQueries(QUERY_COUNT * Query::QUERIES_PER_SAMPLE, &this->queries[0][0]);
+            this->initialized = false;
+        }
+    }
+
+private:
+    // 查询对象，每个样本Query::QUERIES_PER_SAMPLE个
+    GLuint queries[QUERY_COUNT][Query::QUERIES_PER_SAMPLE] = {};
+    // 查询对象是否还有未读取的结果
+    bool pending[QUERY_COUNT] = { false };
+    // 下一次写入的位置
+    int writeIndex = 0;
+    // 是否已经生成了查询对象
+    bool initialized = false;
+    // 最近一次的结果
+    double last = 0.0;
+    // 累计结果
+    double total = 0.0;
+    // 累计样本数
+    unsigned int sampleCount = 0;
+
+    // 读取查询结果，force为true时如果结果还没有准备好会等待
+    void collect(int index, bool force) {
+        if (!force && !Query::isAvailable(this->queries[index])) {
+            return;
+        }
+        this->last = Query::getResult(this->queries[index]);
+        this->total += this->last;
+        this->sampleCount++;
+        this->pending[index] = false;
+    }
+};
+
+typedef BasicGpuTimer<TimeElapsedQuery> GpuTimer;
+typedef BasicGpuTimer<TimestampQuery> GpuTimestampTimer;
+typedef BasicGpuTimer<SamplesPassedQuery> SampleCounter;
+
+#endif // GPU_TIMER_H
@@ -0,0 +1,287 @@
+#ifndef HEADLESS_BENCHMARK_H
+#define HEADLESS_BENCHMARK_H
+
+// 离屏基准测试：不创建窗口，使用EGL离屏上下文按固定的分辨率和时间步长渲染固定数量的帧
+// 动画（地球仪的转动等）由帧序号驱动，每次运行渲染的内容相同；动态分辨率固定为给定的比例
+// 输出每帧CPU/GPU耗时的p50/p95/p99、绘制调用和三角形数量到JSON文件，便于在CI或不同版本之间对比
+// 用法：tellurion --benchmark [--scene config/scene.yaml] [--frames 300] [--warmup 10] [--width 1920] [--height 1080]
+//                 [--dt 0.0166667] [--scale 1.0] [--replay input.bin] [--output benchmark.json] [--compare <名称>]...
+// 指定--replay时摄像机和按键按录制的输入逐帧回放（录制的帧数少于统计的帧数时保持最后一帧的姿态）
+// 指定--compare时预热之后只运行场景的对比测试（Scene::runComparison，可以重复指定），不统计帧时间
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "WindowFactory.h"
+#include "Scene.h"
+#include "SkyBox.h"
+#include "RenderStats.h"
+
+// 基准测试的参数
+struct HeadlessBenchmarkOptions {
+    // 场景配置文件
+    std::string sceneFile = "config/scene.yaml";
+    // 统计的帧数
+    int frames = 300;
+    // 统计之前的预热帧数（着色器编译、驱动缓存、阴影缓存等）
+    int warmupFrames = 10;
+    // 离屏帧缓冲的大小
+    int width = 1920;
+    int height = 1080;
+    // 每帧的时间步长（s）
+    float timeStep = 1.0f / 60.0f;
+    // 渲染分辨率的缩放比例（固定，不使用动态分辨率）
+    float resolutionScale = 1.0f;
+    // 回放的输入录制文件，为空时摄像机保持初始姿态
+    std::string replayFile;
+    // 结果输出的JSON文件
+    std::string outputFile = "benchmark.json";
+    // 要运行的场景对比测试，为空时统计帧时间
+    std::vector<std::string> comparisons;
+};
+
+// 一组帧时间的统计
+struct HeadlessBenchmarkSummary {
+    double average = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+/// @brief 命令行中是否要求运行离屏基准测试
+inline bool isHeadlessBenchmarkRequested(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--benchmark") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief 解析基准测试的命令行参数，未知参数输出提示后忽略
+inline HeadlessBenchmarkOptions parseHeadlessBenchmarkOptions(int argc, char** argv) {
+    HeadlessBenchmarkOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--benchmark") {
+            continue;
+        }
+        else if (arg == "--scene" && hasValue) {
+            options.sceneFile = argv[++i];
+        }
+        else if (arg == "--frames" && hasValue) {
+            options.frames = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (arg == "--warmup" && hasValue) {
+            options.warmupFrames = std::max(std::atoi(argv[++i]), 0);
+        }
+        else if (arg == "--width" && hasValue) {
+            options.width = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (arg == "--height" && hasValue) {
+            options.height = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (arg == "--dt" && hasValue) {
+            options.timeStep = (float)std::atof(argv[++i]);
+        }
+        else if (arg == "--scale" && hasValue) {
+            options.resolutionScale = (float)std::atof(argv[++i]);
+        }
+        else if (arg == "--replay" && hasValue) {
+            options.replayFile = argv[++i];
+        }
+        else if (arg == "--output" && hasValue) {
+            options.outputFile = argv[++i];
+        }
+        else if (arg == "--compare" && hasValue) {
+            options.comparisons.push_back(argv[++i]);
+        }
+        else {
+            std::cout << "[benchmark] ignoring unknown argument " << arg << std::endl;
+        }
+    }
+    return options;
+}
+
+/// @brief 计算一组帧时间的平均值、百分位数和最大值
+inline HeadlessBenchmarkSummary summarizeFrameTimes(std::vector<double> samples) {
+    HeadlessBenchmarkSummary summary;
+    if (samples.empty()) {
+        return summary;
+    }
+    std::sort(samples.begin(), samples.end());
+    double total = 0.0;
+    for (double sample : samples) {
+        total += sample;
+    }
+    auto percentile = [&samples](double p) {
+        size_t k = std::min((size_t)(p * (samples.size() - 1) + 0.5), samples.size() - 1);
+        return samples[k];
+    };
+    summary.average = total / samples.size();
+    summary.p50 = percentile(0.50);
+    summary.p95 = percentile(0.95);
+    summary.p99 = percentile(0.99);
+    summary.max = samples.back();
+    return summary;
+}
+
+/// @brief 把一组统计写成JSON对象
+inline void writeFrameTimeSummary(std::ofstream& out, const char* name, const HeadlessBenchmarkSummary& summary, bool last) {
+    out << "  \"" << name << "\": { \"average\": " << summary.average << ", \"p50\": " << summary.p50 << ", \"p95\": " << summary.p95
+        << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << " }" << (last ? "\n" : ",\n");
+}
+
+/// @brief 把字符串写成JSON字符串（转义引号和反斜杠）
+inline std::string toJsonString(const std::string& text) {
+    std::string result = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result + "\"";
+}
+
+/// @brief 连续运行若干帧，测量每帧的CPU耗时和GPU耗时（每帧开始和结束各一个时间戳查询，全部渲染完成之后再读取，不让CPU等待GPU）
+/// @param frames 帧数
+/// @param runFrame 运行一帧的函数
+/// @param cpuMs 每帧的CPU耗时（ms）
+/// @param gpuMs 每帧的GPU耗时（ms）
+inline void measureHeadlessFrames(int frames, const std::function<void()>& runFrame, std::vector<double>& cpuMs, std::vector<double>& gpuMs) {
+    std::vector<GLuint> queries(frames * 2);
+    glGenQueries((GLsizei)queries.size(), queries.data());
+    cpuMs.assign(frames, 0.0);
+    gpuMs.assign(frames, 0.0);
+    for (int i = 0; i < frames; i++) {
+        auto start = std::chrono::steady_clock::now();
+        glQueryCounter(queries[i * 2], GL_TIMESTAMP);
+        runFrame();
+        glQueryCounter(queries[i * 2 + 1], GL_TIMESTAMP);
+        cpuMs[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    glFinish();
+    for (int i = 0; i < frames; i++) {
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(queries[i * 2], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+        gpuMs[i] = (end - begin) / 1.0e6;
+    }
+    glDeleteQueries((GLsizei)queries.size(), queries.data());
+}
+
+/// @brief 运行离屏基准测试
+/// @return 进程的返回值，创建上下文失败时为非0
+inline int runHeadlessBenchmark(const HeadlessBenchmarkOptions& options) {
+    GLFWWindowFactory factory;
+    if (!factory.initHeadless(options.width, options.height)) {
+        factory.releaseHeadless();
+        return 1;
+    }
+    if (!options.replayFile.empty() && !factory.startInputReplay(options.replayFile)) {
+        factory.releaseHeadless();
+        return 1;
+    }
+    std::string renderer = (const char*)glGetString(GL_RENDERER);
+    std::cout << "[benchmark] " << renderer << ", scene " << options.sceneFile << ", " << options.width << "x" << options.height
+        << ", " << options.warmupFrames << " warmup + " << options.frames << " frames, dt " << options.timeStep << " s" << std::endl;
+
+    int exitCode = 0;
+    {
+        Scene tellurion(&factory, options.sceneFile);
+        SkyBox skyBox(&factory);
+        tellurion.setFixedResolutionScale(options.resolutionScale);
+
+        auto simulate = [&](FrameSnapshot& frame) {
+            tellurion.simulate(frame);
+        };
+        auto render = [&]() {
+            tellurion.draw();
+            skyBox.draw();
+        };
+
+        // 预热帧不统计
+        for (int i = 0; i < options.warmupFrames; i++) {
+            factory.runHeadlessFrame(options.timeStep, simulate, render);
+        }
+        glFinish();
+
+        if (!options.comparisons.empty()) {
+            for (const std::string& name : options.comparisons) {
+                if (!tellurion.runComparison(name)) {
+                    exitCode = 1;
+                }
+            }
+        }
+        else {
+            std::vector<double> cpuMs;
+            std::vector<double> gpuMs;
+            unsigned long long drawCalls = 0;
+            unsigned long long triangles = 0;
+            unsigned long long maxDrawCalls = 0;
+            unsigned long long maxTriangles = 0;
+            measureHeadlessFrames(options.frames, [&]() {
+                RenderStats::reset();
+                factory.runHeadlessFrame(options.timeStep, simulate, render);
+                drawCalls += RenderStats::drawCalls;
+                triangles += RenderStats::triangles;
+                maxDrawCalls = std::max(maxDrawCalls, RenderStats::drawCalls);
+                maxTriangles = std::max(maxTriangles, RenderStats::triangles);
+                }, cpuMs, gpuMs);
+
+            HeadlessBenchmarkSummary cpu = summarizeFrameTimes(cpuMs);
+            HeadlessBenchmarkSummary gpu = summarizeFrameTimes(gpuMs);
+            double averageDrawCalls = (double)drawCalls / options.frames;
+            double averageTriangles = (double)triangles / options.frames;
+
+            std::ofstream out(options.outputFile);
+            if (!out) {
+                std::cout << "[benchmark] failed to write " << options.outputFile << std::endl;
+                exitCode = 1;
+            }
+            else {
+                out << std::fixed << std::setprecision(4);
+                out << "{\n";
+                out << "  \"renderer\": " << toJsonString(renderer) << ",\n";
+                out << "  \"scene\": " << toJsonString(options.sceneFile) << ",\n";
+                out << "  \"width\": " << options.width << ",\n";
+                out << "  \"height\": " << options.height << ",\n";
+                out << "  \"resolutionScale\": " << options.resolutionScale << ",\n";
+                out << "  \"frames\": " << options.frames << ",\n";
+                out << "  \"warmupFrames\": " << options.warmupFrames << ",\n";
+                out << "  \"timeStep\": " << options.timeStep << ",\n";
+                out << "  \"replay\": " << toJsonString(options.replayFile) << ",\n";
+                out << "  \"drawCalls\": { \"average\": " << averageDrawCalls << ", \"max\": " << maxDrawCalls << " },\n";
+                out << "  \"triangles\": { \"average\": " << averageTriangles << ", \"max\": " << maxTriangles << " },\n";
+                writeFrameTimeSummary(out, "cpuFrameMs", cpu, false);
+                writeFrameTimeSummary(out, "gpuFrameMs", gpu, true);
+                out << "}\n";
+            }
+
+            std::cout << std::fixed << std::setprecision(3);
+            std::cout << "[benchmark] cpu frame p50 " << cpu.p50 << " ms, p95 " << cpu.p95 << " ms, p99 " << cpu.p99 << " ms" << std::endl;
+            std::cout << "[benchmark] gpu frame p50 " << gpu.p50 << " ms, p95 " << gpu.p95 << " ms, p99 " << gpu.p99 << " ms" << std::endl;
+            std::cout << "[benchmark] " << averageDrawCalls << " draw calls, " << averageTriangles << " triangles per frame, written to "
+                << options.outputFile << std::endl;
+        }
+        tellurion.release();
+        skyBox.release();
+        GpuResources::reportLeaks();
+    }
+    factory.releaseHeadless();
+    return exitCode;
+}
+
+#endif // HEADLESS_BENCHMARK_H
@@ -0,0 +1,217 @@
+#ifndef INPUT_RECORDING_H
+#define INPUT_RECORDING_H
+
+// 定义了InputRecorder和InputReplay类，把每帧的摄像机姿态和按键状态录制到紧凑的二进制文件，再按固定的时间步长回放
+// 回放时摄像机直接使用录制的姿态（不受帧时间影响），按键状态代替实际输入写入快照，由按键驱动的状态（定向光方向、阴影算法切换等）也会完全重现
+// 文件格式（本机字节序）：文件头为魔数"TLIR"、版本号（uint32）和录制时的平均帧间隔（float，s，只用于提示）
+// 之后每帧为：位置、前方向、上方向（各3个float）、视野（float）、标志（uint8，bit0为Blinn-Phong）、按下的键数量（uint16）和每个键的键值（uint16）
+
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 一帧的输入
+struct InputFrame {
+    // 摄像机位置和朝向
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 front = glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+    // 视野（度）
+    float zoom = 45.0f;
+    // 是否使用Blinn-Phong
+    bool blinn = false;
+    // 按下的键
+    std::bitset<GLFW_KEY_LAST + 1> keys;
+};
+
+// 录制文件的魔数和版本
+static const char INPUT_RECORDING_MAGIC[4] = { 'T', 'L', 'I', 'R' };
+static const uint32_t INPUT_RECORDING_VERSION = 1;
+
+class InputRecorder {
+public:
+    InputRecorder() {}
+    InputRecorder(const InputRecorder&) = delete;
+    InputRecorder& operator=(const InputRecorder&) = delete;
+
+    ~InputRecorder() {
+        close();
+    }
+
+    /// @brief 开始录制，文件头中的帧间隔在close时写入
+    /// @param path 录制文件
+    /// @return 是否成功打开文件
+    bool open(const std::string& path) {
+        close();
+        this->file.open(path, std::ios::binary | std::ios::trunc);
+        if (!this->file) {
+            std::cout << "[input] failed to open " << path << " for recording" << std::endl;
+            return false;
+        }
+        this->path = path;
+        this->frameCount = 0;
+        this->totalDeltaTime = 0.0;
+        float averageDeltaTime = 0.0f;
+        this->file.write(INPUT_RECORDING_MAGIC, sizeof(INPUT_RECORDING_MAGIC));
+        this->file.write((const char*)&INPUT_RECORDING_VERSION, sizeof(INPUT_RECORDING_VERSION));
+        this->file.write((const char*)&averageDeltaTime, sizeof(averageDeltaTime));
+        return true;
+    }
+
+    /// @brief 是否正在录制
+    bool isRecording() const {
+        return this->file.is_open();
+    }
+
+    /// @brief 录制一帧
+    /// @param frame 这一帧的输入
+    /// @param deltaTime 与上一帧的时间间隔（s）
+    void record(const InputFrame& frame, float deltaTime) {
+        if (!isRecording()) {
+            return;
+        }
+        float pose[10] = {
+            frame.position.x, frame.position.y, frame.position.z,
+            frame.front.x, frame.front.y, frame.front.z,
+            frame.up.x, frame.up.y, frame.up.z,
+            frame.zoom
+        };
+        this->file.write((const char*)pose, sizeof(pose));
+        uint8_t flags = frame.blinn ? 1 : 0;
+        this->file.write((const char*)&flags, sizeof(flags));
+        uint16_t keyCount = (uint16_t)frame.keys.count();
+        this->file.write((const char*)&keyCount, sizeof(keyCount));
+        for (uint16_t key = 0; key <= GLFW_KEY_LAST; key++) {
+            if (frame.keys.test(key)) {
+                this->file.write((const char*)&key, sizeof(key));
+            }
+        }
+        this->frameCount++;
+        this->totalDeltaTime += deltaTime;
+    }
+
+    /// @brief 结束录制，补写平均帧间隔
+    void close() {
+        if (!isRecording()) {
+            return;
+        }
+        float averageDeltaTime = this->frameCount > 0 ? (float)(this->totalDeltaTime / this->frameCount) : 0.0f;
+        this->file.seekp(sizeof(INPUT_RECORDING_MAGIC) + sizeof(INPUT_RECORDING_VERSION));
+        this->file.write((const char*)&averageDeltaTime, sizeof(averageDeltaTime));
+        this->file.close();
+        std::cout << "[input] recorded " << this->frameCount << " frames to " << this->path
+            << " (average frame " << averageDeltaTime * 1000.0f << " ms)" << std::endl;
+    }
+
+private:
+    std::ofstream file;
+    std::string path;
+    // 录制的帧数
+    unsigned long long frameCount = 0;
+    // 录制期间的帧间隔之和（s）
+    double totalDeltaTime = 0.0;
+};
+
+class InputReplay {
+public:
+    /// @brief 读取整个录制文件
+    /// @param path 录制文件
+    /// @return 是否读取成功
+    bool open(const std::string& path) {
+        this->frames.clear();
+        this->nextFrame = 0;
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::cout << "[input] failed to open " << path << " for replay" << std::endl;
+            return false;
+        }
+        char magic[4];
+        uint32_t version = 0;
+        float averageDeltaTime = 0.0f;
+        file.read(magic, sizeof(magic));
+        file.read((char*)&version, sizeof(version));
+        file.read((char*)&averageDeltaTime, sizeof(averageDeltaTime));
+        if (!file || std::memcmp(magic, INPUT_RECORDING_MAGIC, sizeof(magic)) != 0 || version != INPUT_RECORDING_VERSION) {
+            std::cout << "[input] " << path << " is not an input recording (version " << INPUT_RECORDING_VERSION << ")" << std::endl;
+            return false;
+        }
+        while (true) {
+            float pose[10];
+            uint8_t flags = 0;
+            uint16_t keyCount = 0;
+            if (!file.read((char*)pose, sizeof(pose)) || !file.read((char*)&flags, sizeof(flags)) || !file.read((char*)&keyCount, sizeof(keyCount))) {
+                break;
+            }
+            InputFrame frame;
+            frame.position = glm::vec3(pose[0], pose[1], pose[2]);
+            frame.front = glm::vec3(pose[3], pose[4], pose[5]);
+            frame.up = glm::vec3(pose[6], pose[7], pose[8]);
+            frame.zoom = pose[9];
+            frame.blinn = (flags & 1) != 0;
+            bool complete = true;
+            for (uint16_t i = 0; i < keyCount; i++) {
+                uint16_t key = 0;
+                if (!file.read((char*)&key, sizeof(key))) {
+                    complete = false;
+                    break;
+                }
+                if (key <= GLFW_KEY_LAST) {
+                    frame.keys.set(key);
+                }
+            }
+            // 录制被中断时最后一帧可能不完整
+            if (!complete) {
+                break;
+            }
+            this->frames.push_back(frame);
+        }
+        std::cout << "[input] replaying " << this->frames.size() << " frames from " << path
+            << " (recorded at an average frame of " << averageDeltaTime * 1000.0f << " ms)" << std::endl;
+        return !this->frames.empty();
+    }
+
+    /// @brief 是否加载了录制文件
+    bool isActive() const {
+        return !this->frames.empty();
+    }
+
+    /// @brief 是否已经回放完所有帧
+    bool isFinished() const {
+        return this->nextFrame >= this->frames.size();
+    }
+
+    /// @brief 取出下一帧，回放结束后一直返回最后一帧
+    /// @param frame 下一帧的输入
+    /// @return 是否还有没有回放的帧
+    bool next(InputFrame& frame) {
+        if (this->frames.empty()) {
+            return false;
+        }
+        bool remaining = !isFinished();
+        frame = this->frames[std::min(this->nextFrame, this->frames.size() - 1)];
+        if (remaining) {
+            this->nextFrame++;
+        }
+        return remaining;
+    }
+
+    /// @brief 获取录制的帧数
+    size_t getFrameCount() const {
+        return this->frames.size();
+    }
+
+private:
+    // 所有帧（录制文件很小，一次全部读入）
+    std::vector<InputFrame> frames;
+    // 下一帧的序号
+    size_t nextFrame = 0;
+};
+
+#endif // INPUT_RECORDING_H
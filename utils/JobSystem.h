@@ -0,0 +1,330 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+// 定义了JobSystem类，基于工作窃取的作业系统
+// 每个工作线程有自己的双端队列：自己从尾部取（后提交的先执行，缓存更热），空闲的线程从其他队列的头部窃取
+// 非工作线程（主线程、渲染线程）提交的作业放入一个共享的注入队列；等待计数器的线程会帮忙执行作业，不会空等
+// 作业完成时计数器减一，计数器归零时把依赖它的后续作业放入队列
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem {
+public:
+    using Job = std::function<void()>;
+
+    // 作业计数器：记录还没有完成的作业数量，以及计数器归零后才能执行的后续作业
+    class Counter {
+    public:
+        Counter() {}
+        Counter(const Counter&) = delete;
+        Counter& operator=(const Counter&) = delete;
+
+        /// @brief 是否所有作业都已经完成
+        bool isDone() const {
+            return this->pending.load(std::memory_order_acquire) == 0;
+        }
+
+    private:
+        friend class JobSystem;
+        std::atomic<int> pending{ 0 };
+        std::mutex mutex;
+        // 计数器归零后执行的作业，以及它们各自的计数器
+        std::vector<std::pair<Job, Counter*>> continuations;
+    };
+
+    // 每个线程的统计数据（最后一个是所有非工作线程在等待时帮忙执行的部分）
+    struct WorkerStats {
+        // 执行作业的时间（ms）
+        double busyMs = 0.0;
+        // 执行的作业数
+        unsigned long long jobs = 0;
+        // 从其他队列窃取的作业数
+        unsigned long long steals = 0;
+    };
+
+    /// @brief 构造函数
+    /// @param workerCount 工作线程数，0时所有作业在等待的线程上执行
+    explicit JobSystem(int workerCount) {
+        workerCount = std::max(workerCount, 0);
+        // 最后一个队列是注入队列
+        for (int i = 0; i <= workerCount; ++i) {
+            this->queues.emplace_back(new Queue());
+        }
+        this->resetStats();
+        for (int i = 0; i < workerCount; ++i) {
+            this->threads.emplace_back(&JobSystem::workerLoop, this, i);
+        }
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(this->wakeMutex);
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+        for (auto& thread : this->threads) {
+            thread.join();
+        }
+    }
+
+    /// @brief 默认的工作线程数：硬件线程数减一（提交作业的线程在等待时也会执行作业）
+    static int defaultWorkerCount() {
+        int hardwareThreads = (int)std::thread::hardware_concurrency();
+        return std::max(hardwareThreads - 1, 1);
+    }
+
+    /// @brief 提交一个作业
+    /// @param job 作业
+    /// @param counter 作业完成时减一的计数器，可以为空
+    void run(Job job, Counter* counter = nullptr) {
+        if (counter != nullptr) {
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        }
+        push(Task{ std::move(job), counter });
+    }
+
+    /// @brief 提交一个依赖其他作业的作业，dependency归零后才会执行
+    /// @param dependency 依赖的计数器
+    /// @param job 作业
+    /// @param counter 作业完成时减一的计数器，可以为空
+    void runAfter(Counter& dependency, Job job, Counter* counter = nullptr) {
+        if (counter != nullptr) {
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        }
+        {
+            std::lock_guard<std::mutex> lock(dependency.mutex);
+            if (!dependency.isDone()) {
+                dependency.continuations.emplace_back(std::move(job), counter);
+                return;
+            }
+        }
+        push(Task{ std::move(job), counter });
+    }
+
+    /// @brief 等待计数器归零，等待期间执行队列中的作业
+    /// @param counter 计数器
+    void wait(Counter& counter) {
+        while (!counter.isDone()) {
+            Task task;
+            if (tryTake(currentWorkerIndex(), task)) {
+                execute(task, currentWorkerIndex());
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+        // 最后完成的作业在持有锁时归零，等它释放锁之后调用者才能销毁计数器
+        std::lock_guard<std::mutex> lock(counter.mutex);
+    }
+
+    /// @brief 把[0, count)分成若干块并行执行，返回时所有块都已经完成
+    /// @param count 元素数量
+    /// @param grainSize 每块最少的元素数量，元素数量不超过一块时直接在当前线程执行
+    /// @param func 处理一块元素的函数，参数为[begin, end)
+    void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& func) {
+        grainSize = std::max<size_t>(grainSize, 1);
+        if (count <= grainSize || this->threads.empty()) {
+            if (count > 0) {
+                func(0, count);
+            }
+            return;
+        }
+        // 每个线程（包括当前线程）大约分到4块，便于窃取平衡负载
+        size_t chunks = std::min((count + grainSize - 1) / grainSize, (this->threads.size() + 1) * 4);
+        size_t chunkSize = (count + chunks - 1) / chunks;
+        Counter counter;
+        for (size_t begin = chunkSize; begin < count; begin += chunkSize) {
+            size_t end = std::min(begin + chunkSize, count);
+            run([&func, begin, end]() { func(begin, end); }, &counter);
+        }
+        // 第一块在当前线程执行
+        func(0, std::min(chunkSize, count));
+        wait(counter);
+    }
+
+    /// @brief 获取工作线程数
+    int getWorkerCount() const {
+        return (int)this->threads.size();
+    }
+
+    /// @brief 获取每个线程自上次resetStats以来的统计数据（最后一项为非工作线程）
+    std::vector<WorkerStats> getStats() const {
+        std::vector<WorkerStats> stats(this->queues.size());
+        for (size_t i = 0; i < this->queues.size(); ++i) {
+            stats[i].busyMs = this->queues[i]->busyNs.load(std::memory_order_relaxed) / 1.0e6;
+            stats[i].jobs = this->queues[i]->jobs.load(std::memory_order_relaxed);
+            stats[i].steals = this->queues[i]->steals.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+    /// @brief 获取自上次resetStats以来经过的时间（ms），用来计算每个线程的利用率
+    double getStatsElapsedMs() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->statsStart).count();
+    }
+
+    /// @brief 清空统计数据
+    void resetStats() {
+        for (auto& queue : this->queues) {
+            queue->busyNs.store(0, std::memory_order_relaxed);
+            queue->jobs.store(0, std::memory_order_relaxed);
+            queue->steals.store(0, std::memory_order_relaxed);
+        }
+        this->statsStart = std::chrono::steady_clock::now();
+    }
+
+private:
+    // 队列中的作业
+    struct Task {
+        Job job;
+        Counter* counter = nullptr;
+    };
+
+    // 每个线程的双端队列和统计数据
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::atomic<long long> busyNs{ 0 };
+        std::atomic<unsigned long long> jobs{ 0 };
+        std::atomic<unsigned long long> steals{ 0 };
+    };
+
+    /// @brief 当前线程在这个作业系统中的队列序号，非工作线程返回注入队列的序号
+    int currentWorkerIndex() const {
+        return currentOwner() == this ? currentIndex() : (int)this->queues.size() - 1;
+    }
+
+    static const JobSystem*& currentOwner() {
+        static thread_local const JobSystem* owner = nullptr;
+        return owner;
+    }
+
+    static int& currentIndex() {
+        static thread_local int index = -1;
+        return index;
+    }
+
+    /// @brief 把作业放入当前线程的队列（非工作线程放入注入队列），并唤醒一个空闲的工作线程
+    void push(Task&& task) {
+        Queue& queue = *this->queues[currentWorkerIndex()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        // 在wakeMutex内增加计数：工作线程在同一个锁内检查计数后才睡眠，计数的增加要么被它看到，要么发生在它睡眠之后并唤醒它
+        std::lock_guard<std::mutex> lock(this->wakeMutex);
+        this->queued.fetch_add(1, std::memory_order_release);
+        if (this->sleeping > 0) {
+            this->wake.notify_one();
+        }
+    }
+
+    /// @brief 取出一个作业：先从自己队列的尾部取，再从其他队列（包括注入队列）的头部窃取
+    bool tryTake(int index, Task& task) {
+        if (this->queued.load(std::memory_order_acquire) <= 0) {
+            return false;
+        }
+        int queueCount = (int)this->queues.size();
+        {
+            Queue& own = *this->queues[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                this->queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        for (int k = 1; k < queueCount; ++k) {
+            Queue& victim = *this->queues[(index + k) % queueCount];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                this->queued.fetch_sub(1, std::memory_order_relaxed);
+                this->queues[index]->steals.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief 执行一个作业，完成后更新计数器并放入依赖它的后续作业
+    void execute(Task& task, int index) {
+        auto start = std::chrono::steady_clock::now();
+        task.job();
+        auto end = std::chrono::steady_clock::now();
+        Queue& queue = *this->queues[index];
+        queue.busyNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), std::memory_order_relaxed);
+        queue.jobs.fetch_add(1, std::memory_order_relaxed);
+
+        Counter* counter = task.counter;
+        if (counter == nullptr) {
+            return;
+        }
+        std::vector<std::pair<Job, Counter*>> continuations;
+        {
+            // 与runAfter使用同一个锁，保证后续作业不会在归零之后才被加入而遗漏
+            std::lock_guard<std::mutex> lock(counter->mutex);
+            if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                continuations.swap(counter->continuations);
+            }
+        }
+        // 计数器归零后等待的线程可能立即销毁计数器，之后不能再访问counter
+        for (auto& continuation : continuations) {
+            push(Task{ std::move(continuation.first), continuation.second });
+        }
+    }
+
+    /// @brief 工作线程的主循环
+    void workerLoop(int index) {
+        currentOwner() = this;
+        currentIndex() = index;
+        while (true) {
+            Task task;
+            if (tryTake(index, task)) {
+                execute(task, index);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(this->wakeMutex);
+            if (this->stopping) {
+                break;
+            }
+            // push在同一个锁内增加计数，检查之后的push一定会唤醒这里，不需要超时
+            this->sleeping++;
+            this->wake.wait(lock, [this]() {
+                return this->stopping || this->queued.load(std::memory_order_acquire) > 0;
+                });
+            this->sleeping--;
+        }
+    }
+
+    // 每个工作线程的队列，最后一个是非工作线程提交作业的注入队列
+    std::vector<std::unique_ptr<Queue>> queues;
+    // 工作线程
+    std::vector<std::thread> threads;
+    // 所有队列中的作业数量（空闲时不用逐个检查队列）
+    std::atomic<int> queued{ 0 };
+    // 正在睡眠的工作线程数量（由wakeMutex保护）
+    int sleeping = 0;
+    // 唤醒空闲的工作线程
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    // 统计开始的时间
+    std::chrono::steady_clock::time_point statsStart;
+};
+
+#endif // JOB_SYSTEM_H
@@ -0,0 +1,358 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+// 定义了LightClusters类，实现分簇前向渲染（clustered forward）的光源剔除
+// 视锥体在屏幕x、y方向均匀划分，在深度方向按指数划分为若干簇（froxel），作业系统按深度切片并行地把点光源的包围球分配到与之相交的簇
+// 结果通过纹理缓冲（GL_TEXTURE_BUFFER）上传：光源数据、每个簇的光源列表（偏移、数量）和光源索引，片段着色器只遍历所在簇的光源
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "shader.h"
+#include "JobSystem.h"
+#include "GpuResources.h"
+
+class LightClusters {
+public:
+    // 每个光源在光源数据纹理缓冲中占用的texel数量（RGBA32F）
+    static const int TEXELS_PER_LIGHT = 5;
+
+    /// 一个点光源的数据（颜色已经乘上了光的颜色）
+    struct Light {
+        // 世界空间位置
+        glm::vec3 position;
+        // 影响范围（光照强度衰减到阈值以下的距离）
+        float range;
+        glm::vec3 ambient;
+        glm::vec3 diffuse;
+        glm::vec3 specular;
+        float constant;
+        float linear;
+        float quadratic;
+        // 立方体阴影贴图的第一层，-1表示不投射阴影
+        int shadowLayer = -1;
+    };
+
+    LightClusters() {}
+
+    /// @brief 构造函数
+    /// @param countX 屏幕x方向的簇数量
+    /// @param countY 屏幕y方向的簇数量
+    /// @param countZ 深度方向的簇数量
+    /// @param maxLightsPerCluster 每个簇最多的光源数量，超过的光源会被忽略
+    /// @param jobs 分配光源的作业系统，为空时在调用线程串行分配
+    LightClusters(int countX, int countY, int countZ, int maxLightsPerCluster, JobSystem* jobs) :
+        countX(countX), countY(countY), countZ(countZ), maxLightsPerCluster(maxLightsPerCluster), jobs(jobs) {
+        this->clusterLights.resize(countX * countY * countZ);
+        this->clusterBounds.resize(countX * countY * countZ * 2);
+    }
+
+    /// @brief 计算点光源的影响范围：衰减后的最大颜色分量低于cutoff的距离
+    /// @param light 点光源（range会被忽略）
+    /// @param cutoff 光照强度阈值
+    /// @param maxRange 最大范围（衰减系数不足以让光照衰减到阈值以下时使用）
+    static float computeRange(const Light& light, float cutoff, float maxRange) {
+        glm::vec3 brightest = glm::max(light.ambient, glm::max(light.diffuse, light.specular));
+        float intensity = std::max(brightest.x, std::max(brightest.y, brightest.z));
+        // 解 constant + linear * d + quadratic * d^2 = intensity / cutoff
+        float c = light.constant - intensity / cutoff;
+        if (c >= 0.0f) {
+            return 0.0f;
+        }
+        float range = maxRange;
+        if (light.quadratic > 0.0f) {
+            range = (-light.linear + std::sqrt(light.linear * light.linear - 4.0f * light.quadratic * c)) / (2.0f * light.quadratic);
+        }
+        else if (light.linear > 0.0f) {
+            range = -c / light.linear;
+        }
+        return std::min(range, maxRange);
+    }
+
+    /// @brief 把光源分配到簇中并上传到纹理缓冲
+    /// @param lights 点光源
+    /// @param view 视图矩阵
+    /// @param projection 投影矩阵（对称的透视投影）
+    /// @param nearPlane 摄像机近平面
+    /// @param farPlane 摄像机远平面
+    void update(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane) {
+        auto cpuStart = std::chrono::high_resolution_clock::now();
+        if (projection != this->boundsProjection || nearPlane != this->nearPlane || farPlane != this->farPlane) {
+            this->nearPlane = nearPlane;
+            this->farPlane = farPlane;
+            this->boundsProjection = projection;
+            computeClusterBounds();
+        }
+
+        // 每个光源在视空间中的包围球，以及可能相交的簇的范围（每个光源只算一次）
+        this->lightRanges.resize(lights.size());
+        auto computeRanges = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                computeLightRange(lights[i], view, this->lightRanges[i]);
+            }
+        };
+        // 按深度切片分块，每个作业只写自己的切片，不需要同步
+        for (auto& list : this->clusterLights) {
+            list.clear();
+        }
+        auto assign = [this](size_t begin, size_t end) {
+            assignSlices((int)begin, (int)end);
+        };
+        if (this->jobs == nullptr || lights.size() < PARALLEL_MIN_LIGHTS) {
+            computeRanges(0, lights.size());
+            assign(0, this->countZ);
+        }
+        else {
+            this->jobs->parallelFor(lights.size(), RANGE_GRAIN_SIZE, computeRanges);
+            this->jobs->parallelFor(this->countZ, 1, assign);
+        }
+
+        // 把每个簇的光源列表拼接成一个索引数组
+        this->gridData.resize(this->clusterLights.size() * 2);
+        this->indexData.clear();
+        this->maxClusterLights = 0;
+        for (size_t c = 0; c < this->clusterLights.size(); ++c) {
+            const auto& list = this->clusterLights[c];
+            this->gridData[c * 2] = (unsigned int)this->indexData.size();
+            this->gridData[c * 2 + 1] = (unsigned int)list.size();
+            this->indexData.insert(this->indexData.end(), list.begin(), list.end());
+            this->maxClusterLights = std::max(this->maxClusterLights, (int)list.size());
+        }
+        // 光源数据：位置和范围、环境光和常数项、漫反射和一次项、镜面反射和二次项、阴影的第一层
+        this->lightData.resize(lights.size() * TEXELS_PER_LIGHT);
+        for (size_t i = 0; i < lights.size(); ++i) {
+            const Light& light = lights[i];
+            this->lightData[i * TEXELS_PER_LIGHT + 0] = glm::vec4(light.position, light.range);
+            this->lightData[i * TEXELS_PER_LIGHT + 1] = glm::vec4(light.ambient, light.constant);
+            this->lightData[i * TEXELS_PER_LIGHT + 2] = glm::vec4(light.diffuse, light.linear);
+            this->lightData[i * TEXELS_PER_LIGHT + 3] = glm::vec4(light.specular, light.quadratic);
+            this->lightData[i * TEXELS_PER_LIGHT + 4] = glm::vec4((float)light.shadowLayer, 0.0f, 0.0f, 0.0f);
+        }
+        this->lightCount = (int)lights.size();
+        auto cpuEnd = std::chrono::high_resolution_clock::now();
+        this->lastCpuMs = std::chrono::duration<double, std::milli>(cpuEnd - cpuStart).count();
+
+        upload();
+    }
+
+    /// @brief 把纹理缓冲和簇的参数传递给着色器
+    /// @param shader 着色器
+    /// @param firstTextureUnit 使用的第一个纹理单元（共占用3个）
+    /// @param viewportWidth 当前视口宽度
+    /// @param viewportHeight 当前视口高度
+    void bind(Shader& shader, unsigned int firstTextureUnit, int viewportWidth, int viewportHeight) {
+        unsigned int textures[3] = { this->lightTexture, this->gridTexture, this->indexTexture };
+        const char* names[3] = { "pointLightData", "clusterGrid", "clusterLightIndices" };
+        for (int i = 0; i < 3; ++i) {
+            glActiveTexture(GL_TEXTURE0 + firstTextureUnit + i);
+            glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+            shader.setInt(names[i], firstTextureUnit + i);
+        }
+        glActiveTexture(GL_TEXTURE0);
+        shader.setInt("numPointLights", this->lightCount);
+        glUniform3i(glGetUniformLocation(shader.ID, "clusterCounts"), this->countX, this->countY, this->countZ);
+        shader.setVec2("clusterTileScale", glm::vec2((float)this->countX / (float)viewportWidth, (float)this->countY / (float)viewportHeight));
+        // 深度切片 = log(z) * scale - bias
+        float logRatio = std::log(this->farPlane / this->nearPlane);
+        shader.setFloat("clusterDepthScale", (float)this->countZ / logRatio);
+        shader.setFloat("clusterDepthBias", (float)this->countZ * std::log(this->nearPlane) / logRatio);
+    }
+
+    /// @brief 释放纹理缓冲
+    void release() {
+        if (this->initialized) {
+            GpuResources::deleteBuffer(this->lightBuffer);
+            GpuResources::deleteBuffer(this->gridBuffer);
+            GpuResources::deleteBuffer(this->indexBuffer);
+            GpuResources::deleteTexture(this->lightTexture);
+            GpuResources::deleteTexture(this->gridTexture);
+            GpuResources::deleteTexture(this->indexTexture);
+            this->initialized = false;
+        }
+    }
+
+    /// @brief 设置分配光源的作业系统，为空时串行分配
+    void setJobSystem(JobSystem* jobs) { this->jobs = jobs; }
+    /// @brief 上一次分配光源的CPU耗时（ms）
+    double getLastCpuMs() const { return this->lastCpuMs; }
+    /// @brief 光源数量
+    int getLightCount() const { return this->lightCount; }
+    /// @brief 光源索引的总数（每个簇的光源数量之和）
+    int getIndexCount() const { return (int)this->indexData.size(); }
+    /// @brief 光源最多的簇的光源数量
+    int getMaxClusterLights() const { return this->maxClusterLights; }
+    /// @brief 簇的总数
+    int getClusterCount() const { return this->countX * this->countY * this->countZ; }
+
+private:
+    /// 光源在视空间中的包围球以及可能相交的簇的范围
+    struct LightRange {
+        glm::vec3 center;
+        float radius;
+        int minX, maxX, minY, maxY, minZ, maxZ;
+    };
+
+    int countX = 0, countY = 0, countZ = 0;
+    // 光源数量少于这个值时串行分配，提交作业的开销比分配本身更大
+    static const size_t PARALLEL_MIN_LIGHTS = 64;
+    // 计算包围球时每个作业最少的光源数量
+    static const size_t RANGE_GRAIN_SIZE = 256;
+
+    int maxLightsPerCluster = 0;
+    // 分配光源的作业系统
+    JobSystem* jobs = nullptr;
+    float nearPlane = 0.0f, farPlane = 0.0f;
+    // 计算簇包围盒时使用的投影矩阵
+    glm::mat4 boundsProjection = glm::mat4(0.0f);
+    // 每个簇在视空间中的包围盒（最小点、最大点）
+    std::vector<glm::vec3> clusterBounds;
+    // 每个簇的光源列表
+    std::vector<std::vector<unsigned int>> clusterLights;
+    std::vector<LightRange> lightRanges;
+    // 上传到纹理缓冲的数据
+    std::vector<glm::vec4> lightData;
+    std::vector<unsigned int> gridData;
+    std::vector<unsigned int> indexData;
+    int lightCount = 0;
+    int maxClusterLights = 0;
+    double lastCpuMs = 0.0;
+    // 纹理缓冲
+    bool initialized = false;
+    unsigned int lightBuffer = 0, gridBuffer = 0, indexBuffer = 0;
+    unsigned int lightTexture = 0, gridTexture = 0, indexTexture = 0;
+
+    /// @brief 第k个深度切片的近处距离
+    float sliceDepth(int k) const {
+        return this->nearPlane * std::pow(this->farPlane / this->nearPlane, (float)k / (float)this->countZ);
+    }
+
+    /// @brief 计算每个簇在视空间中的包围盒（只在投影矩阵变化时计算）
+    void computeClusterBounds() {
+        float scaleX = this->boundsProjection[0][0];
+        float scaleY = this->boundsProjection[1][1];
+        for (int z = 0; z < this->countZ; ++z) {
+            float depths[2] = { sliceDepth(z), sliceDepth(z + 1) };
+            for (int y = 0; y < this->countY; ++y) {
+                for (int x = 0; x < this->countX; ++x) {
+                    glm::vec3 minPoint(std::numeric_limits<float>::max());
+                    glm::vec3 maxPoint(std::numeric_limits<float>::lowest());
+                    // 簇的8个顶点：两个深度上的屏幕块的4个角
+                    for (int k = 0; k < 8; ++k) {
+                        float ndcX = -1.0f + 2.0f * (float)(x + (k & 1)) / (float)this->countX;
+                        float ndcY = -1.0f + 2.0f * (float)(y + ((k >> 1) & 1)) / (float)this->countY;
+                        float d = depths[k >> 2];
+                        glm::vec3 corner(ndcX * d / scaleX, ndcY * d / scaleY, -d);
+                        minPoint = glm::min(minPoint, corner);
+                        maxPoint = glm::max(maxPoint, corner);
+                    }
+                    int index = clusterIndex(x, y, z);
+                    this->clusterBounds[index * 2] = minPoint;
+                    this->clusterBounds[index * 2 + 1] = maxPoint;
+                }
+            }
+        }
+    }
+
+    int clusterIndex(int x, int y, int z) const {
+        return (z * this->countY + y) * this->countX + x;
+    }
+
+    /// @brief 计算光源的视空间包围球，以及保守估计的簇范围（之后再逐个簇做球与包围盒的相交测试）
+    void computeLightRange(const Light& light, const glm::mat4& view, LightRange& range) const {
+        range.center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+        range.radius = light.range;
+        float nearDepth = -range.center.z - range.radius;
+        float farDepth = -range.center.z + range.radius;
+        // 完全在视锥体深度范围之外的光源不分配给任何簇
+        if (range.radius <= 0.0f || farDepth < this->nearPlane || nearDepth > this->farPlane) {
+            range.minZ = 0;
+            range.maxZ = -1;
+            return;
+        }
+        nearDepth = std::max(nearDepth, this->nearPlane);
+        farDepth = std::min(farDepth, this->farPlane);
+        float logRatio = std::log(this->farPlane / this->nearPlane);
+        range.minZ = std::clamp((int)std::floor(std::log(nearDepth / this->nearPlane) / logRatio * this->countZ), 0, this->countZ - 1);
+        range.maxZ = std::clamp((int)std::floor(std::log(farDepth / this->nearPlane) / logRatio * this->countZ), 0, this->countZ - 1);
+        // 包围球的视空间包围盒投影到屏幕上的范围：x/d在包围盒的角点取极值
+        float scales[2] = { this->boundsProjection[0][0], this->boundsProjection[1][1] };
+        float centers[2] = { range.center.x, range.center.y };
+        int counts[2] = { this->countX, this->countY };
+        int* minTiles[2] = { &range.minX, &range.minY };
+        int* maxTiles[2] = { &range.maxX, &range.maxY };
+        for (int axis = 0; axis < 2; ++axis) {
+            float minNdc = std::numeric_limits<float>::max();
+            float maxNdc = std::numeric_limits<float>::lowest();
+            for (float v : { centers[axis] - range.radius, centers[axis] + range.radius }) {
+                for (float d : { nearDepth, farDepth }) {
+                    float ndc = v * scales[axis] / d;
+                    minNdc = std::min(minNdc, ndc);
+                    maxNdc = std::max(maxNdc, ndc);
+                }
+            }
+            *minTiles[axis] = std::clamp((int)std::floor((minNdc * 0.5f + 0.5f) * counts[axis]), 0, counts[axis] - 1);
+            *maxTiles[axis] = std::clamp((int)std::floor((maxNdc * 0.5f + 0.5f) * counts[axis]), 0, counts[axis] - 1);
+        }
+    }
+
+    /// @brief 分配第[sliceBegin, sliceEnd)个深度切片中的簇的光源
+    void assignSlices(int sliceBegin, int sliceEnd) {
+        for (size_t i = 0; i < this->lightRanges.size(); ++i) {
+            const LightRange& range = this->lightRanges[i];
+            float radius2 = range.radius * range.radius;
+            int lastZ = std::min(range.maxZ, sliceEnd - 1);
+            for (int z = std::max(range.minZ, sliceBegin); z <= lastZ; ++z) {
+                for (int y = range.minY; y <= range.maxY; ++y) {
+                    for (int x = range.minX; x <= range.maxX; ++x) {
+                        int index = clusterIndex(x, y, z);
+                        // 球与包围盒相交测试：包围盒上离球心最近的点
+                        glm::vec3 closest = glm::clamp(range.center, this->clusterBounds[index * 2], this->clusterBounds[index * 2 + 1]);
+                        glm::vec3 offset = closest - range.center;
+                        auto& list = this->clusterLights[index];
+                        if (glm::dot(offset, offset) <= radius2 && (int)list.size() < this->maxLightsPerCluster) {
+                            list.push_back((unsigned int)i);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /// @brief 上传数据到纹理缓冲（每次重新分配存储，避免等待GPU使用完上一帧的数据）
+    void upload() {
+        if (!this->initialized) {
+            this->lightBuffer = GpuResources::createBuffer("cluster lights", "LightClusters");
+            this->gridBuffer = GpuResources::createBuffer("cluster grid", "LightClusters");
+            this->indexBuffer = GpuResources::createBuffer("cluster light indices", "LightClusters");
+            this->lightTexture = GpuResources::createTexture(GL_TEXTURE_BUFFER, "cluster lights", "LightClusters");
+            this->gridTexture = GpuResources::createTexture(GL_TEXTURE_BUFFER, "cluster grid", "LightClusters");
+            this->indexTexture = GpuResources::createTexture(GL_TEXTURE_BUFFER, "cluster light indices", "LightClusters");
+            this->initialized = true;
+        }
+        // 空的缓冲不能作为纹理缓冲的存储，至少保留一个元素
+        glm::vec4 emptyLight(0.0f);
+        unsigned int emptyIndex = 0;
+        uploadBuffer(this->lightBuffer, this->lightTexture, GL_RGBA32F,
+            this->lightData.empty() ? (const void*)&emptyLight : (const void*)this->lightData.data(),
+            std::max<size_t>(this->lightData.size(), 1) * sizeof(glm::vec4));
+        uploadBuffer(this->gridBuffer, this->gridTexture, GL_RG32UI, this->gridData.data(), this->gridData.size() * sizeof(unsigned int));
+        uploadBuffer(this->indexBuffer, this->indexTexture, GL_R32UI,
+            this->indexData.empty() ? (const void*)&emptyIndex : (const void*)this->indexData.data(),
+            std::max<size_t>(this->indexData.size(), 1) * sizeof(unsigned int));
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    void uploadBuffer(unsigned int buffer, unsigned int texture, GLenum format, const void* data, size_t bytes) {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, bytes, data, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+};
+
+#endif // LIGHT_CLUSTERS_H
@@ -6,6 +6,8 @@
 #include <string>
 #include <vector>
 #include "shader.h"
+#include "RenderStats.h"
+#include "GpuResources.h"
 
 using std::string;
 using std::vector;
@@ -52,6 +54,10 @@ public:
     vector<unsigned int> indices;
     // 纹理数据
     vector<Texture> textures;
+    // 是否有法线贴图（用于选择着色器变体）
+    bool hasNormalMap = false;
+    // 是否有镜面光贴图（用于选择着色器变体）
+    bool hasSpecularMap = false;
 
     // 构造函数
     Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures) {
@@ -59,12 +65,16 @@ public:
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        for (const auto& texture : textures) {
+            this->hasNormalMap = this->hasNormalMap || texture.type == "texture_normal";
+            this->hasSpecularMap = this->hasSpecularMap || texture.type == "texture_specular";
+        }
 
         setupMesh();
     }
 
     // 绘制函数
-    void draw(Shader& shader, vector<unsigned int> directionLightDepthMaps, bool isActiveTexture, vector<unsigned int> d_d2_filter_maps, bool is_d_d2, bool isLightMap, unsigned int lightMap) {
+    void draw(Shader& shader, unsigned int directionLightDepthMap, unsigned int shadowCompareSampler, bool isActiveTexture, unsigned int d_d2_filter_map, bool is_d_d2, bool isLightMap, unsigned int lightMap) {
         // 是否激活纹理
         if (isActiveTexture) {
             unsigned int diffuseNr = 0;
@@ -106,29 +116,33 @@ public:
                 shader.setVec3("material" + number + ".specular", textures[i].specular);
                 // 传递高光系数给着色器
                 shader.setFloat("material" + number + ".shininess", textures[i].shininess);
-                // 设置采用法线贴图
-                shader.setBool("material" + number + ".sampleNormalMap", name == "texture_normal");
-                // 设置采用镜面光贴图
-                shader.setBool("material" + number + ".sampleSpecularMap", name == "texture_specular");
             }
+            // 设置是否采用法线贴图和镜面光贴图（按网格实际拥有的贴图，与着色器变体的选择保持一致）
+            shader.setBool("material0.sampleNormalMap", this->hasNormalMap);
+            shader.setBool("material0.sampleSpecularMap", this->hasSpecularMap);
 
             int j = 0;
+            // 所有定向光的所有级联都在同一个纹理数组中，只占用一个纹理单元
+            glActiveTexture(GL_TEXTURE0 + i + j);
             if (!is_d_d2) {
-                // 设置定向光深度贴图
-                for (; j < directionLightDepthMaps.size(); j++) {
-                    glActiveTexture(GL_TEXTURE0 + i + j);
-                    glBindTexture(GL_TEXTURE_2D, directionLightDepthMaps[j]);
-                    shader.setInt("directionalLights[" + std::to_string(j) + "].shadowMap", i + j);
-                }
+                // 设置定向光深度贴图数组
+                glBindTexture(GL_TEXTURE_2D_ARRAY, directionLightDepthMap);
             }
             else {
-                // 设置定向光均值和方差贴图
-                for (; j * 2 + 1 < d_d2_filter_maps.size(); j++) {
-                    glActiveTexture(GL_TEXTURE0 + i + j);
-                    glBindTexture(GL_TEXTURE_2D, d_d2_filter_maps[j * 2 + 1]);
-                    shader.setInt("directionalLights[" + std::to_string(j) + "].d_d2_filter", i + j);
-                }
+                // 设置定向光均值和方差贴图数组
+                glBindTexture(GL_TEXTURE_2D_ARRAY, d_d2_filter_map);
             }
+            // 两个采样器都指向这个纹理单元，避免未使用的采样器和材质的sampler2D共用0号单元
+            shader.setInt("shadowMapArray", i + j);
+            shader.setInt("d_d2_filterArray", i + j);
+            j++;
+            // 同一个深度贴图数组再绑定到一个使用比较采样器的纹理单元，供硬件PCF使用
+            // sampler2DArrayShadow总是需要一个独立的纹理单元，否则会和其他类型的采样器冲突
+            glActiveTexture(GL_TEXTURE0 + i + j);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, directionLightDepthMap);
+            glBindSampler(i + j, shadowCompareSampler);
+            shader.setInt("shadowMapArrayCompare", i + j);
+            j++;
 
             if (isLightMap) {
                 // 设置光照贴图
@@ -141,23 +155,54 @@ public:
         // 绘制网格
         glBindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        RenderStats::recordDraw(indices.size() / 3);
 
+        if (isActiveTexture) {
+            // 解绑比较采样器，避免影响之后使用这个纹理单元的绘制
+            glBindSampler(textures.size() + 1, 0);
+        }
         // 恢复默认纹理单元
         glActiveTexture(GL_TEXTURE0);
         // 解绑VAO
         glBindVertexArray(0);
     }
 
+    // 深度绘制函数（阴影/深度pass使用）
+    // 只绑定紧密排列的位置VAO，不设置任何纹理和材质，也不解绑VAO，方便连续绘制
+    void drawDepth() const {
+        glBindVertexArray(depthVAO);
+        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        RenderStats::recordDraw(indices.size() / 3);
+    }
+
+    // 实例化深度绘制函数（单次提交渲染多层阴影贴图使用），每个实例对应阴影贴图数组的一层
+    void drawDepthInstanced(int instanceCount) const {
+        glBindVertexArray(depthVAO);
+        glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, instanceCount);
+        RenderStats::recordDraw(indices.size() / 3, instanceCount);
+    }
+
+    // 释放渲染数据（Mesh按值复制，所有副本共用同一组对象，只能由持有它的Model释放一次）
+    void release() {
+        GpuResources::deleteVertexArray(VAO);
+        GpuResources::deleteBuffer(VBO);
+        GpuResources::deleteBuffer(EBO);
+        GpuResources::deleteVertexArray(depthVAO);
+        GpuResources::deleteBuffer(positionVBO);
+    }
+
 private:
     // 渲染数据
     unsigned int VAO, VBO, EBO;
+    // 只包含顶点位置的渲染数据（12字节/顶点，而不是完整Vertex的56字节）
+    unsigned int depthVAO, positionVBO;
 
     // 初始化渲染数据
     void setupMesh() {
         // 生成VAO，VBO，EBO
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        VAO = GpuResources::createVertexArray("mesh VAO");
+        VBO = GpuResources::createBuffer("mesh vertices");
+        EBO = GpuResources::createBuffer("mesh indices");
 
         // 绑定VAO
         glBindVertexArray(VAO);
@@ -189,6 +234,25 @@ private:
 
         // 解绑VAO
         glBindVertexArray(0);
+
+        // 单独的位置数据流，供只需要位置的深度pass使用
+        vector<glm::vec3> positions(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            positions[i] = vertices[i].Position;
+        }
+        depthVAO = GpuResources::createVertexArray("mesh depth VAO");
+        positionVBO = GpuResources::createBuffer("mesh positions");
+
+        glBindVertexArray(depthVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
+        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+        // 与完整VAO共用索引缓冲
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        // 顶点位置（唯一启用的属性）
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+
+        glBindVertexArray(0);
     }
 };
 
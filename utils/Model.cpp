@@ -2,14 +2,40 @@
 // #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
-void Model::draw(Shader& shader, vector<unsigned int> directionLightDepthMaps, bool isActiveTexture, vector<unsigned int> d_d2_filter_maps, bool is_d_d2, bool isLightMap, unsigned int lightMap) {
+void Model::draw(Shader& shader, unsigned int directionLightDepthMap, unsigned int shadowCompareSampler, bool isActiveTexture, unsigned int d_d2_filter_map, bool is_d_d2, bool isLightMap, unsigned int lightMap) {
     // 遍历所有网格，并调用它们各自的draw函数
     for (unsigned int i = 0; i < meshes.size(); i++) {
-        meshes[i].draw(shader, directionLightDepthMaps, isActiveTexture, d_d2_filter_maps, is_d_d2, isLightMap, lightMap);
+        meshes[i].draw(shader, directionLightDepthMap, shadowCompareSampler, isActiveTexture, d_d2_filter_map, is_d_d2, isLightMap, lightMap);
     }
 }
 
+void Model::drawDepth() const {
+    for (unsigned int i = 0; i < meshes.size(); i++) {
+        meshes[i].drawDepth();
+    }
+}
+
+void Model::drawDepthInstanced(int instanceCount) const {
+    for (unsigned int i = 0; i < meshes.size(); i++) {
+        meshes[i].drawDepthInstanced(instanceCount);
+    }
+}
+
+void Model::release() {
+    for (auto& mesh : this->meshes) {
+        mesh.release();
+    }
+    // 网格引用的纹理都记录在textures_loaded中，每个纹理只删除一次
+    for (auto& texture : this->textures_loaded) {
+        GpuResources::deleteTexture(texture.id);
+    }
+    this->meshes.clear();
+    this->textures_loaded.clear();
+}
+
 void Model::loadModel(string path, vector<vertex_t>& lightVertices, vector<unsigned int>& lightIndices) {
+    // 这个模型的网格和纹理在显存统计中归属于模型文件
+    GpuResources::OwnerScope ownerScope(path);
     // 读取文件，将模型数据存储在scene中
     Assimp::Importer importer;
     // 预处理参数
@@ -46,14 +72,7 @@ void Model::processNode(aiNode* node, const aiScene* scene, vector<vertex_t>& li
     }
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene, vector<vertex_t>& lightVertices, vector<unsigned int>& lightIndices) {
-    // 顶点数据
-    vector<Vertex> vertices;
-    // 索引数据
-    vector<unsigned int> indices;
-    // 纹理数据
-    vector<Texture> textures;
-
+void Model::convertMesh(const aiMesh* mesh, vector<Vertex>& vertices, vector<unsigned int>& indices, vector<vertex_t>& lightVertices, vector<unsigned int>& lightIndices, glm::vec3& boundsMin, glm::vec3& boundsMax) {
     // 遍历网格的所有顶点，取出位置、法线、纹理坐标
     for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
         // 处理网格的顶点
@@ -65,6 +84,9 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene, vector<vertex_t>& li
         vector.y = mesh->mVertices[i].y;
         vector.z = mesh->mVertices[i].z;
         vertex.Position = vector;
+        // 更新包围盒
+        boundsMin = glm::min(boundsMin, vector);
+        boundsMax = glm::max(boundsMax, vector);
         lightVertex.p[0] = vector.x;
         lightVertex.p[1] = vector.y;
         lightVertex.p[2] = vector.z;
@@ -116,6 +138,18 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene, vector<vertex_t>& li
             lightIndices.push_back(face.mIndices[j]);
         }
     }
+}
+
+Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene, vector<vertex_t>& lightVertices, vector<unsigned int>& lightIndices) {
+    // 顶点数据
+    vector<Vertex> vertices;
+    // 索引数据
+    vector<unsigned int> indices;
+    // 纹理数据
+    vector<Texture> textures;
+
+    // 取出顶点和索引（不访问OpenGL）
+    convertMesh(mesh, vertices, indices, lightVertices, lightIndices, this->boundsMin, this->boundsMax);
 
     // 处理网格的材质
     if (mesh->mMaterialIndex >= 0) {
@@ -141,8 +175,7 @@ unsigned int TextureFromFile(const char* path, const string& directory, bool gam
     std::filesystem::path filePath(path);
 
     string fullPath = (dirPath / filePath).string();
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    unsigned int textureID = GpuResources::createTexture(GL_TEXTURE_2D, filePath.string().c_str());
 
     int width, height, nrComponents;
     std::cout << fullPath << std::endl;
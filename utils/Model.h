@@ -12,6 +12,7 @@
 #include <filesystem>
 #include <fstream>
 #include <sstream>
+#include <limits>
 
 using std::vector;
 using std::string;
@@ -31,6 +32,9 @@ public:
     vector<Mesh> meshes;
     // 目录
     string directory;
+    // 模型空间的包围盒
+    glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
 
     // 构造函数
     Model(string const& path, vector<vertex_t>& lightVertices, vector<unsigned int>& lightIndices) {
@@ -38,7 +42,15 @@ public:
     }
 
     // 绘制函数
-    void draw(Shader& shader, vector<unsigned int> directionLightDepthMaps, bool isActiveTexture, vector<unsigned int> d_d2_filter_maps, bool is_d_d2, bool isLightMap, unsigned int lightMap);
+    void draw(Shader& shader, unsigned int directionLightDepthMap, unsigned int shadowCompareSampler, bool isActiveTexture, unsigned int d_d2_filter_map, bool is_d_d2, bool isLightMap, unsigned int lightMap);
+    // 深度绘制函数，只使用位置数据流，不设置材质（阴影/深度pass使用）
+    void drawDepth() const;
+    // 实例化深度绘制函数，每个实例对应阴影贴图数组的一层
+    void drawDepthInstanced(int instanceCount) const;
+    // 释放所有网格和纹理（需要在上下文销毁之前调用）
+    void release();
+    // 把assimp的网格转换为顶点和索引数据，并扩展包围盒（不访问OpenGL，基准测试也会单独调用）
+    static void convertMesh(const aiMesh* mesh, vector<Vertex>& vertices, vector<unsigned int>& indices, vector<vertex_t>& lightVertices, vector<unsigned int>& lightIndices, glm::vec3& boundsMin, glm::vec3& boundsMax);
 
 private:
 
@@ -0,0 +1,39 @@
+#ifndef PARALLEL_IMAGE_H
+#define PARALLEL_IMAGE_H
+
+// 光照贴图后处理的并行版本：按行分块交给作业系统，每块调用lightmapper.h中与串行版本相同的按行处理函数，结果与lmImageDilate/lmImageSmooth相同
+// 每一行只读取输入图像、只写输出图像的这一行，块之间不需要同步
+
+#include "JobSystem.h"
+#include "lightmapper.h"
+
+// 每块最少的行数
+static const size_t PARALLEL_IMAGE_GRAIN_ROWS = 16;
+
+/// @brief 把非零区域扩大一个像素（与lmImageDilate相同）
+/// @param jobs 作业系统
+/// @param image 输入图像
+/// @param outImage 输出图像（不能与输入相同）
+/// @param w 宽度
+/// @param h 高度
+/// @param c 通道数（1~4）
+inline void parallelImageDilate(JobSystem& jobs, const float* image, float* outImage, int w, int h, int c) {
+    jobs.parallelFor((size_t)h, PARALLEL_IMAGE_GRAIN_ROWS, [=](size_t rowBegin, size_t rowEnd) {
+        lmImageDilateRows(image, outImage, w, h, c, (int)rowBegin, (int)rowEnd);
+        });
+}
+
+/// @brief 只对非零值做3x3盒式滤波（与lmImageSmooth相同）
+/// @param jobs 作业系统
+/// @param image 输入图像
+/// @param outImage 输出图像（不能与输入相同）
+/// @param w 宽度
+/// @param h 高度
+/// @param c 通道数（1~4）
+inline void parallelImageSmooth(JobSystem& jobs, const float* image, float* outImage, int w, int h, int c) {
+    jobs.parallelFor((size_t)h, PARALLEL_IMAGE_GRAIN_ROWS, [=](size_t rowBegin, size_t rowEnd) {
+        lmImageSmoothRows(image, outImage, w, h, c, (int)rowBegin, (int)rowEnd);
+        });
+}
+
+#endif // PARALLEL_IMAGE_H
@@ -0,0 +1,337 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// 定义了Profiler类，按作用域测量每个渲染pass的CPU和GPU耗时
+// GPU耗时使用GL_TIMESTAMP查询（GL_TIME_ELAPSED查询不能嵌套，也不能与场景中已有的GpuTimer同时使用）
+// 每帧的查询对象放在一个帧环形缓冲区中，只读取已经可用的结果，GPU落后太多时丢弃最旧的一帧，不会让CPU等待GPU
+// 结果定期输出到控制台，也可以录制若干帧导出为Chrome trace（chrome://tracing或Perfetto）的JSON
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Profiler {
+public:
+    // 帧环形缓冲区的大小，需要大于GPU落后CPU的帧数
+    static const int FRAME_LATENCY = 4;
+    // 每帧最多记录的作用域数量（基准测试在一帧内循环渲染时超过的部分不记录）
+    static const int MAX_SCOPES_PER_FRAME = 512;
+
+    // 作用域计时：构造时开始，析构时结束
+    class Scope {
+    public:
+        /// @brief 开始一个作用域
+        /// @param profiler 性能分析器
+        /// @param name 作用域名称
+        /// @param gpu 是否同时测量GPU耗时
+        Scope(Profiler& profiler, const std::string& name, bool gpu = true) : profiler(profiler) {
+            this->event = profiler.beginScope(name, gpu);
+        }
+        ~Scope() {
+            this->profiler.endScope(this->event);
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Profiler& profiler;
+        int event;
+    };
+
+    Profiler() {}
+
+    /// @brief 构造函数
+    /// @param reportInterval 输出统计的间隔（帧），0为不输出
+    explicit Profiler(unsigned int reportInterval) : reportInterval(reportInterval) {}
+
+    /// @brief 开始一帧（在拥有上下文的线程调用）：读取已经完成的帧，复用最旧的一帧的查询对象
+    void beginFrame() {
+        this->current = (this->current + 1) % FRAME_LATENCY;
+        Frame& frame = this->frames[this->current];
+        if (frame.pending && !collect(frame, true)) {
+            this->droppedFrames++;
+        }
+        frame.events.clear();
+        frame.usedQueries = 0;
+        frame.pending = true;
+        this->stack.clear();
+        this->inFrame = true;
+    }
+
+    /// @brief 结束一帧：读取所有已经可用的结果，定期输出统计
+    void endFrame() {
+        this->inFrame = false;
+        // 从最旧的一帧开始读取，当前帧的结果通常还不可用
+        for (int k = 1; k <= FRAME_LATENCY; k++) {
+            Frame& frame = this->frames[(this->current + k) % FRAME_LATENCY];
+            if (frame.pending) {
+                collect(frame, false);
+            }
+        }
+        if (this->reportInterval > 0 && this->collectedFrames >= this->reportInterval) {
+            report();
+        }
+    }
+
+    /// @brief 开始一个作用域，返回事件序号（不在帧内或者超过数量限制时返回-1）
+    int beginScope(const std::string& name, bool gpu) {
+        Frame& frame = this->frames[this->current];
+        if (!this->inFrame || (int)frame.events.size() >= MAX_SCOPES_PER_FRAME) {
+            return -1;
+        }
+        Event event;
+        event.name = getNameIndex(name);
+        event.depth = (int)this->stack.size();
+        if (gpu) {
+            event.gpuQuery = nextQuery(frame);
+            glQueryCounter(frame.queries[event.gpuQuery], GL_TIMESTAMP);
+            nextQuery(frame);
+        }
+        event.cpuStartNs = nowNs();
+        frame.events.push_back(event);
+        this->stack.push_back((int)frame.events.size() - 1);
+        return (int)frame.events.size() - 1;
+    }
+
+    /// @brief 结束一个作用域
+    void endScope(int index) {
+        if (index < 0 || !this->inFrame) {
+            return;
+        }
+        Frame& frame = this->frames[this->current];
+        Event& event = frame.events[index];
+        event.cpuEndNs = nowNs();
+        if (event.gpuQuery >= 0) {
+            glQueryCounter(frame.queries[event.gpuQuery + 1], GL_TIMESTAMP);
+        }
+        if (!this->stack.empty()) {
+            this->stack.pop_back();
+        }
+    }
+
+    /// @brief 录制接下来的若干帧，完成后导出为Chrome trace的JSON文件
+    /// @param frameCount 帧数
+    /// @param fileName 文件名
+    void startCapture(unsigned int frameCount, const std::string& fileName) {
+        this->captureEvents.clear();
+        this->captureRemaining = frameCount;
+        this->captureFile = fileName;
+        // GPU时间戳与CPU时钟的偏移，用来把GPU事件放到同一条时间轴上
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        this->gpuClockOffsetNs = (long long)gpuNow - nowNs();
+        std::cout << "[profiler] capturing " << frameCount << " frames to " << fileName << std::endl;
+    }
+
+    /// @brief 是否正在录制
+    bool isCapturing() const {
+        return this->captureRemaining > 0;
+    }
+
+    /// @brief 释放查询对象
+    void release() {
+        for (auto& frame : this->frames) {
+            if (!frame.queries.empty()) {
+                glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+                frame.queries.clear();
+            }
+            frame.pending = false;
+        }
+    }
+
+private:
+    // 一个作用域的记录
+    struct Event {
+        int name = 0;
+        int depth = 0;
+        long long cpuStartNs = 0;
+        long long cpuEndNs = 0;
+        // 开始时间戳的查询序号（结束为下一个），-1表示不测量GPU
+        int gpuQuery = -1;
+    };
+    // 一帧的记录和查询对象
+    struct Frame {
+        std::vector<Event> events;
+        std::vector<GLuint> queries;
+        int usedQueries = 0;
+        // 是否还有未读取的结果
+        bool pending = false;
+    };
+    // 每个作用域的统计
+    struct Stats {
+        double cpuMs = 0.0;
+        double gpuMs = 0.0;
+        unsigned int cpuSamples = 0;
+        unsigned int gpuSamples = 0;
+        int depth = 0;
+    };
+    // 录制的一个事件（时间为CPU时钟，ns）
+    struct CaptureEvent {
+        int name;
+        bool gpu;
+        long long startNs;
+        long long durationNs;
+    };
+
+    static long long nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    int getNameIndex(const std::string& name) {
+        auto it = this->nameIndices.find(name);
+        if (it != this->nameIndices.end()) {
+            return it->second;
+        }
+        int index = (int)this->names.size();
+        this->names.push_back(name);
+        this->nameIndices[name] = index;
+        this->stats.push_back(Stats());
+        return index;
+    }
+
+    /// @brief 获取帧中下一个查询对象的序号，不够时生成新的查询对象
+    int nextQuery(Frame& frame) {
+        if (frame.usedQueries == (int)frame.queries.size()) {
+            size_t oldSize = frame.queries.size();
+            frame.queries.resize(std::max<size_t>(oldSize * 2, 32));
+            glGenQueries((GLsizei)(frame.queries.size() - oldSize), frame.queries.data() + oldSize);
+        }
+        return frame.usedQueries++;
+    }
+
+    /// @brief 读取一帧的结果
+    /// @param frame 帧
+    /// @param discardIfBusy 结果还不可用时是否丢弃这一帧（查询对象即将被复用）
+    /// @return 是否读取成功
+    bool collect(Frame& frame, bool discardIfBusy) {
+        if (frame.usedQueries > 0) {
+            // 同一帧的查询按提交顺序完成，最后一个可用时所有结果都可用
+            GLint available = 0;
+            glGetQueryObjectiv(frame.queries[frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                if (discardIfBusy) {
+                    frame.pending = false;
+                }
+                return false;
+            }
+        }
+        for (const Event& event : frame.events) {
+            Stats& stat = this->stats[event.name];
+            stat.depth = event.depth;
+            long long cpuNs = event.cpuEndNs - event.cpuStartNs;
+            stat.cpuMs += cpuNs / 1.0e6;
+            stat.cpuSamples++;
+            if (this->captureRemaining > 0) {
+                this->captureEvents.push_back({ event.name, false, event.cpuStartNs, cpuNs });
+            }
+            if (event.gpuQuery >= 0) {
+                GLuint64 start = 0, end = 0;
+                glGetQueryObjectui64v(frame.queries[event.gpuQuery], GL_QUERY_RESULT, &start);
+                glGetQueryObjectui64v(frame.queries[event.gpuQuery + 1], GL_QUERY_RESULT, &end);
+                long long gpuNs = end > start ? (long long)(end - start) : 0;
+                stat.gpuMs += gpuNs / 1.0e6;
+                stat.gpuSamples++;
+                if (this->captureRemaining > 0) {
+                    this->captureEvents.push_back({ event.name, true, (long long)start - this->gpuClockOffsetNs, gpuNs });
+                }
+            }
+        }
+        frame.pending = false;
+        this->collectedFrames++;
+        if (this->captureRemaining > 0 && --this->captureRemaining == 0) {
+            writeCapture();
+        }
+        return true;
+    }
+
+    /// @brief 输出每个作用域的平均耗时并清空统计
+    void report() {
+        std::cout << "[profiler] average of " << this->collectedFrames << " frames (" << this->droppedFrames << " dropped), cpu / gpu ms:" << std::endl;
+        std::cout << std::fixed << std::setprecision(3);
+        for (size_t i = 0; i < this->names.size(); ++i) {
+            Stats& stat = this->stats[i];
+            if (stat.cpuSamples == 0) {
+                continue;
+            }
+            // 每帧的总耗时（一帧内多次进入同一个作用域时累加）
+            std::cout << "[profiler] " << std::string(stat.depth * 2, ' ') << this->names[i] << ": " << stat.cpuMs / this->collectedFrames;
+            if (stat.gpuSamples > 0) {
+                std::cout << " / " << stat.gpuMs / this->collectedFrames;
+            }
+            std::cout << " (" << (double)stat.cpuSamples / this->collectedFrames << " per frame)" << std::endl;
+            stat = Stats();
+        }
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+        this->collectedFrames = 0;
+        this->droppedFrames = 0;
+    }
+
+    /// @brief 把录制的事件写成Chrome trace的JSON
+    void writeCapture() {
+        std::ofstream file(this->captureFile);
+        if (!file) {
+            std::cout << "[profiler] failed to write " << this->captureFile << std::endl;
+            return;
+        }
+        long long origin = std::numeric_limits<long long>::max();
+        for (const auto& event : this->captureEvents) {
+            origin = std::min(origin, event.startNs);
+        }
+        file << "{\"traceEvents\":[\n";
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU (render thread)\"}},\n";
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+        file << std::fixed << std::setprecision(3);
+        for (const auto& event : this->captureEvents) {
+            file << ",\n{\"name\":\"" << escape(this->names[event.name]) << "\",\"cat\":\"" << (event.gpu ? "gpu" : "cpu")
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (event.gpu ? 2 : 1)
+                << ",\"ts\":" << (event.startNs - origin) / 1000.0 << ",\"dur\":" << event.durationNs / 1000.0 << "}";
+        }
+        file << "\n]}\n";
+        std::cout << "[profiler] wrote " << this->captureEvents.size() << " events to " << this->captureFile << std::endl;
+        this->captureEvents.clear();
+    }
+
+    static std::string escape(const std::string& text) {
+        std::string result;
+        for (char ch : text) {
+            if (ch == '"' || ch == '\\') {
+                result.push_back('\\');
+            }
+            result.push_back(ch);
+        }
+        return result;
+    }
+
+    // 输出统计的间隔（帧）
+    unsigned int reportInterval = 0;
+    // 帧环形缓冲区
+    Frame frames[FRAME_LATENCY];
+    int current = 0;
+    // 是否在beginFrame和endFrame之间
+    bool inFrame = false;
+    // 当前打开的作用域
+    std::vector<int> stack;
+    // 作用域名称
+    std::vector<std::string> names;
+    std::unordered_map<std::string, int> nameIndices;
+    // 每个作用域的统计
+    std::vector<Stats> stats;
+    // 自上次输出以来读取的帧数和丢弃的帧数
+    unsigned int collectedFrames = 0;
+    unsigned int droppedFrames = 0;
+    // 录制
+    unsigned int captureRemaining = 0;
+    std::string captureFile;
+    std::vector<CaptureEvent> captureEvents;
+    long long gpuClockOffsetNs = 0;
+};
+
+#endif // PROFILER_H
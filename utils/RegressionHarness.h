@@ -0,0 +1,419 @@
+#ifndef REGRESSION_HARNESS_H
+#define REGRESSION_HARNESS_H
+
+// 图像和性能回归测试：离屏渲染config/regression.yaml中的固定视角，与保存的基准图像和基准耗时比较
+// 图像按CIELAB的ΔE逐像素比较（肉眼可见的差异），可见差异的像素比例超过容差时失败；耗时比较每个视角GPU/CPU耗时的中位数
+// 失败时在输出目录写出实际图像和差异图像（差异像素标红，其余像素变暗），所有视角的结果写入report.json
+// 用法：tellurion --regression [--config config/regression.yaml] [--golden-dir regression] [--output-dir regression/output] [--update-golden]
+// --update-golden把当前的渲染结果和耗时保存为新的基准（基准耗时与机器和驱动有关，需要在同一台机器上生成和比较）
+// 图像保存为TGA（左下角为原点，与glReadPixels的行顺序相同）
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "yaml-cpp/yaml.h"
+#include "stb_image.h"
+#include "lightmapper.h"
+#include "HeadlessBenchmark.h"
+
+// 回归测试的命令行参数
+struct RegressionOptions {
+    // 设置和固定视角
+    std::string configFile = "config/regression.yaml";
+    // 基准图像和基准耗时所在的目录
+    std::string goldenDir = "regression";
+    // 差异图像和报告的输出目录
+    std::string outputDir = "regression/output";
+    // 是否把当前结果保存为新的基准
+    bool updateGolden = false;
+};
+
+// 一个固定视角
+struct RegressionView {
+    std::string name;
+    glm::vec3 position = glm::vec3(0.0f, 0.0f, 25.0f);
+    glm::vec3 front = glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+    float zoom = 45.0f;
+    // 动画时间（s）
+    float time = 0.0f;
+};
+
+// 回归测试的设置
+struct RegressionConfig {
+    int width = 640;
+    int height = 360;
+    int warmupFrames = 8;
+    int timingFrames = 30;
+    // 单个像素可见差异的ΔE阈值
+    float pixelThreshold = 4.0f;
+    // 允许的可见差异像素比例
+    float imageTolerance = 0.002f;
+    // 允许的耗时增长比例和绝对余量（ms）
+    float timingTolerance = 0.15f;
+    float timingSlackMs = 0.1f;
+    std::vector<RegressionView> views;
+};
+
+// 一个视角的比较结果
+struct RegressionResult {
+    std::string name;
+    // 是否有基准图像，以及图像比较是否通过
+    bool hasGolden = false;
+    bool imagePassed = true;
+    // 平均ΔE、最大ΔE和可见差异的像素比例
+    double meanDeltaE = 0.0;
+    double maxDeltaE = 0.0;
+    double differingFraction = 0.0;
+    // 是否有基准耗时，以及耗时比较是否通过
+    bool hasBaseline = false;
+    bool timingPassed = true;
+    // 耗时的中位数（ms）和对应的基准
+    double gpuMs = 0.0;
+    double cpuMs = 0.0;
+    double baselineGpuMs = 0.0;
+    double baselineCpuMs = 0.0;
+};
+
+/// @brief 命令行中是否要求运行回归测试
+inline bool isRegressionRequested(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--regression") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief 解析回归测试的命令行参数，未知参数输出提示后忽略
+inline RegressionOptions parseRegressionOptions(int argc, char** argv) {
+    RegressionOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--regression") {
+            continue;
+        }
+        else if (arg == "--config" && hasValue) {
+            options.configFile = argv[++i];
+        }
+        else if (arg == "--golden-dir" && hasValue) {
+            options.goldenDir = argv[++i];
+        }
+        else if (arg == "--output-dir" && hasValue) {
+            options.outputDir = argv[++i];
+        }
+        else if (arg == "--update-golden") {
+            options.updateGolden = true;
+        }
+        else {
+            std::cout << "[regression] ignoring unknown argument " << arg << std::endl;
+        }
+    }
+    return options;
+}
+
+/// @brief 读取YAML中的{ x, y, z }向量
+inline glm::vec3 readRegressionVector(const YAML::Node& node, const glm::vec3& defaultValue) {
+    if (!node) {
+        return defaultValue;
+    }
+    return glm::vec3(node["x"].as<float>(), node["y"].as<float>(), node["z"].as<float>());
+}
+
+/// @brief 加载回归测试的设置和固定视角
+/// @return 是否加载成功（至少有一个视角）
+inline bool loadRegressionConfig(const std::string& fileName, RegressionConfig& config) {
+    try {
+        YAML::Node node = YAML::LoadFile(fileName);
+        config.width = node["width"] ? node["width"].as<int>() : config.width;
+        config.height = node["height"] ? node["height"].as<int>() : config.height;
+        config.warmupFrames = node["warmupFrames"] ? node["warmupFrames"].as<int>() : config.warmupFrames;
+        config.timingFrames = std::max(node["timingFrames"] ? node["timingFrames"].as<int>() : config.timingFrames, 1);
+        config.pixelThreshold = node["pixelThreshold"] ? node["pixelThreshold"].as<float>() : config.pixelThreshold;
+        config.imageTolerance = node["imageTolerance"] ? node["imageTolerance"].as<float>() : config.imageTolerance;
+        config.timingTolerance = node["timingTolerance"] ? node["timingTolerance"].as<float>() : config.timingTolerance;
+        config.timingSlackMs = node["timingSlackMs"] ? node["timingSlackMs"].as<float>() : config.timingSlackMs;
+        if (node["views"]) {
+            for (size_t i = 0; i < node["views"].size(); ++i) {
+                const YAML::Node& viewNode = node["views"][i];
+                RegressionView view;
+                view.name = viewNode["name"].as<std::string>();
+                view.position = readRegressionVector(viewNode["position"], view.position);
+                view.front = readRegressionVector(viewNode["front"], view.front);
+                view.up = readRegressionVector(viewNode["up"], view.up);
+                view.zoom = viewNode["zoom"] ? viewNode["zoom"].as<float>() : view.zoom;
+                view.time = viewNode["time"] ? viewNode["time"].as<float>() : view.time;
+                config.views.push_back(view);
+            }
+        }
+    }
+    catch (const YAML::Exception& e) {
+        std::cerr << "Error: Unable to load " << fileName << ": " << e.what() << std::endl;
+        return false;
+    }
+    return !config.views.empty();
+}
+
+/// @brief 加载基准耗时（视角名 -> GPU/CPU耗时的中位数）
+inline std::map<std::string, std::pair<double, double>> loadRegressionBaseline(const std::string& fileName) {
+    std::map<std::string, std::pair<double, double>> baseline;
+    try {
+        YAML::Node node = YAML::LoadFile(fileName);
+        if (node["views"]) {
+            for (auto it = node["views"].begin(); it != node["views"].end(); ++it) {
+                baseline[it->first.as<std::string>()] = { it->second["gpuMs"].as<double>(), it->second["cpuMs"].as<double>() };
+            }
+        }
+    }
+    catch (const YAML::Exception&) {
+        // 没有基准耗时时只比较图像
+    }
+    return baseline;
+}
+
+/// @brief 把8位sRGB颜色转换到CIELAB（D65白点）
+inline glm::vec3 srgbToLab(const unsigned char* rgb) {
+    float linear[3];
+    for (int c = 0; c < 3; c++) {
+        float v = rgb[c] / 255.0f;
+        linear[c] = v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+    }
+    float x = (0.4124f * linear[0] + 0.3576f * linear[1] + 0.1805f * linear[2]) / 0.95047f;
+    float y = 0.2126f * linear[0] + 0.7152f * linear[1] + 0.0722f * linear[2];
+    float z = (0.0193f * linear[0] + 0.1192f * linear[1] + 0.9505f * linear[2]) / 1.08883f;
+    auto f = [](float t) {
+        return t > 0.008856f ? std::cbrt(t) : 7.787f * t + 16.0f / 116.0f;
+    };
+    float fx = f(x), fy = f(y), fz = f(z);
+    return glm::vec3(116.0f * fy - 16.0f, 500.0f * (fx - fy), 200.0f * (fy - fz));
+}
+
+/// @brief 比较实际图像和基准图像，生成差异图像
+/// @param actual 实际图像（RGB）
+/// @param golden 基准图像（RGB，大小相同）
+/// @param pixelThreshold 可见差异的ΔE阈值
+/// @param result 写入平均ΔE、最大ΔE和可见差异的像素比例
+/// @param diffImage 差异图像：可见差异的像素按ΔE标红，其余像素为变暗的实际图像
+inline void compareRegressionImages(const std::vector<unsigned char>& actual, const std::vector<unsigned char>& golden, float pixelThreshold,
+    RegressionResult& result, std::vector<unsigned char>& diffImage) {
+    size_t pixels = actual.size() / 3;
+    diffImage.resize(actual.size());
+    double sumDeltaE = 0.0;
+    double maxDeltaE = 0.0;
+    size_t differing = 0;
+    for (size_t i = 0; i < pixels; i++) {
+        const unsigned char* a = &actual[i * 3];
+        const unsigned char* g = &golden[i * 3];
+        double deltaE = 0.0;
+        if (a[0] != g[0] || a[1] != g[1] || a[2] != g[2]) {
+            glm::vec3 d = srgbToLab(a) - srgbToLab(g);
+            deltaE = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+        }
+        sumDeltaE += deltaE;
+        maxDeltaE = std::max(maxDeltaE, deltaE);
+        if (deltaE > pixelThreshold) {
+            differing++;
+            diffImage[i * 3 + 0] = (unsigned char)std::min(128.0 + deltaE * 8.0, 255.0);
+            diffImage[i * 3 + 1] = 0;
+            diffImage[i * 3 + 2] = 0;
+        }
+        else {
+            for (int c = 0; c < 3; c++) {
+                diffImage[i * 3 + c] = a[c] / 4;
+            }
+        }
+    }
+    result.meanDeltaE = pixels > 0 ? sumDeltaE / pixels : 0.0;
+    result.maxDeltaE = maxDeltaE;
+    result.differingFraction = pixels > 0 ? (double)differing / pixels : 0.0;
+}
+
+/// @brief 加载基准图像（TGA），行顺序转换为左下角为原点
+/// @return 图像不存在或者大小不同时返回false
+inline bool loadRegressionGolden(const std::string& fileName, int width, int height, std::vector<unsigned char>& image) {
+    int w = 0, h = 0, channels = 0;
+    unsigned char* data = stbi_load(fileName.c_str(), &w, &h, &channels, 3);
+    if (data == NULL) {
+        return false;
+    }
+    bool matches = w == width && h == height;
+    if (matches) {
+        // stb_image按左上角为原点返回，翻转成与glReadPixels相同的行顺序
+        image.resize(width * height * 3);
+        for (int y = 0; y < height; y++) {
+            std::memcpy(&image[y * width * 3], &data[(height - 1 - y) * width * 3], width * 3);
+        }
+    }
+    else {
+        std::cout << "[regression] " << fileName << " is " << w << "x" << h << ", expected " << width << "x" << height << std::endl;
+    }
+    stbi_image_free(data);
+    return matches;
+}
+
+/// @brief 运行回归测试
+/// @return 进程的返回值：全部通过（或者更新了基准）为0，有失败为1，无法运行为2
+inline int runRegression(const RegressionOptions& options) {
+    RegressionConfig config;
+    if (!loadRegressionConfig(options.configFile, config)) {
+        std::cout << "[regression] no views in " << options.configFile << std::endl;
+        return 2;
+    }
+    GLFWWindowFactory factory;
+    if (!factory.initHeadless(config.width, config.height)) {
+        factory.releaseHeadless();
+        return 2;
+    }
+    std::string renderer = (const char*)glGetString(GL_RENDERER);
+    std::cout << "[regression] " << renderer << ", " << config.views.size() << " views at " << config.width << "x" << config.height << std::endl;
+
+    // 基准目录（更新时）和输出目录不存在时创建
+    std::error_code error;
+    std::filesystem::create_directories(options.updateGolden ? options.goldenDir : options.outputDir, error);
+    std::string baselineFile = options.goldenDir + "/baseline.yaml";
+    std::map<std::string, std::pair<double, double>> baseline = loadRegressionBaseline(baselineFile);
+    std::vector<RegressionResult> results;
+    {
+        Scene tellurion(&factory);
+        SkyBox skyBox(&factory);
+        // 固定渲染分辨率，结果与帧时间无关
+        tellurion.setFixedResolutionScale(1.0f);
+        auto simulate = [&](FrameSnapshot& frame) {
+            tellurion.simulate(frame);
+        };
+        auto render = [&]() {
+            tellurion.draw();
+            skyBox.draw();
+        };
+
+        std::vector<unsigned char> actual(config.width * config.height * 3);
+        std::vector<unsigned char> golden;
+        std::vector<unsigned char> diffImage;
+        for (const RegressionView& view : config.views) {
+            RegressionResult result;
+            result.name = view.name;
+            factory.setCameraPose(view.position, view.front, view.up, view.zoom);
+            // 同一时刻渲染多帧，等待阴影缓存等稳定之后再统计
+            for (int i = 0; i < config.warmupFrames; i++) {
+                factory.runHeadlessFrameAt(view.time, simulate, render);
+            }
+            std::vector<double> cpuMs;
+            std::vector<double> gpuMs;
+            measureHeadlessFrames(config.timingFrames, [&]() {
+                factory.runHeadlessFrameAt(view.time, simulate, render);
+                }, cpuMs, gpuMs);
+            result.cpuMs = summarizeFrameTimes(cpuMs).p50;
+            result.gpuMs = summarizeFrameTimes(gpuMs).p50;
+
+            // 读取最后一帧的画面
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, config.width, config.height, GL_RGB, GL_UNSIGNED_BYTE, actual.data());
+
+            std::string goldenFile = options.goldenDir + "/" + view.name + ".tga";
+            if (options.updateGolden) {
+                if (!lmImageSaveTGAub(goldenFile.c_str(), actual.data(), config.width, config.height, 3)) {
+                    std::cout << "[regression] failed to write " << goldenFile << std::endl;
+                }
+            }
+            else {
+                result.hasGolden = loadRegressionGolden(goldenFile, config.width, config.height, golden);
+                if (result.hasGolden) {
+                    compareRegressionImages(actual, golden, config.pixelThreshold, result, diffImage);
+                    result.imagePassed = result.differingFraction <= config.imageTolerance;
+                }
+                else {
+                    // 没有基准图像也算失败，避免基准丢失时测试一直通过
+                    result.imagePassed = false;
+                }
+                auto it = baseline.find(view.name);
+                result.hasBaseline = it != baseline.end();
+                if (result.hasBaseline) {
+                    result.baselineGpuMs = it->second.first;
+                    result.baselineCpuMs = it->second.second;
+                    result.timingPassed = result.gpuMs <= result.baselineGpuMs * (1.0 + config.timingTolerance) + config.timingSlackMs
+                        && result.cpuMs <= result.baselineCpuMs * (1.0 + config.timingTolerance) + config.timingSlackMs;
+                }
+                // 失败时写出实际图像和差异图像
+                if (!result.imagePassed) {
+                    std::string actualFile = options.outputDir + "/" + view.name + "_actual.tga";
+                    lmImageSaveTGAub(actualFile.c_str(), actual.data(), config.width, config.height, 3);
+                    if (result.hasGolden) {
+                        std::string diffFile = options.outputDir + "/" + view.name + "_diff.tga";
+                        lmImageSaveTGAub(diffFile.c_str(), diffImage.data(), config.width, config.height, 3);
+                    }
+                }
+            }
+
+            std::cout << std::fixed << std::setprecision(3);
+            std::cout << "[regression] " << view.name << ": gpu " << result.gpuMs << " ms, cpu " << result.cpuMs << " ms";
+            if (result.hasBaseline) {
+                std::cout << " (baseline " << result.baselineGpuMs << " / " << result.baselineCpuMs << " ms)";
+            }
+            if (result.hasGolden) {
+                std::cout << ", mean deltaE " << result.meanDeltaE << ", max " << result.maxDeltaE << ", "
+                    << result.differingFraction * 100.0 << "% pixels differ";
+            }
+            else if (!options.updateGolden) {
+                std::cout << ", no golden image";
+            }
+            std::cout << (result.imagePassed && result.timingPassed ? "" : " FAILED") << std::endl;
+            results.push_back(result);
+        }
+        tellurion.release();
+        skyBox.release();
+        GpuResources::reportLeaks();
+    }
+
+    int exitCode = 0;
+    if (options.updateGolden) {
+        // 保存基准耗时
+        std::ofstream out(baselineFile);
+        out << std::fixed << std::setprecision(4);
+        out << "# " << renderer << ", " << config.width << "x" << config.height << "\n";
+        out << "views:\n";
+        for (const RegressionResult& result : results) {
+            out << "  \"" << result.name << "\": { gpuMs: " << result.gpuMs << ", cpuMs: " << result.cpuMs << " }\n";
+        }
+        std::cout << "[regression] updated " << results.size() << " golden images and " << baselineFile << std::endl;
+    }
+    else {
+        // 写出所有视角的报告
+        std::string reportFile = options.outputDir + "/report.json";
+        std::ofstream out(reportFile);
+        out << std::fixed << std::setprecision(4);
+        out << "{\n  \"renderer\": " << toJsonString(renderer) << ",\n  \"views\": [\n";
+        int failures = 0;
+        for (size_t i = 0; i < results.size(); i++) {
+            const RegressionResult& result = results[i];
+            bool passed = result.imagePassed && result.timingPassed;
+            failures += passed ? 0 : 1;
+            out << "    { \"name\": " << toJsonString(result.name) << ", \"passed\": " << (passed ? "true" : "false")
+                << ", \"image\": { \"hasGolden\": " << (result.hasGolden ? "true" : "false") << ", \"passed\": " << (result.imagePassed ? "true" : "false")
+                << ", \"meanDeltaE\": " << result.meanDeltaE << ", \"maxDeltaE\": " << result.maxDeltaE << ", \"differingFraction\": " << result.differingFraction
+                << " }, \"timing\": { \"hasBaseline\": " << (result.hasBaseline ? "true" : "false") << ", \"passed\": " << (result.timingPassed ? "true" : "false")
+                << ", \"gpuMs\": " << result.gpuMs << ", \"cpuMs\": " << result.cpuMs
+                << ", \"baselineGpuMs\": " << result.baselineGpuMs << ", \"baselineCpuMs\": " << result.baselineCpuMs << " } }"
+                << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n}\n";
+        if (!out) {
+            std::cout << "[regression] failed to write " << reportFile << std::endl;
+        }
+        std::cout << "[regression] " << results.size() - failures << "/" << results.size() << " views passed, report written to " << reportFile << std::endl;
+        exitCode = failures > 0 ? 1 : 0;
+    }
+    factory.releaseHeadless();
+    return exitCode;
+}
+
+#endif // REGRESSION_HARNESS_H
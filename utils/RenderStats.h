@@ -0,0 +1,28 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+// 定义了RenderStats，统计提交的绘制调用和三角形数量（只在拥有上下文的线程中修改）
+// 三角形数量为提交的数量（索引数/3乘以实例数），不包括几何着色器的放大和裁剪
+
+struct RenderStats {
+    // 绘制调用次数
+    inline static unsigned long long drawCalls = 0;
+    // 提交的三角形数量
+    inline static unsigned long long triangles = 0;
+
+    /// @brief 记录一次绘制调用
+    /// @param triangleCount 每个实例的三角形数量
+    /// @param instanceCount 实例数量
+    static void recordDraw(unsigned long long triangleCount, unsigned long long instanceCount = 1) {
+        drawCalls++;
+        triangles += triangleCount * instanceCount;
+    }
+
+    /// @brief 清空统计
+    static void reset() {
+        drawCalls = 0;
+        triangles = 0;
+    }
+};
+
+#endif // RENDER_STATS_H
@@ -1,6 +1,8 @@
 
 #include "Scene.h"
 #include <iostream>
+#include <algorithm>
+#include <limits>
 #include "yaml-cpp/yaml.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -8,25 +10,39 @@
 #define LIGHTMAPPER_IMPLEMENTATION
 #define LM_DEBUG_INTERPOLATION
 #include "lightmapper.h"
+#include <set>
+#include <random>
+#include "ParallelImage.h"
+#include "RenderStats.h"
 
-Scene::Scene(GLFWWindowFactory* window) :window(window) {
+/// @brief 阴影算法是否使用可过滤的矩贴图（VSM/ESM/MSM）
+static bool isMomentShadowAlgorithm(unsigned int algorithm) {
+    return algorithm == 3 || algorithm == 5 || algorithm == 6;
+}
+
+Scene::Scene(GLFWWindowFactory* window, const std::string& sceneFile) :jobSystem(JOB_WORKER_COUNT > 0 ? JOB_WORKER_COUNT : JobSystem::defaultWorkerCount()), window(window) {
     // 加载定向光配置
     this->directionalLights = loadDirectionalLights("config/directionalLights.yaml");
-    this->numDirectionalLights = this->directionalLights.size();
     // 加载点光源配置
-    pointLights = loadPointLights("config/pointLights.yaml");
+    this->pointLights = loadPointLights("config/pointLights.yaml");
     // 加载场景配置
-    this->modelInfos = loadScene("config/scene.yaml");
+    this->modelInfos = loadScene(sceneFile);
+    this->numDirectionalLights = this->directionalLights.size();
+    this->configPointLights = pointLights;
+    this->lightClusters = LightClusters(CLUSTER_X, CLUSTER_Y, CLUSTER_Z, MAX_LIGHTS_PER_CLUSTER, &this->jobSystem);
 
     /// 阴影深度贴图处理
-    // 给directionLightDepthMapFBOs分配大小
-    this->directionLightDepthMapFBOs.resize(this->numDirectionalLights);
-    // 给directionLightDepthMaps分配大小
-    this->directionLightDepthMaps.resize(this->numDirectionalLights);
-    // 给directionLightDepthVarianceMaps分配大小
-    this->directionLightDepthMeanVarMaps.resize(this->numDirectionalLights);
-    this->d_d2_filter_FBO.resize(this->numDirectionalLights * 2);
-    this->d_d2_filter_maps.resize(this->numDirectionalLights * 2);
+    // 静态物体阴影缓存
+    this->staticShadowLightSpaceMatrices.resize(this->numDirectionalLights * CASCADE_COUNT, glm::mat4(1.0f));
+    this->staticShadowValid.resize(this->numDirectionalLights * CASCADE_COUNT, false);
+    this->previousLightSpaceMatrices.resize(this->numDirectionalLights * CASCADE_COUNT, glm::mat4(1.0f));
+    // 级联分割距离
+    this->cascadeSplits.resize(CASCADE_COUNT, 0.0f);
+    // 阴影更新开销统计
+    this->shadowUpdateTimers.resize(this->numDirectionalLights);
+    this->shadowUpdateCpuMs.resize(this->numDirectionalLights, 0.0);
+    this->staticShadowRebuilds.resize(this->numDirectionalLights, 0);
+    this->staticShadowBypasses.resize(this->numDirectionalLights, 0);
     // 加载深度贴图
     loadDirectionLightDepthMap();
 
@@ -39,58 +55,520 @@ Scene::Scene(GLFWWindowFactory* window) :window(window) {
 
         modelInfo.model = new Model(modelInfo.path, vertices, indices);
     }
+    // 主线程模拟使用的定向光方向和模型变换（渲染线程使用快照中的副本）
+    for (const auto& light : this->directionalLights) {
+        this->simulationLightDirections.push_back(light.direction);
+    }
+    for (const auto& modelInfo : modelInfos) {
+        this->simulationTransforms.push_back(modelInfo.transform);
+    }
 
     // 初始化着色器
     this->shader = Shader("shaders/sceneShader.vs", "shaders/sceneShader.fs");
     // 初始化方向光阴影着色器
-    this->directionLightShadowShader = Shader("shaders/directionLightShadowShader.vs", "shaders/directionLightShadowShader.fs");
+    this->directionLightShadowShader = Shader("shaders/directionLightShadowShader.vs", "shaders/directionLightShadowShader.fs", nullptr, getShadowCasterDefines());
+    // 初始化只写深度的阴影着色器
+    this->depthOnlyShader = Shader("shaders/depthOnlyShader.vs", "shaders/depthOnlyShader.fs");
+    // 初始化分层阴影着色器，支持时在顶点着色器中写gl_Layer，否则使用几何着色器
+    this->vertexShaderLayer = hasGLExtension("GL_ARB_shader_viewport_layer_array") || hasGLExtension("GL_AMD_vertex_shader_layer");
+    loadLayeredShadowShader();
+    // 场景着色器的特化变体在第一次使用时编译
+    this->sceneShaders = ShaderPermutations("shaders/sceneShader.vs", "shaders/sceneShader.fs");
+    // 延迟渲染的几何pass和光照pass（光照pass是定义了DEFERRED_LIGHTING的场景着色器，使用全屏四边形的顶点着色器）
+    this->gBufferShaders = ShaderPermutations("shaders/sceneShader.vs", "shaders/gBufferShader.fs");
+    this->deferredLightingShaders = ShaderPermutations("shaders/vsmShader.vs", "shaders/sceneShader.fs");
+    // 内部渲染目标和G-buffer在第一帧按窗口大小创建
+    this->resolutionController = DynamicResolution(FRAME_TIME_BUDGET_MS, MIN_RESOLUTION_SCALE, MAX_RESOLUTION_SCALE, GpuTimestampTimer::QUERY_COUNT);
+    this->upscaleShader = Shader("shaders/vsmShader.vs", "shaders/upscaleShader.fs");
+    // 初始化深度预pass、overdraw可视化和像素统计着色器
+    this->depthPrepassShader = Shader("shaders/depthPrepassShader.vs", "shaders/depthOnlyShader.fs");
+    this->overdrawShader = Shader("shaders/depthPrepassShader.vs", "shaders/overdrawShader.fs");
+    this->coveredPixelsShader = Shader("shaders/vsmShader.vs", "shaders/depthOnlyShader.fs");
+    // 初始化点光源立方体阴影
+    this->pointShadowShader = Shader("shaders/pointShadowShader.vs", "shaders/pointShadowShader.fs", "shaders/pointShadowShader.gs");
+    createPointShadowMaps();
+    this->shadowSinglePass = SHADOW_SINGLE_PASS && this->numDirectionalLights * CASCADE_COUNT <= MAX_SHADOW_LAYERS;
+    if (SHADOW_SINGLE_PASS && !this->shadowSinglePass) {
+        cout << "[shadow] " << this->numDirectionalLights * CASCADE_COUNT << " shadow layers exceed MAX_SHADOW_LAYERS, falling back to per-light shadow passes" << endl;
+    }
     // 初始化均值方差计算着色器
     this->d_d2_filter_shader = Shader("shaders/vsmShader.vs", "shaders/vsmShader.fs");
+    // 初始化最小/最大深度层级构建着色器
+    this->minMaxDepthShader = Shader("shaders/vsmShader.vs", "shaders/minMaxDepthShader.fs");
     // 初始化光照贴图着色器
     this->lightMapShader = Shader("shaders/lightMapShader.vs", "shaders/lightMapShader.fs");
 }
 
 Scene::~Scene() {
+    // OpenGL对象需要在上下文销毁之前由release释放，析构时上下文可能已经不存在
 }
 
-void Scene::draw() {
+void Scene::release() {
+    for (auto& modelInfo : this->modelInfos) {
+        if (modelInfo.model != nullptr) {
+            modelInfo.model->release();
+            delete modelInfo.model;
+            modelInfo.model = nullptr;
+        }
+    }
+    releaseDirectionLightDepthMap();
+    GpuResources::deleteSampler(this->shadowCompareSampler);
+    GpuResources::deleteFramebuffer(this->pointShadowFBO);
+    GpuResources::deleteTexture(this->pointShadowArray);
+    // G-buffer、内部渲染目标和矩的模糊中间结果的纹理属于临时渲染目标池
+    GpuResources::deleteFramebuffer(this->gBufferFBO);
+    GpuResources::deleteFramebuffer(this->sceneFBO);
+    this->renderTargetPool.clear();
+    this->gAlbedo = this->gSpecular = this->gNormalShininess = this->gDepth = 0;
+    this->sceneColorTexture = this->sceneDepthTexture = 0;
+    GpuResources::deleteVertexArray(this->quadVAO);
+    GpuResources::deleteBuffer(this->quadVBO);
+    GpuResources::deleteTexture(this->lightMap);
+    this->lightClusters.release();
+    // 着色器变体和查询对象不计入显存统计，同样在这里释放
+    this->sceneShaders.release();
+    this->gBufferShaders.release();
+    this->deferredLightingShaders.release();
+    for (auto& timer : this->shadowUpdateTimers) {
+        timer.release();
+    }
+    this->shadowSinglePassTimer.release();
+    this->shadowMinMaxTimer.release();
+    this->vsmFilterTimer.release();
+    this->pointShadowTimer.release();
+    this->frameTimer.release();
+    this->shadedFragmentCounter.release();
+    this->coveredPixelCounter.release();
+}
+
+void Scene::simulate(FrameSnapshot& frame) {
     // 处理输入
-    processInputMoveDirLight();
+    processInputMoveDirLight(frame);
+    frame.directionLightDirections = this->simulationLightDirections;
+
+    // 更新模型变换，渲染线程使用快照中的副本
+    frame.transforms.resize(this->simulationTransforms.size());
+    frame.transformsChanged.resize(this->simulationTransforms.size());
+    // 每个模型的变换互不依赖，模型较多时作为作业并行更新（vector<bool>按位存储，不能在作业中并行写入）
+    vector<char> changed(this->simulationTransforms.size(), 0);
+    this->jobSystem.parallelFor(this->simulationTransforms.size(), TRANSFORM_GRAIN_SIZE, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            changed[i] = this->simulationTransforms[i].update(frame.frameTime);
+            frame.transforms[i] = this->simulationTransforms[i];
+        }
+        });
+    for (size_t i = 0; i < changed.size(); ++i) {
+        frame.transformsChanged[i] = changed[i] != 0;
+    }
+}
+
+void Scene::draw() {
+    // 窗口最小化时不渲染
+    int windowWidth = this->window->getFramebufferWidth();
+    int windowHeight = this->window->getFramebufferHeight();
+    if (windowWidth <= 0 || windowHeight <= 0) {
+        return;
+    }
+    this->frameTimer.begin();
+    // 使用快照中的定向光方向和模型变换（本帧所有pass共用同一个时间采样）
+    updateTransforms();
     if (BAKE) {
-        static int baking = 0; // 添加一个标志
-        if (glfwGetKey(this->window->window, GLFW_KEY_SPACE) == GLFW_PRESS && !baking) {
-            baking = 1; // 设置标志
+        if (this->window->wasKeyJustPressed(GLFW_KEY_SPACE)) {
             cout << "baking" << endl;
             bakeLightMap();
         }
-        if (glfwGetKey(this->window->window, GLFW_KEY_SPACE) == GLFW_RELEASE) {
-            baking = 0; // 重置标志
+    }
+
+    // 阴影相关的按键
+    processInputShadowOptions();
+
+    // 按帧时间调整渲染分辨率
+    updateRenderResolution(windowWidth, windowHeight);
+
+    // 声明并执行本帧的渲染pass
+    renderFrameGraph(windowWidth, windowHeight);
+
+    // 定期输出作业系统每个线程的利用率
+    if (++this->jobStatsFrame >= SHADOW_STATS_INTERVAL) {
+        reportJobStats(this->jobSystem, "[jobs]");
+        this->jobStatsFrame = 0;
+    }
+    this->frameTimer.end();
+}
+
+void Scene::renderFrameGraph(int windowWidth, int windowHeight) {
+    FrameGraph& graph = this->frameGraph;
+    graph.reset();
+    // 跨帧保留的资源：定向光阴影只更新变化的层，点光源阴影按槽位缓存
+    FrameGraph::Resource directionShadows = graph.importTexture("direction light shadows", this->directionLightDepthMapArray);
+    FrameGraph::Resource pointShadows = graph.importTexture("point light shadows", this->pointShadowArray);
+    FrameGraph::Resource backbuffer = graph.importTexture("backbuffer", 0);
+    // 延迟渲染的光照pass读取G-buffer，前向渲染和过度绘制视图不读取，G-buffer pass会被剔除
+    bool deferred = this->deferredShading && !BAKE && !this->overdrawView;
+    // G-buffer和内部渲染目标按窗口的帧缓冲大小分配，渲染分辨率变化时不重新分配
+    int targetWidth = this->sceneTargetWidth;
+    int targetHeight = this->sceneTargetHeight;
+
+    // 定向光阴影，矩的两次模糊中第一次模糊的结果是临时资源
+    FrameGraph::Resource momentsBlur = FrameGraph::INVALID_RESOURCE;
+    graph.addPass("shadows", [&](FrameGraph::Builder& builder) {
+        builder.write(directionShadows);
+        if (usesShadowMoments() && !this->vsmMipmapFilter) {
+            momentsBlur = builder.create("shadow moments blur", getMomentsBlurDesc());
+        }
+        }, [&](const FrameGraph::Resources& resources) {
+            this->momentsBlurScratch = resources.getTexture(momentsBlur);
+            renderSceneToDepthMap();
+            this->momentsBlurScratch = 0;
+        });
+
+    // 点光源动画、立方体阴影和分簇（分簇时需要知道每个点光源的阴影槽位）
+    graph.addPass("point shadows", [&](FrameGraph::Builder& builder) {
+        builder.write(pointShadows);
+        }, [&](const FrameGraph::Resources&) {
+            animatePointLights();
+            renderPointLightShadows();
+            updateLightClusters();
+        });
+
+    // 延迟渲染的几何pass
+    FrameGraph::Resource gBuffer[4];
+    graph.addPass("G-buffer", [&](FrameGraph::Builder& builder) {
+        static const char* names[4] = { "G-buffer albedo", "G-buffer specular", "G-buffer normal/shininess", "G-buffer depth" };
+        FrameGraphTextureDesc descs[4];
+        getGBufferDescs(targetWidth, targetHeight, descs);
+        for (int i = 0; i < 4; ++i) {
+            gBuffer[i] = builder.create(names[i], descs[i]);
+        }
+        }, [&](const FrameGraph::Resources& resources) {
+            unsigned int textures[4];
+            for (int i = 0; i < 4; ++i) {
+                textures[i] = resources.getTexture(gBuffer[i]);
+            }
+            attachGBuffer(textures, targetWidth, targetHeight);
+            renderGBufferPass(this->renderWidth, this->renderHeight);
+        });
+
+    // 主pass：渲染到内部渲染目标的左下角（渲染分辨率），不使用动态分辨率时直接渲染到默认帧缓冲
+    FrameGraph::Resource sceneColor = FrameGraph::INVALID_RESOURCE;
+    FrameGraph::Resource sceneDepth = FrameGraph::INVALID_RESOURCE;
+    graph.addPass("main", [&](FrameGraph::Builder& builder) {
+        builder.read(directionShadows);
+        builder.read(pointShadows);
+        if (deferred) {
+            for (int i = 0; i < 4; ++i) {
+                builder.read(gBuffer[i]);
+            }
+        }
+        if (DYNAMIC_RESOLUTION) {
+            FrameGraphTextureDesc colorDesc;
+            colorDesc.width = targetWidth;
+            colorDesc.height = targetHeight;
+            // 颜色：放大时双线性过滤
+            colorDesc.filter = GL_LINEAR;
+            sceneColor = builder.create("scene color", colorDesc);
+            // 深度：放大时写回默认帧缓冲，天空盒需要
+            FrameGraphTextureDesc depthDesc = colorDesc;
+            depthDesc.internalFormat = GL_DEPTH_COMPONENT24;
+            depthDesc.filter = GL_NEAREST;
+            sceneDepth = builder.create("scene depth", depthDesc);
         }
+        else {
+            builder.write(backbuffer);
+        }
+        }, [&](const FrameGraph::Resources& resources) {
+            if (DYNAMIC_RESOLUTION) {
+                attachSceneTargets(resources.getTexture(sceneColor), resources.getTexture(sceneDepth));
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, DYNAMIC_RESOLUTION ? this->sceneFBO : 0);
+            glViewport(0, 0, this->renderWidth, this->renderHeight);
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            if (this->overdrawView) {
+                renderOverdraw();
+            }
+            else if (deferred) {
+                renderDeferredLighting();
+            }
+            else {
+                renderMainPass();
+            }
+            reportOverdrawStats();
+        });
+
+    // 放大到窗口
+    if (DYNAMIC_RESOLUTION) {
+        graph.addPass("upscale", [&](FrameGraph::Builder& builder) {
+            builder.read(sceneColor);
+            builder.read(sceneDepth);
+            builder.write(backbuffer);
+            }, [&](const FrameGraph::Resources& resources) {
+                upscaleToWindow(windowWidth, windowHeight, resources.getTexture(sceneColor), resources.getTexture(sceneDepth));
+            });
+    }
+
+    graph.compile();
+    graph.execute();
+    // 定期输出临时渲染目标的显存：所有临时资源单独常驻时的大小与剔除、复用之后的峰值
+    if (++this->frameGraphStatsFrame >= SHADOW_STATS_INTERVAL) {
+        graph.printStats();
+        this->frameGraphStatsFrame = 0;
     }
+}
 
-    // 渲染深度贴图
-    renderSceneToDepthMap();
+void Scene::attachSceneTargets(unsigned int colorTexture, unsigned int depthTexture) {
+    if (this->sceneFBO == 0) {
+        this->sceneFBO = GpuResources::createFramebuffer("scene target", "Scene");
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, this->sceneFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+    // 池通常每帧返回同样的纹理，只在绑定的纹理改变时检查完整性
+    if (colorTexture != this->sceneColorTexture || depthTexture != this->sceneDepthTexture) {
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+        }
+        this->sceneColorTexture = colorTexture;
+        this->sceneDepthTexture = depthTexture;
+    }
+}
 
-    this->shader.use();
-    if (BAKE) {
-        // 使用光照贴图
-        this->shader.setBool("useLightMap", true);
+void Scene::updateRenderResolution(int windowWidth, int windowHeight) {
+    // 内部渲染目标和G-buffer与窗口的帧缓冲一样大（帧图按这个大小从池中取出），只使用渲染分辨率的区域
+    this->sceneTargetWidth = windowWidth;
+    this->sceneTargetHeight = windowHeight;
+    float scale = 1.0f;
+    if (this->fixedResolutionScale > 0.0f) {
+        scale = this->fixedResolutionScale;
+    }
+    else if (DYNAMIC_RESOLUTION) {
+        scale = this->resolutionController.update(this->frameTimer.getLastMs());
+    }
+    this->renderWidth = std::max((int)std::round(windowWidth * scale), 1);
+    this->renderHeight = std::max((int)std::round(windowHeight * scale), 1);
+
+    // 渲染分辨率较低时阴影贴图的分辨率也减半（滞回，避免来回重建）
+    if (DYNAMIC_RESOLUTION && DYNAMIC_SHADOW_RESOLUTION) {
+        unsigned int divisor = this->shadowWidth == SHADOW_WIDTH ? 1 : 2;
+        unsigned int newDivisor = scale < 0.6f ? 2 : (scale > 0.85f ? 1 : divisor);
+        if (newDivisor != divisor) {
+            this->shadowWidth = SHADOW_WIDTH / newDivisor;
+            this->shadowHeight = SHADOW_HEIGHT / newDivisor;
+            releaseDirectionLightDepthMap();
+            loadDirectionLightDepthMap();
+            invalidateStaticShadows();
+            this->shadowMinMaxValid = false;
+            cout << "[resolution] shadow maps " << this->shadowWidth << "x" << this->shadowHeight << endl;
+        }
+    }
+
+    // 定期输出渲染分辨率和GPU帧时间
+    this->resolutionScaleSum += scale;
+    if (++this->resolutionStatsFrame >= SHADOW_STATS_INTERVAL) {
+        cout << "[resolution] render " << this->renderWidth << "x" << this->renderHeight << " of " << windowWidth << "x" << windowHeight
+            << " (average scale " << this->resolutionScaleSum / this->resolutionStatsFrame << "), gpu frame " << this->frameTimer.getAverageMs()
+            << " ms (budget " << FRAME_TIME_BUDGET_MS << " ms)" << endl;
+        this->frameTimer.reset();
+        this->resolutionScaleSum = 0.0;
+        this->resolutionStatsFrame = 0;
+    }
+}
+
+void Scene::setFixedResolutionScale(float scale) {
+    this->fixedResolutionScale = scale > 0.0f ? std::min(std::max(scale, MIN_RESOLUTION_SCALE), 1.0f) : 0.0f;
+}
+
+void Scene::upscaleToWindow(int windowWidth, int windowHeight, unsigned int colorTexture, unsigned int depthTexture) {
+    Profiler::Scope profileScope(this->window->getProfiler(), "upscaleToWindow");
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, windowWidth, windowHeight);
+    // 每个像素都写入颜色和深度
+    glDepthFunc(GL_ALWAYS);
+    this->upscaleShader.use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glActiveTexture(GL_TEXTURE0);
+    this->upscaleShader.setInt("sceneColor", 0);
+    this->upscaleShader.setInt("sceneDepth", 1);
+    this->upscaleShader.setVec2("uvScale", glm::vec2((float)this->renderWidth / (float)this->sceneTargetWidth, (float)this->renderHeight / (float)this->sceneTargetHeight));
+    // 原生分辨率时不锐化
+    bool scaled = this->renderWidth != windowWidth || this->renderHeight != windowHeight;
+    this->upscaleShader.setFloat("sharpness", scaled ? UPSCALE_SHARPNESS : 0.0f);
+    renderQuad();
+    glDepthFunc(GL_LESS);
+}
+
+void Scene::renderMainPass() {
+    Profiler::Scope profileScope(this->window->getProfiler(), "renderMainPass");
+    if (this->deferredShading && !BAKE) {
+        renderDeferredPass();
+        return;
+    }
+    // 深度预pass只用于前向渲染（延迟渲染的光照pass本来就是每个像素一次）
+    bool prepass = this->depthPrepass && !BAKE;
+    if (prepass) {
+        renderDepthPrepass();
+    }
+    if (OVERDRAW_STATS) {
+        this->shadedFragmentCounter.begin();
+    }
+    if (USE_SHADER_PERMUTATIONS) {
+        // 每个网格使用特化的着色器变体
+        renderScenePermutations();
     }
     else {
-        // 不使用光照贴图
-        this->shader.setBool("useLightMap", false);
+        this->shader.use();
+        if (BAKE) {
+            // 使用光照贴图
+            this->shader.setBool("useLightMap", true);
+        }
+        else {
+            // 不使用光照贴图
+            this->shader.setBool("useLightMap", false);
+        }
+
+        // 设置场景着色器uniform变量
+        setupSceneUniform(this->shader);
+
+        // 渲染场景
+        renderScene(this->shader, true);
+    }
+    if (OVERDRAW_STATS) {
+        this->shadedFragmentCounter.end();
     }
+    if (prepass) {
+        endDepthPrepass();
+    }
+}
 
-    // 设置场景着色器uniform变量
-    setupSceneUniform();
+void Scene::renderDepthPrepass() {
+    Profiler::Scope profileScope(this->window->getProfiler(), "renderDepthPrepass");
+    // 只写深度，使用只包含位置的顶点数据
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+    this->depthPrepassShader.use();
+    this->depthPrepassShader.setMat4("projection", window->getProjectionMatrix());
+    this->depthPrepassShader.setMat4("view", window->getViewMatrix());
+    renderShadowCasters(this->depthPrepassShader, RenderFilter::All);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    // 两个pass的gl_Position都是invariant的，深度逐位相同，只有最近的片段能通过GL_EQUAL
+    glDepthFunc(GL_EQUAL);
+    glDepthMask(GL_FALSE);
+}
 
-    // 切换回默认视口
-    glViewport(0, 0, this->SCR_WIDTH, this->SCR_HEIGHT);
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void Scene::endDepthPrepass() {
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+}
 
-    // 渲染场景
-    renderScene(this->shader, true);
+void Scene::renderOverdraw() {
+    Profiler::Scope profileScope(this->window->getProfiler(), "renderOverdraw");
+    bool prepass = this->depthPrepass && !BAKE;
+    if (prepass) {
+        renderDepthPrepass();
+    }
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    this->overdrawShader.use();
+    this->overdrawShader.setMat4("projection", window->getProjectionMatrix());
+    this->overdrawShader.setMat4("view", window->getViewMatrix());
+    if (OVERDRAW_STATS) {
+        this->shadedFragmentCounter.begin();
+    }
+    renderShadowCasters(this->overdrawShader, RenderFilter::All);
+    if (OVERDRAW_STATS) {
+        this->shadedFragmentCounter.end();
+    }
+    glDisable(GL_BLEND);
+    if (prepass) {
+        endDepthPrepass();
+    }
+}
+
+void Scene::reportOverdrawStats() {
+    // 覆盖像素的统计每帧需要一个额外的全屏pass，只在开启统计时执行
+    if (!OVERDRAW_STATS) {
+        return;
+    }
+    // 全屏四边形的深度固定为1，只有深度缓冲中有几何体（深度小于1）的像素能通过GL_GREATER
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_GREATER);
+    glDepthRange(1.0, 1.0);
+    this->coveredPixelsShader.use();
+    this->coveredPixelCounter.begin();
+    renderQuad();
+    this->coveredPixelCounter.end();
+    glDepthRange(0.0, 1.0);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    if (++this->overdrawStatsFrame < SHADOW_STATS_INTERVAL) {
+        return;
+    }
+    double shaded = this->shadedFragmentCounter.getAverage();
+    double covered = this->coveredPixelCounter.getAverage();
+    cout << "[overdraw] " << (this->deferredShading ? "deferred lighting" : (this->depthPrepass ? "forward with depth pre-pass" : "forward"))
+        << ": " << (long long)shaded << " fragments shaded, " << (long long)covered << " covered pixels of " << this->renderWidth * this->renderHeight
+        << ", " << (covered > 0.0 ? shaded / covered : 0.0) << " fragments per covered pixel" << endl;
+    this->shadedFragmentCounter.reset();
+    this->coveredPixelCounter.reset();
+    this->overdrawStatsFrame = 0;
+}
+
+void Scene::processInputShadowOptions() {
+    // 按键状态来自当前渲染的快照（在主线程采样）
+    // 按下F2时切换到下一个阴影算法
+    if (this->window->wasKeyJustPressed(GLFW_KEY_F2)) {
+        setShadowAlgorithm((this->shadowAlgorithm + 1) % SHADOW_ALGORITHM_COUNT);
+    }
+    // 按下F6时切换VSM/ESM/MSM的矩的过滤方式（mipmap/两次模糊），阴影统计中会输出过滤的开销
+    if (this->window->wasKeyJustPressed(GLFW_KEY_F6)) {
+        this->vsmMipmapFilter = !this->vsmMipmapFilter;
+        this->vsmFilterTimer.reset();
+        cout << "[vsm] filter: " << (this->vsmMipmapFilter ? "mipmap" : "blur") << endl;
+        if (usesShadowMoments()) {
+            // 模糊贴图只在模糊过滤时创建，矩贴图只在mipmap过滤时带有mipmap，重新创建渲染目标
+            releaseDirectionLightDepthMap();
+            loadDirectionLightDepthMap();
+            invalidateStaticShadows();
+        }
+    }
+    // 按下F8时切换前向渲染和延迟渲染
+    if (this->window->wasKeyJustPressed(GLFW_KEY_F8)) {
+        this->deferredShading = !this->deferredShading;
+        cout << "[render] " << (this->deferredShading ? "deferred" : "forward") << " shading" << endl;
+    }
+    // 按下F11时切换深度预pass
+    if (this->window->wasKeyJustPressed(GLFW_KEY_F11)) {
+        this->depthPrepass = !this->depthPrepass;
+        cout << "[overdraw] depth pre-pass " << (this->depthPrepass ? "on" : "off") << endl;
+    }
+    // 按下F12时切换overdraw显示
+    if (this->window->wasKeyJustPressed(GLFW_KEY_F12)) {
+        this->overdrawView = !this->overdrawView;
+    }
+    // 按下F10时切换点光源压力测试场景
+    if (this->window->wasKeyJustPressed(GLFW_KEY_F10)) {
+        setPointLightStressTest(!this->pointLightStressTest);
+        cout << "[cluster] " << this->pointLights.size() << " point lights" << endl;
+    }
+
+    // 按下3时录制接下来若干帧每个渲染pass的CPU/GPU耗时，导出为Chrome trace
+    if (this->window->wasKeyJustPressed(GLFW_KEY_3)) {
+        if (!this->window->getProfiler().isCapturing()) {
+            this->window->getProfiler().startCapture(PROFILE_CAPTURE_FRAMES, "profile_trace.json");
+        }
+    }
+
+    // 按下4时输出显存占用报告（按类别、按所属者和最大的对象）
+    if (this->window->wasKeyJustPressed(GLFW_KEY_4)) {
+        GpuResources::printReport();
+    }
 }
 
 
@@ -101,22 +579,34 @@ std::vector<Scene::ModelInfo> Scene::loadScene(const std::string& fileName) {
         if (scene["models"]) {
             for (size_t i = 0; i < scene["models"].size(); ++i) {
                 ModelInfo info;
+                glm::vec3 position, rotation, scale;
                 info.path = scene["models"][i]["path"].as<std::string>();
-                info.position.x = scene["models"][i]["position"]["x"].as<float>();
-                info.position.y = scene["models"][i]["position"]["y"].as<float>();
-                info.position.z = scene["models"][i]["position"]["z"].as<float>();
-                info.rotation.x = scene["models"][i]["rotation"]["x"].as<float>();
-                info.rotation.y = scene["models"][i]["rotation"]["y"].as<float>();
-                info.rotation.z = scene["models"][i]["rotation"]["z"].as<float>();
-                info.scale.x = scene["models"][i]["scale"]["x"].as<float>();
-                info.scale.y = scene["models"][i]["scale"]["y"].as<float>();
-                info.scale.z = scene["models"][i]["scale"]["z"].as<float>();
+                position.x = scene["models"][i]["position"]["x"].as<float>();
+                position.y = scene["models"][i]["position"]["y"].as<float>();
+                position.z = scene["models"][i]["position"]["z"].as<float>();
+                rotation.x = scene["models"][i]["rotation"]["x"].as<float>();
+                rotation.y = scene["models"][i]["rotation"]["y"].as<float>();
+                rotation.z = scene["models"][i]["rotation"]["z"].as<float>();
+                scale.x = scene["models"][i]["scale"]["x"].as<float>();
+                scale.y = scene["models"][i]["scale"]["y"].as<float>();
+                scale.z = scene["models"][i]["scale"]["z"].as<float>();
+                info.transform.setPosition(position);
+                info.transform.setRotation(rotation);
+                info.transform.setScale(scale);
+                // 可选：倾斜角和自转速度（例如地球仪的23°26'倾斜和绕y轴自转）
+                if (scene["models"][i]["tilt"]) {
+                    info.transform.setTilt(scene["models"][i]["tilt"].as<float>());
+                }
+                // 光线烘焙时不做动态旋转
+                if (scene["models"][i]["spinSpeed"] && !BAKE) {
+                    info.transform.setSpinSpeed(scene["models"][i]["spinSpeed"].as<float>());
+                }
                 models.push_back(info);
                 // 打印模型信息
                 std::cout << info.path << std::endl;
-                std::cout << info.position.x << " " << info.position.y << " " << info.position.z << std::endl;
-                std::cout << info.rotation.x << " " << info.rotation.y << " " << info.rotation.z << std::endl;
-                std::cout << info.scale.x << " " << info.scale.y << " " << info.scale.z << std::endl;
+                std::cout << position.x << " " << position.y << " " << position.z << std::endl;
+                std::cout << rotation.x << " " << rotation.y << " " << rotation.z << std::endl;
+                std::cout << scale.x << " " << scale.y << " " << scale.z << std::endl;
             }
         }
     } catch (const YAML::BadFile& e) {
@@ -150,7 +640,7 @@ std::vector<Scene::DirectionalLight> Scene::loadDirectionalLights(const std::str
                 light.lightColor.x = scene["directionalLights"][i]["lightColor"]["x"].as<float>();
                 light.lightColor.y = scene["directionalLights"][i]["lightColor"]["y"].as<float>();
                 light.lightColor.z = scene["directionalLights"][i]["lightColor"]["z"].as<float>();
-                light.lightSpaceMatrix = glm::mat4(1.0f);
+                light.lightSpaceMatrices.resize(CASCADE_COUNT, glm::mat4(1.0f));
                 directionalLights.push_back(light);
             }
         }
@@ -195,241 +685,1179 @@ std::vector<Scene::PointLight> Scene::loadPointLights(const std::string& fileNam
 }
 
 void Scene::loadDirectionLightDepthMap() {
-    for (int i = 0; i < this->numDirectionalLights; ++i) {
-        // 创建帧缓冲对象
-        glGenFramebuffers(1, &this->directionLightDepthMapFBOs[i]);
-        // 深度贴图
+    // 所有定向光的所有级联共用一个纹理数组
+    int layers = std::max(this->numDirectionalLights, 1) * CASCADE_COUNT;
+    createDirectionLightShadowTarget("direction light shadow", this->directionLightDepthMapFBO, this->directionLightDepthMapArray, this->directionLightDepthMeanVarArray, layers, this->vsmMipmapFilter);
+    if (SHADOW_CACHE) {
+        // 静态物体的阴影缓存使用相同格式的渲染目标，方便每帧直接拷贝
+        createDirectionLightShadowTarget("static shadow cache", this->staticShadowFBO, this->staticShadowDepthArray, this->staticShadowMeanVarArray, layers);
+    }
+
+    // 解绑帧缓冲对象
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // 硬件PCF使用的比较采样器：采样时与参考深度比较，线性过滤让每次采样得到2x2邻域比较结果的双线性插值
+    if (this->shadowCompareSampler == 0) {
+        this->shadowCompareSampler = GpuResources::createSampler("shadow compare sampler", "Scene");
+        glSamplerParameteri(this->shadowCompareSampler, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glSamplerParameteri(this->shadowCompareSampler, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        glSamplerParameteri(this->shadowCompareSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glSamplerParameteri(this->shadowCompareSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // 采样器对象会覆盖纹理自身的环绕方式，需要同样设置边框（超出阴影贴图的坐标不在阴影中）
+        glSamplerParameteri(this->shadowCompareSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glSamplerParameteri(this->shadowCompareSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
+        glSamplerParameterfv(this->shadowCompareSampler, GL_TEXTURE_BORDER_COLOR, borderColor);
+    }
+
+    // PCSS分层遮挡物搜索使用的最小/最大深度层级在第一次构建时创建
+    this->shadowMinMaxLevels = 0;
+    this->shadowMinMaxValid = false;
+
+    if (usesShadowMoments() && !this->vsmMipmapFilter) {
+        // 两次模糊的帧缓冲，层的排列与深度贴图数组相同（mipmap过滤时不需要）
+        // 第一次模糊的结果是临时渲染目标，过滤时再绑定；第二次模糊的结果跨帧保留
+        for (int i = 0; i < 2; ++i) {
+            this->d_d2_filter_FBO[i] = GpuResources::createFramebuffer("shadow moments blur", "Scene");
+        }
+        this->d_d2_filter_map = GpuResources::createTexture(GL_TEXTURE_2D_ARRAY, "shadow moments blur", "Scene");
+        glBindTexture(GL_TEXTURE_2D_ARRAY, this->d_d2_filter_map);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, getShadowMomentsFormat(), this->shadowWidth, this->shadowHeight, layers, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindFramebuffer(GL_FRAMEBUFFER, this->d_d2_filter_FBO[1]);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, this->d_d2_filter_map, 0, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    if (usesShadowMoments()) {
+        reportShadowMemory();
+    }
+}
+
+void Scene::releaseDirectionLightDepthMap() {
+    // 删除后重置为0，未创建的对象（例如非VSM时的均值和方差贴图）也是0，会被忽略
+    GpuResources::deleteFramebuffer(this->directionLightDepthMapFBO);
+    GpuResources::deleteTexture(this->directionLightDepthMapArray);
+    GpuResources::deleteTexture(this->directionLightDepthMeanVarArray);
+    GpuResources::deleteFramebuffer(this->staticShadowFBO);
+    GpuResources::deleteTexture(this->staticShadowDepthArray);
+    GpuResources::deleteTexture(this->staticShadowMeanVarArray);
+    for (int i = 0; i < 2; ++i) {
+        GpuResources::deleteFramebuffer(this->d_d2_filter_FBO[i]);
+    }
+    GpuResources::deleteTexture(this->d_d2_filter_map);
+    GpuResources::deleteFramebuffer(this->shadowMinMaxFBO);
+    GpuResources::deleteTexture(this->shadowMinMaxArray);
+}
+
+void Scene::loadLayeredShadowShader() {
+    glDeleteProgram(this->layeredShadowShader.ID);
+    // VSM需要输出深度的均值和方差，其他算法只写深度
+    const char* fragmentPath = usesShadowMoments() ? "shaders/directionLightShadowShader.fs" : "shaders/depthOnlyShader.fs";
+    vector<string> defines = getShadowCasterDefines();
+    if (this->vertexShaderLayer) {
+        this->layeredShadowShader = Shader("shaders/layeredShadowShader.vs", fragmentPath, nullptr, defines);
+    }
+    else {
+        this->layeredShadowShader = Shader("shaders/layeredShadowShaderGS.vs", fragmentPath, "shaders/layeredShadowShader.gs", defines);
+    }
+}
+
+void Scene::setShadowAlgorithm(unsigned int algorithm) {
+    unsigned int previous = this->shadowAlgorithm;
+    this->shadowAlgorithm = algorithm;
+    if (previous != algorithm && (isMomentShadowAlgorithm(previous) || isMomentShadowAlgorithm(algorithm))) {
+        // VSM/ESM/MSM的渲染目标多了矩贴图（各自的格式不同），阴影渲染着色器输出的矩也不同，需要重新创建
+        releaseDirectionLightDepthMap();
+        loadDirectionLightDepthMap();
+        glDeleteProgram(this->directionLightShadowShader.ID);
+        this->directionLightShadowShader = Shader("shaders/directionLightShadowShader.vs", "shaders/directionLightShadowShader.fs", nullptr, getShadowCasterDefines());
+        loadLayeredShadowShader();
+    }
+    invalidateStaticShadows();
+    this->shadowMinMaxValid = false;
+    cout << "[shadow] algorithm: " << SHADOW_ALGORITHM_NAMES[algorithm] << endl;
+}
+
+void Scene::createDirectionLightShadowTarget(const char* label, unsigned int& fbo, unsigned int& depthMap, unsigned int& meanVarMap, int layers, bool mipmapped) {
+    // 创建帧缓冲对象
+    fbo = GpuResources::createFramebuffer(label, "Scene");
+    // 深度贴图
+    // 创建深度贴图数组，每层对应一个光源的一个级联
+    depthMap = GpuResources::createTexture(GL_TEXTURE_2D_ARRAY, (std::string(label) + " depth").c_str(), "Scene");
+    // 绑定深度纹理
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthMap);
+    // 只关注深度值，设置为GL_DEPTH_COMPONENT
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT, this->shadowWidth, this->shadowHeight, layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    // 设置纹理过滤方式
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    // 设置纹理环绕方式，超出级联范围的坐标使用边框颜色
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    // 存储深度贴图边框颜色（防止出现采样过多，这样超出深度贴图的坐标就不会一直在阴影中）
+    float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+    // 绑定深度贴图的第0层到帧缓冲对象，渲染前再切换到对应的层（或者整个数组）
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthMap, 0, 0);
+
+    if (usesShadowMoments()) {
+        // 深度的均值和方差贴图
         // 创建深度贴图
-        glGenTextures(1, &this->directionLightDepthMaps[i]);
+        meanVarMap = GpuResources::createTexture(GL_TEXTURE_2D_ARRAY, (std::string(label) + " moments").c_str(), "Scene");
         // 绑定深度纹理
-        glBindTexture(GL_TEXTURE_2D, this->directionLightDepthMaps[i]);
-        // 只关注深度值，设置为GL_DEPTH_COMPONENT
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, meanVarMap);
+        GLenum momentsFormat = getShadowMomentsFormat();
+        int levelWidth = this->shadowWidth, levelHeight = this->shadowHeight, levels = 0;
+        while (true) {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, levels, momentsFormat, levelWidth, levelHeight, layers, 0, GL_RGBA, GL_FLOAT, NULL);
+            levels++;
+            // 不使用mipmap时只分配第0级
+            if (!mipmapped || (levelWidth == 1 && levelHeight == 1)) {
+                break;
+            }
+            levelWidth = std::max(levelWidth / 2, 1);
+            levelHeight = std::max(levelHeight / 2, 1);
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
         // 设置纹理过滤方式
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        // 设置纹理环绕方式
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        // 存储深度贴图边框颜色（防止出现采样过多，这样超出深度贴图的坐标就不会一直在阴影中）
-        float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
-        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-        // 绑定深度贴图到帧缓冲对象
-        glBindFramebuffer(GL_FRAMEBUFFER, this->directionLightDepthMapFBOs[i]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->directionLightDepthMaps[i], 0);
-
-        if (SHADOW_ALGORITHM == 3) {
-            // 深度的均值和方差贴图
-            // 创建深度贴图
-            glGenTextures(1, &this->directionLightDepthMeanVarMaps[i]);
-            // 绑定深度纹理
-            glBindTexture(GL_TEXTURE_2D, this->directionLightDepthMeanVarMaps[i]);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_RG, GL_FLOAT, NULL);
-            // 设置纹理过滤方式
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            // 存储深度贴图边框颜色（防止出现采样过多，这样超出深度贴图的坐标就不会一直在阴影中）
-            float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
-            glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-            // 绑定到 DepthMap 中
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->directionLightDepthMeanVarMaps[i], 0);
-            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-                std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+        if (mipmapped) {
+            // 矩可以线性过滤，三线性过滤加上各向异性过滤代替固定半径的模糊
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            // 限制最小的mip级别，保证最小的滤波范围
+            glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_LOD, VSM_MIN_FILTER_LOD);
+            float maxAnisotropy = getMaxTextureAnisotropy();
+            if (maxAnisotropy > 0.0f) {
+                glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(VSM_MAX_ANISOTROPY, maxAnisotropy));
             }
-            GLenum drawBuffers[1] = { GL_COLOR_ATTACHMENT0 };
-            glDrawBuffers(1, drawBuffers);
         }
         else {
-            // 如果不需要颜色附件，则禁用颜色输出
-            glDrawBuffer(GL_NONE);
-            glReadBuffer(GL_NONE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
         }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        // 存储矩贴图边框颜色（深度为1时的矩，超出深度贴图的坐标不在阴影中）
+        glm::vec4 momentsBorderColor = getShadowMomentsClearValue();
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, glm::value_ptr(momentsBorderColor));
+        // 绑定到 DepthMap 中
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, meanVarMap, 0, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+        }
+        GLenum drawBuffers[1] = { GL_COLOR_ATTACHMENT0 };
+        glDrawBuffers(1, drawBuffers);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+    }
+    else {
+        // 如果不需要颜色附件，则禁用颜色输出
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
     }
+}
 
-    // 解绑帧缓冲对象
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+void Scene::bindDirectionLightShadowLayer(GLenum target, unsigned int fbo, unsigned int depthMap, unsigned int meanVarMap, int layer) {
+    glBindFramebuffer(target, fbo);
+    if (layer < 0) {
+        // 分层绑定整个数组，由着色器中的gl_Layer选择写入的层，glClear会清空所有层
+        glFramebufferTexture(target, GL_DEPTH_ATTACHMENT, depthMap, 0);
+        if (usesShadowMoments()) {
+            glFramebufferTexture(target, GL_COLOR_ATTACHMENT0, meanVarMap, 0);
+        }
+        return;
+    }
+    glFramebufferTextureLayer(target, GL_DEPTH_ATTACHMENT, depthMap, 0, layer);
+    if (usesShadowMoments()) {
+        glFramebufferTextureLayer(target, GL_COLOR_ATTACHMENT0, meanVarMap, 0, layer);
+    }
+}
 
-    if (SHADOW_ALGORITHM == 3) {
-        for (int i = 0; i < this->numDirectionalLights; ++i) {
-            glGenFramebuffers(1, &this->d_d2_filter_FBO[i * 2]);
-            glGenTextures(1, &this->d_d2_filter_maps[i * 2]);
-            glBindTexture(GL_TEXTURE_2D, this->d_d2_filter_maps[i * 2]);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_RG, GL_FLOAT, NULL);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glBindFramebuffer(GL_FRAMEBUFFER, this->d_d2_filter_FBO[i * 2]);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->d_d2_filter_maps[i * 2], 0);
-            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-                std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+void Scene::clearDirectionLightShadowTarget() {
+    if (usesShadowMoments()) {
+        // 注意这里的初始化, 1.0f 深度最大值（EVSM/ESM/MSM时是深度1对应的矩）
+        glm::vec4 clearValue = getShadowMomentsClearValue();
+        glClearColor(clearValue.x, clearValue.y, clearValue.z, clearValue.w);
+        glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+    }
+    else {
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+}
+
+void Scene::updateCascades() {
+    // 摄像机参数，与GLFWWindowFactory::run中的投影矩阵保持一致
+    glm::mat4 cameraView = this->window->getViewMatrix();
+    float fov = glm::radians(this->window->getCameraZoom());
+    float aspect = (float)this->window->getFramebufferWidth() / (float)std::max(this->window->getFramebufferHeight(), 1);
+    float cameraNear = GLFWWindowFactory::CAMERA_NEAR;
+
+    // 场景包围盒的8个顶点
+    glm::vec3 boundsCorners[8];
+    for (int k = 0; k < 8; ++k) {
+        boundsCorners[k] = glm::vec3(
+            (k & 1) ? this->sceneBoundsMax.x : this->sceneBoundsMin.x,
+            (k & 2) ? this->sceneBoundsMax.y : this->sceneBoundsMin.y,
+            (k & 4) ? this->sceneBoundsMax.z : this->sceneBoundsMin.z);
+    }
+
+    // 阴影覆盖的最远距离：不超过SHADOW_DISTANCE，也不超过场景包围盒在视空间中的最远深度
+    float sceneFar = 0.0f;
+    for (int k = 0; k < 8; ++k) {
+        glm::vec4 viewCorner = cameraView * glm::vec4(boundsCorners[k], 1.0f);
+        sceneFar = std::max(sceneFar, -viewCorner.z);
+    }
+    float shadowFar = std::min(std::max(sceneFar, cameraNear + 1.0f), SHADOW_DISTANCE);
+
+    // 计算级联分割（均匀分割和对数分割的混合）
+    for (unsigned int c = 0; c < CASCADE_COUNT; ++c) {
+        float p = (float)(c + 1) / (float)CASCADE_COUNT;
+        float logSplit = cameraNear * std::pow(shadowFar / cameraNear, p);
+        float uniformSplit = cameraNear + (shadowFar - cameraNear) * p;
+        this->cascadeSplits[c] = CASCADE_SPLIT_LAMBDA * logSplit + (1.0f - CASCADE_SPLIT_LAMBDA) * uniformSplit;
+    }
+
+    for (int i = 0; i < this->numDirectionalLights; ++i) {
+        // 光源视图矩阵只包含旋转（位于原点），这样级联中心在光空间中的平移可以按纹素对齐
+        glm::vec3 lightDir = glm::normalize(this->directionalLights[i].direction);
+        glm::vec3 up = std::abs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDir, up);
+
+        // 场景包围盒在光空间中的深度范围，保证级联之外、位于光源和级联之间的遮挡物也能投射阴影
+        float minZ = std::numeric_limits<float>::max();
+        float maxZ = std::numeric_limits<float>::lowest();
+        for (int k = 0; k < 8; ++k) {
+            glm::vec4 lightCorner = lightView * glm::vec4(boundsCorners[k], 1.0f);
+            minZ = std::min(minZ, lightCorner.z);
+            maxZ = std::max(maxZ, lightCorner.z);
+        }
+
+        float sliceNear = cameraNear;
+        for (unsigned int c = 0; c < CASCADE_COUNT; ++c) {
+            float sliceFar = this->cascadeSplits[c];
+            // 当前级联对应的视锥体切片的8个顶点（世界空间）
+            glm::mat4 inverseSlice = glm::inverse(glm::perspective(fov, aspect, sliceNear, sliceFar) * cameraView);
+            glm::vec3 sliceCorners[8];
+            glm::vec3 center = glm::vec3(0.0f);
+            for (int k = 0; k < 8; ++k) {
+                glm::vec4 corner = inverseSlice * glm::vec4((k & 1) ? 1.0f : -1.0f, (k & 2) ? 1.0f : -1.0f, (k & 4) ? 1.0f : -1.0f, 1.0f);
+                sliceCorners[k] = glm::vec3(corner) / corner.w;
+                center += sliceCorners[k];
             }
+            center /= 8.0f;
 
-            glGenFramebuffers(1, &this->d_d2_filter_FBO[i * 2 + 1]);
-            glGenTextures(1, &this->d_d2_filter_maps[i * 2 + 1]);
-            glBindTexture(GL_TEXTURE_2D, this->d_d2_filter_maps[i * 2 + 1]);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_RG, GL_FLOAT, NULL);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glBindFramebuffer(GL_FRAMEBUFFER, this->d_d2_filter_FBO[i * 2 + 1]);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->d_d2_filter_maps[i * 2 + 1], 0);
-            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-                std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+            // 使用包围球而不是包围盒，级联的大小不随摄像机旋转而变化
+            float radius = 0.0f;
+            for (int k = 0; k < 8; ++k) {
+                radius = std::max(radius, glm::length(sliceCorners[k] - center));
             }
+            radius = std::ceil(radius * 16.0f) / 16.0f;
+
+            // 按纹素对齐级联中心，避免摄像机移动时阴影边缘闪烁
+            glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+            float texelSize = 2.0f * radius / (float)this->shadowWidth;
+            lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+            lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+            // 光源视图看向-z方向，近平面对应最大的z值
+            glm::mat4 lightProjection = glm::ortho(
+                lightCenter.x - radius, lightCenter.x + radius,
+                lightCenter.y - radius, lightCenter.y + radius,
+                -maxZ - 1.0f, -minZ + 1.0f);
+            this->directionalLights[i].lightSpaceMatrices[c] = lightProjection * lightView;
+
+            sliceNear = sliceFar;
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
 }
 
 void Scene::renderSceneToDepthMap() {
+    Profiler::Scope profileScope(this->window->getProfiler(), "renderSceneToDepthMap");
+    // 根据摄像机视锥体更新级联
+    updateCascades();
+
     // 解决悬浮(pater panning)的阴影失真问题
     // 告诉opengl剔除正面
     glCullFace(GL_FRONT);
-    // 投影矩阵
-    // 阴影贴图覆盖的实际范围(正交投影)
-    float edge = 120.0f;
-    glm::mat4 lightProjection = glm::ortho(-edge, edge, -edge, edge, NEAR_PLANE, FAR_PLANE);
-    // 透视投影
-    // 对每个方向光生成阴影贴图
-    // 视图矩阵
-    glm::mat4 lightView;
-    // 计算阴影矩阵
+    // 切换视口
+    glViewport(0, 0, this->shadowWidth, this->shadowHeight);
+    // 矩阴影（VSM、ESM、MSM）需要把矩写入颜色附件，其他算法只写深度，关闭颜色写入
+    if (!usesShadowMoments()) {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    }
+    this->shadowMapsUpdated = false;
+    this->updatedShadowLayers.clear();
+    if (this->shadowSinglePass) {
+        renderShadowLayersSinglePass();
+    }
+    else {
+        renderShadowLayersPerLight(getShadowCasterShader());
+    }
+
+    // VSM的矩在所有层渲染完之后统一过滤，单独统计过滤的开销
+    if (usesShadowMoments() && this->shadowMapsUpdated) {
+        filterShadowMoments();
+    }
+
+    // 解绑帧缓冲对象
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // 恢复颜色写入
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    // 恢复剔除背面
+    glCullFace(GL_BACK);
+
+    // PCSS分层遮挡物搜索需要与阴影贴图一致的最小/最大深度层级
+    if (this->shadowAlgorithm == 2 && this->pcssHierarchical && (this->shadowMapsUpdated || !this->shadowMinMaxValid)) {
+        buildShadowMinMaxPyramid();
+    }
+
+    reportShadowStats();
+}
+
+void Scene::renderShadowLayersPerLight(Shader& casterShader) {
+    // 对每个方向光的每个级联生成阴影贴图
     for (int i = 0; i < this->numDirectionalLights; ++i) {
-        lightView = glm::lookAt(-directionalLights[i].direction * 1.0f, glm::vec3(0.0f), glm::vec3(0.0, 1.0, 0.0));
-        this->directionalLights[i].lightSpaceMatrix = lightProjection * lightView;
-        // DEBUG
-        // cout << "lightSpaceMatrix: " << lightSpaceMatrix[0][0] << " " << lightSpaceMatrix[0][1] << " " << lightSpaceMatrix[0][2] << " " << lightSpaceMatrix[0][3] << endl;
-        // cout << "lightSpaceMatrix: " << lightSpaceMatrix[1][0] << " " << lightSpaceMatrix[1][1] << " " << lightSpaceMatrix[1][2] << " " << lightSpaceMatrix[1][3] << endl;
-        // cout << "lightSpaceMatrix: " << lightSpaceMatrix[2][0] << " " << lightSpaceMatrix[2][1] << " " << lightSpaceMatrix[2][2] << " " << lightSpaceMatrix[2][3] << endl;
-        // cout << "lightSpaceMatrix: " << lightSpaceMatrix[3][0] << " " << lightSpaceMatrix[3][1] << " " << lightSpaceMatrix[3][2] << " " << lightSpaceMatrix[3][3] << endl;
+        Profiler::Scope profileScope(this->window->getProfiler(), "shadow light " + std::to_string(i));
+        auto cpuStart = std::chrono::high_resolution_clock::now();
+        this->shadowUpdateTimers[i].begin();
 
-        // 使用着色器
-        this->directionLightShadowShader.use();
-        // 传递阴影矩阵给着色器
-        this->directionLightShadowShader.setMat4("lightSpaceMatrix", this->directionalLights[i].lightSpaceMatrix);
+        for (unsigned int c = 0; c < CASCADE_COUNT; ++c) {
+            const glm::mat4& lightSpaceMatrix = this->directionalLights[i].lightSpaceMatrices[c];
+            // 在阴影贴图数组中的层
+            int layer = i * CASCADE_COUNT + c;
+            // 使用着色器
+            casterShader.use();
+            // 传递阴影矩阵给着色器
+            casterShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
 
-        // 切换视口
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+            // 阴影贴图本帧是否有更新
+            bool updated = true;
+            if (SHADOW_CACHE) {
+                bool cached = this->staticShadowValid[layer] && this->staticShadowLightSpaceMatrices[layer] == lightSpaceMatrix;
+                // 级联每帧按摄像机重新拟合，摄像机移动时与上一帧不同，此时重建的缓存下一帧又会失效
+                bool settled = this->previousLightSpaceMatrices[layer] == lightSpaceMatrix;
+                this->previousLightSpaceMatrices[layer] = lightSpaceMatrix;
+                if (!cached && !settled) {
+                    // 级联还在移动：跳过缓存，直接渲染所有物体（开销与不使用缓存相同），级联稳定一帧之后再重建缓存
+                    bindDirectionLightShadowLayer(GL_FRAMEBUFFER, this->directionLightDepthMapFBO, this->directionLightDepthMapArray, this->directionLightDepthMeanVarArray, layer);
+                    clearDirectionLightShadowTarget();
+                    renderShadowCasters(casterShader, RenderFilter::All);
+                    this->staticShadowBypasses[i]++;
+                }
+                else {
+                    // 光源方向、级联稳定下来或者静态物体变化时，重新渲染静态物体的阴影缓存
+                    bool staticChanged = false;
+                    if (!cached) {
+                        bindDirectionLightShadowLayer(GL_FRAMEBUFFER, this->staticShadowFBO, this->staticShadowDepthArray, this->staticShadowMeanVarArray, layer);
+                        clearDirectionLightShadowTarget();
+                        renderShadowCasters(casterShader, RenderFilter::Static);
+                        this->staticShadowLightSpaceMatrices[layer] = lightSpaceMatrix;
+                        this->staticShadowValid[layer] = true;
+                        this->staticShadowRebuilds[i]++;
+                        staticChanged = true;
+                    }
 
-        // 绑定帧缓冲
-        glBindFramebuffer(GL_FRAMEBUFFER, this->directionLightDepthMapFBOs[i]);
+                    if (staticChanged || this->hasDynamicObjects) {
+                        // 以静态物体的阴影缓存为起点
+                        bindDirectionLightShadowLayer(GL_READ_FRAMEBUFFER, this->staticShadowFBO, this->staticShadowDepthArray, this->staticShadowMeanVarArray, layer);
+                        bindDirectionLightShadowLayer(GL_DRAW_FRAMEBUFFER, this->directionLightDepthMapFBO, this->directionLightDepthMapArray, this->directionLightDepthMeanVarArray, layer);
+                        GLbitfield mask = GL_DEPTH_BUFFER_BIT;
+                        if (usesShadowMoments()) {
+                            mask |= GL_COLOR_BUFFER_BIT;
+                        }
+                        glBlitFramebuffer(0, 0, this->shadowWidth, this->shadowHeight, 0, 0, this->shadowWidth, this->shadowHeight, mask, GL_NEAREST);
+                        // 只光栅化动态物体
+                        glBindFramebuffer(GL_FRAMEBUFFER, this->directionLightDepthMapFBO);
+                        renderShadowCasters(casterShader, RenderFilter::Dynamic);
+                    }
+                    else {
+                        // 级联和物体都没有变化，上一帧的阴影贴图仍然有效
+                        updated = false;
+                    }
+                }
+            }
+            else {
+                // 绑定帧缓冲
+                bindDirectionLightShadowLayer(GL_FRAMEBUFFER, this->directionLightDepthMapFBO, this->directionLightDepthMapArray, this->directionLightDepthMeanVarArray, layer);
+                clearDirectionLightShadowTarget();
+                // 渲染场景
+                renderShadowCasters(casterShader, RenderFilter::All);
+            }
 
-        if (SHADOW_ALGORITHM == 3) {
-            glClearColor(1.0f, 1.0f, 0.0f, 1.0f); // 注意这里的初始化, 1.0f 深度最大值
-            glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+            this->shadowMapsUpdated = this->shadowMapsUpdated || updated;
+            if (updated) {
+                this->updatedShadowLayers.push_back(layer);
+            }
+        }
+
+        this->shadowUpdateTimers[i].end();
+        auto cpuEnd = std::chrono::high_resolution_clock::now();
+        this->shadowUpdateCpuMs[i] += std::chrono::duration<double, std::milli>(cpuEnd - cpuStart).count();
+    }
+}
+
+void Scene::renderShadowLayersSinglePass() {
+    Profiler::Scope profileScope(this->window->getProfiler(), "renderShadowLayersSinglePass");
+    auto cpuStart = std::chrono::high_resolution_clock::now();
+    this->shadowSinglePassTimer.begin();
+
+    // 收集所有层的光空间矩阵，第i个定向光的第c个级联位于第i*CASCADE_COUNT+c层
+    int layers = this->numDirectionalLights * CASCADE_COUNT;
+    vector<glm::mat4> matrices(layers);
+    for (int i = 0; i < this->numDirectionalLights; ++i) {
+        for (unsigned int c = 0; c < CASCADE_COUNT; ++c) {
+            matrices[i * CASCADE_COUNT + c] = this->directionalLights[i].lightSpaceMatrices[c];
+        }
+    }
+    setLayeredShadowMatrices(matrices);
+
+    // 阴影贴图本帧是否有更新
+    bool updated = true;
+    // 单次提交无法只渲染部分层，任意一层失效时所有层一起处理
+    bool staticChanged = false;
+    // 失效的层中是否有级联与上一帧不同（摄像机或光源在移动），此时重建的缓存下一帧又会失效
+    bool moving = false;
+    if (SHADOW_CACHE) {
+        for (int layer = 0; layer < layers; ++layer) {
+            if (!this->staticShadowValid[layer] || this->staticShadowLightSpaceMatrices[layer] != matrices[layer]) {
+                staticChanged = true;
+                moving = moving || this->previousLightSpaceMatrices[layer] != matrices[layer];
+            }
+            this->previousLightSpaceMatrices[layer] = matrices[layer];
+        }
+    }
+    if (SHADOW_CACHE && !(staticChanged && moving)) {
+        if (staticChanged) {
+            bindDirectionLightShadowLayer(GL_FRAMEBUFFER, this->staticShadowFBO, this->staticShadowDepthArray, this->staticShadowMeanVarArray, -1);
+            clearDirectionLightShadowTarget();
+            renderShadowCasters(this->layeredShadowShader, RenderFilter::Static, layers);
+            for (int layer = 0; layer < layers; ++layer) {
+                this->staticShadowLightSpaceMatrices[layer] = matrices[layer];
+                this->staticShadowValid[layer] = true;
+            }
+            for (int i = 0; i < this->numDirectionalLights; ++i) {
+                this->staticShadowRebuilds[i] += CASCADE_COUNT;
+            }
+        }
+
+        if (staticChanged || this->hasDynamicObjects) {
+            // 以静态物体的阴影缓存为起点，glBlitFramebuffer只能拷贝单层，逐层拷贝
+            GLbitfield mask = GL_DEPTH_BUFFER_BIT;
+            if (usesShadowMoments()) {
+                mask |= GL_COLOR_BUFFER_BIT;
+            }
+            for (int layer = 0; layer < layers; ++layer) {
+                bindDirectionLightShadowLayer(GL_READ_FRAMEBUFFER, this->staticShadowFBO, this->staticShadowDepthArray, this->staticShadowMeanVarArray, layer);
+                bindDirectionLightShadowLayer(GL_DRAW_FRAMEBUFFER, this->directionLightDepthMapFBO, this->directionLightDepthMapArray, this->directionLightDepthMeanVarArray, layer);
+                glBlitFramebuffer(0, 0, this->shadowWidth, this->shadowHeight, 0, 0, this->shadowWidth, this->shadowHeight, mask, GL_NEAREST);
+            }
+            // 一次提交把动态物体光栅化到所有层
+            bindDirectionLightShadowLayer(GL_FRAMEBUFFER, this->directionLightDepthMapFBO, this->directionLightDepthMapArray, this->directionLightDepthMeanVarArray, -1);
+            renderShadowCasters(this->layeredShadowShader, RenderFilter::Dynamic, layers);
         }
         else {
-            glClear(GL_DEPTH_BUFFER_BIT);
+            // 级联和物体都没有变化，上一帧的阴影贴图仍然有效
+            updated = false;
         }
+    }
+    else {
+        // 不使用缓存，或者级联还在移动：直接渲染所有物体（开销与不使用缓存相同），级联稳定一帧之后再重建缓存
+        bindDirectionLightShadowLayer(GL_FRAMEBUFFER, this->directionLightDepthMapFBO, this->directionLightDepthMapArray, this->directionLightDepthMeanVarArray, -1);
+        clearDirectionLightShadowTarget();
+        renderShadowCasters(this->layeredShadowShader, RenderFilter::All, layers);
+        if (SHADOW_CACHE) {
+            for (int i = 0; i < this->numDirectionalLights; ++i) {
+                this->staticShadowBypasses[i] += CASCADE_COUNT;
+            }
+        }
+    }
 
-        // 渲染场景
-        renderScene(this->directionLightShadowShader, false);
+    this->shadowMapsUpdated = updated;
+    if (updated) {
+        for (int layer = 0; layer < layers; ++layer) {
+            this->updatedShadowLayers.push_back(layer);
+        }
+    }
 
-        if (SHADOW_ALGORITHM == 3) {
-            // 绑定均值和方差帧缓冲对象 pass2
-            glBindFramebuffer(GL_FRAMEBUFFER, this->d_d2_filter_FBO[i * 2]);
-            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            // 使用均值和方差计算着色器
-            this->d_d2_filter_shader.use();
-            this->d_d2_filter_shader.setBool("vertical", false);
-            this->d_d2_filter_shader.setInt("d_d2", 0);
-            // 激活深度贴图
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, this->directionLightDepthMeanVarMaps[i]);
-            renderQuad();
+    this->shadowSinglePassTimer.end();
+    auto cpuEnd = std::chrono::high_resolution_clock::now();
+    this->shadowSinglePassCpuMs += std::chrono::duration<double, std::milli>(cpuEnd - cpuStart).count();
+}
 
-            // 绑定均值和方差帧缓冲对象 pass3
-            glBindFramebuffer(GL_FRAMEBUFFER, this->d_d2_filter_FBO[i * 2 + 1]);
-            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            // 使用均值和方差计算着色器
-            this->d_d2_filter_shader.use();
-            this->d_d2_filter_shader.setBool("vertical", true);
-            this->d_d2_filter_shader.setInt("d_d2", 0);
-            // 激活深度贴图
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, this->d_d2_filter_maps[i * 2]);
-            renderQuad();
+void Scene::setLayeredShadowMatrices(const vector<glm::mat4>& matrices) {
+    this->layeredShadowShader.use();
+    for (size_t layer = 0; layer < matrices.size(); ++layer) {
+        this->layeredShadowShader.setMat4("lightSpaceMatrices[" + std::to_string(layer) + "]", matrices[layer]);
+    }
+}
+
+void Scene::filterShadowMoments() {
+    Profiler::Scope profileScope(this->window->getProfiler(), "filterShadowMoments");
+    this->vsmFilterTimer.begin();
+    if (this->vsmMipmapFilter) {
+        // 矩是线性的，mipmap的每一级就是更大范围的盒式滤波，所有层一次生成
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, this->directionLightDepthMeanVarArray);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    }
+    else if (!this->updatedShadowLayers.empty()) {
+        // 第一次模糊的结果只在一层的两次模糊之间使用：帧图中由阴影pass分配，帧图之外（阴影算法对比）直接从池中借用
+        unsigned int scratch = this->momentsBlurScratch;
+        if (scratch == 0) {
+            scratch = this->renderTargetPool.acquire(getMomentsBlurDesc(), "shadow moments blur");
         }
+        for (int layer : this->updatedShadowLayers) {
+            filterDirectionLightMeanVar(layer, scratch);
+        }
+        if (this->momentsBlurScratch == 0) {
+            this->renderTargetPool.release(scratch);
+        }
+    }
+    this->vsmFilterTimer.end();
+}
+
+FrameGraphTextureDesc Scene::getMomentsBlurDesc() const {
+    FrameGraphTextureDesc desc;
+    desc.target = GL_TEXTURE_2D_ARRAY;
+    desc.width = this->shadowWidth;
+    desc.height = this->shadowHeight;
+    desc.layers = std::max(this->numDirectionalLights, 1) * CASCADE_COUNT;
+    desc.internalFormat = getShadowMomentsFormat();
+    return desc;
+}
+
+unsigned int Scene::getShadowMomentsArray() const {
+    return this->vsmMipmapFilter ? this->directionLightDepthMeanVarArray : this->d_d2_filter_map;
+}
+
+float Scene::getVSMExponent() const {
+    if (!VSM_EXPONENTIAL) {
+        return 0.0f;
     }
+    // 深度为1时的二阶矩exp(2c)不能超过格式能表示的最大值（16位浮点为65504）
+    float maxExponent = VSM_16BIT_MOMENTS ? 0.5f * std::log(65504.0f) : 42.0f;
+    return std::min(EVSM_EXPONENT, maxExponent);
+}
 
-    // 解绑帧缓冲对象
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    // 恢复剔除背面
-    glCullFace(GL_BACK);
+float Scene::getESMExponent() const {
+    // exp(c)不能超过格式能表示的最大值
+    float maxExponent = VSM_16BIT_MOMENTS ? std::log(65504.0f) : 88.0f;
+    return std::min(ESM_EXPONENT, maxExponent);
+}
+
+bool Scene::usesShadowMoments() const {
+    return isMomentShadowAlgorithm(this->shadowAlgorithm);
+}
+
+GLenum Scene::getShadowMomentsFormat() const {
+    if (this->shadowAlgorithm == 5) {
+        return VSM_16BIT_MOMENTS ? GL_R16F : GL_R32F;
+    }
+    if (this->shadowAlgorithm == 6) {
+        return VSM_16BIT_MOMENTS ? GL_RGBA16 : GL_RGBA32F;
+    }
+    return VSM_16BIT_MOMENTS ? GL_RG16F : GL_RG32F;
+}
+
+size_t Scene::getShadowMomentsBytes() const {
+    // 每个通道2或4字节
+    size_t channels = this->shadowAlgorithm == 5 ? 1 : (this->shadowAlgorithm == 6 ? 4 : 2);
+    return channels * (VSM_16BIT_MOMENTS ? 2 : 4);
+}
+
+glm::vec4 Scene::getShadowMomentsClearValue() const {
+    if (this->shadowAlgorithm == 5) {
+        return glm::vec4(std::exp(getESMExponent()), 0.0f, 0.0f, 1.0f);
+    }
+    if (this->shadowAlgorithm == 6) {
+        if (VSM_16BIT_MOMENTS) {
+            // 深度为1的4个矩(1, 1, 1, 1)经过优化量化后的值，与directionLightShadowShader.fs中的量化保持一致
+            return glm::vec4(1.0f, 0.9976223f, 0.8934116f, 0.0f);
+        }
+        return glm::vec4(1.0f);
+    }
+    float exponent = getVSMExponent();
+    float moment = exponent > 0.0f ? std::exp(exponent) : 1.0f;
+    return glm::vec4(moment, moment * moment, 0.0f, 1.0f);
+}
+
+vector<string> Scene::getShadowCasterDefines() const {
+    if (this->shadowAlgorithm == 5) {
+        return { "ESM_EXPONENT " + std::to_string(getESMExponent()) };
+    }
+    if (this->shadowAlgorithm == 6) {
+        if (VSM_16BIT_MOMENTS) {
+            return { "MSM_MOMENTS 1", "MSM_QUANTIZED 1" };
+        }
+        return { "MSM_MOMENTS 1" };
+    }
+    float exponent = getVSMExponent();
+    if (exponent <= 0.0f) {
+        return {};
+    }
+    return { "EVSM_EXPONENT " + std::to_string(exponent) };
+}
+
+void Scene::reportShadowMemory() const {
+    // 每个定向光的层数
+    size_t texels = (size_t)this->shadowWidth * this->shadowHeight * CASCADE_COUNT;
+    size_t momentsBytes = getShadowMomentsBytes();
+    // mipmap的所有级别
+    size_t mipTexels = 0;
+    int levelWidth = this->shadowWidth, levelHeight = this->shadowHeight;
+    while (true) {
+        mipTexels += (size_t)levelWidth * levelHeight * CASCADE_COUNT;
+        if (levelWidth == 1 && levelHeight == 1) {
+            break;
+        }
+        levelWidth = std::max(levelWidth / 2, 1);
+        levelHeight = std::max(levelHeight / 2, 1);
+    }
+    // 深度贴图按每个纹素4字节估计（实际格式由驱动决定）
+    size_t depthBytes = texels * 4 * (SHADOW_CACHE ? 2 : 1);
+    size_t liveMomentsBytes = (this->vsmMipmapFilter ? mipTexels : texels) * momentsBytes;
+    size_t cacheMomentsBytes = SHADOW_CACHE ? texels * momentsBytes : 0;
+    size_t blurBytes = this->vsmMipmapFilter ? 0 : texels * momentsBytes * 2;
+    size_t totalBytes = depthBytes + liveMomentsBytes + cacheMomentsBytes + blurBytes;
+    // 原来的布局：RG32F的矩和两张RG32F的模糊贴图
+    size_t legacyBytes = depthBytes + texels * 8 * (SHADOW_CACHE ? 4 : 3);
+    const float MB = 1024.0f * 1024.0f;
+    const char* formatName = VSM_16BIT_MOMENTS ? "16-bit" : "32-bit";
+    cout << "[" << SHADOW_ALGORITHM_NAMES[this->shadowAlgorithm] << "] " << formatName << (this->shadowAlgorithm == 3 && getVSMExponent() > 0.0f ? " EVSM" : "")
+        << " moments, " << (this->vsmMipmapFilter ? "mipmap" : "blur") << " filter: " << totalBytes / MB << " MB per light"
+        << " (depth " << depthBytes / MB << ", moments " << liveMomentsBytes / MB << ", static cache moments " << cacheMomentsBytes / MB
+        << ", blur targets " << blurBytes / MB << "), RG32F + blur layout: " << legacyBytes / MB << " MB per light" << endl;
+}
+
+void Scene::filterDirectionLightMeanVar(int layer, unsigned int scratch) {
+    // 绑定均值和方差帧缓冲对象 pass2
+    glBindFramebuffer(GL_FRAMEBUFFER, this->d_d2_filter_FBO[0]);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, scratch, 0, layer);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // 使用均值和方差计算着色器
+    this->d_d2_filter_shader.use();
+    this->d_d2_filter_shader.setBool("vertical", false);
+    this->d_d2_filter_shader.setInt("d_d2", 0);
+    this->d_d2_filter_shader.setInt("layer", layer);
+    // 激活深度贴图
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, this->directionLightDepthMeanVarArray);
+    renderQuad();
+
+    // 绑定均值和方差帧缓冲对象 pass3
+    glBindFramebuffer(GL_FRAMEBUFFER, this->d_d2_filter_FBO[1]);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, this->d_d2_filter_map, 0, layer);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // 使用均值和方差计算着色器
+    this->d_d2_filter_shader.use();
+    this->d_d2_filter_shader.setBool("vertical", true);
+    this->d_d2_filter_shader.setInt("d_d2", 0);
+    this->d_d2_filter_shader.setInt("layer", layer);
+    // 激活深度贴图
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, scratch);
+    renderQuad();
 }
 
-void Scene::renderScene(Shader& shader, bool isActiveTexture) {
+void Scene::invalidateStaticShadows() {
+    for (size_t i = 0; i < this->staticShadowValid.size(); ++i) {
+        this->staticShadowValid[i] = false;
+    }
+}
+
+void Scene::reportShadowStats() {
+    if (++this->shadowStatsFrame < SHADOW_STATS_INTERVAL) {
+        return;
+    }
+    if (this->shadowSinglePass) {
+        // 单次提交时只能统计所有光源的总开销
+        cout << "[shadow] all lights (single pass, " << this->numDirectionalLights * CASCADE_COUNT << " layers)"
+            << ": gpu " << this->shadowSinglePassTimer.getAverageMs() << " ms"
+            << ", cpu " << this->shadowSinglePassCpuMs / this->shadowStatsFrame << " ms" << endl;
+        this->shadowSinglePassTimer.reset();
+        this->shadowSinglePassCpuMs = 0.0;
+        for (int i = 0; i < this->numDirectionalLights; ++i) {
+            cout << "[shadow] light " << i
+                << ": static cascade rebuilds " << this->staticShadowRebuilds[i] << ", uncached cascades " << this->staticShadowBypasses[i]
+                << " in " << this->shadowStatsFrame << " frames" << endl;
+            this->staticShadowRebuilds[i] = 0;
+            this->staticShadowBypasses[i] = 0;
+        }
+    }
+    else {
+        for (int i = 0; i < this->numDirectionalLights; ++i) {
+            cout << "[shadow] light " << i
+                << ": gpu " << this->shadowUpdateTimers[i].getAverageMs() << " ms"
+                << ", cpu " << this->shadowUpdateCpuMs[i] / this->shadowStatsFrame << " ms"
+                << ", static cascade rebuilds " << this->staticShadowRebuilds[i] << ", uncached cascades " << this->staticShadowBypasses[i]
+                << " in " << this->shadowStatsFrame << " frames" << endl;
+            this->shadowUpdateTimers[i].reset();
+            this->shadowUpdateCpuMs[i] = 0.0;
+            this->staticShadowRebuilds[i] = 0;
+            this->staticShadowBypasses[i] = 0;
+        }
+    }
+    if (usesShadowMoments()) {
+        // 只在阴影贴图有更新的帧过滤，统计的是每次过滤的平均开销
+        cout << "[" << SHADOW_ALGORITHM_NAMES[this->shadowAlgorithm] << "] filter (" << (this->vsmMipmapFilter ? "mipmap" : "blur") << "): gpu " << this->vsmFilterTimer.getAverageMs() << " ms"
+            << ", " << this->vsmFilterTimer.getSampleCount() << " filter passes in " << this->shadowStatsFrame << " frames" << endl;
+        this->vsmFilterTimer.reset();
+    }
+    this->shadowStatsFrame = 0;
+}
+
+void Scene::renderScene(Shader& shader, bool isActiveTexture, RenderFilter filter) {
+    Profiler::Scope profileScope(this->window->getProfiler(), "renderScene");
     shader.use();
     // 绘制每个模型
     for (const auto& modelInfo : modelInfos) {
-        // 获取当前时间（s）
-        float currentTime = glfwGetTime();
-        // 根据时间计算旋转角度，10.0f是速度因子
-        float angle = currentTime * 10.0f;
-
-        // 初始化模型矩阵
-        glm::mat4 model = glm::mat4(1.0f);
-        // 平移模型
-        model = glm::translate(model, modelInfo.position);
-        // 静态旋转
-        model = glm::rotate(model, glm::radians(modelInfo.rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(modelInfo.rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(modelInfo.rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-        if (modelInfo.path.find("sphere.obj") != std::string::npos) {
-            // 添加倾斜23°26'，因为支架的模型本来就是倾斜的，所以不用再倾斜，只需要调整球体即可
-            float tiltAngle = 23.433f;
-            model = glm::rotate(model, glm::radians(tiltAngle), glm::vec3(0.0f, 0.0f, 1.0f));
-
-            // 动态旋转（绕y轴旋转
-            if (!BAKE)
-                model = glm::rotate(model, glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
-        }
-        // 缩放模型
-        model = glm::scale(model, modelInfo.scale);
-        // 传递模型矩阵给着色器
-        shader.setMat4("model", model);
+        // 按静态/动态筛选物体
+        if (filter == RenderFilter::Static && modelInfo.transform.isAnimated()) {
+            continue;
+        }
+        if (filter == RenderFilter::Dynamic && !modelInfo.transform.isAnimated()) {
+            continue;
+        }
+        // 传递模型矩阵和法线矩阵给着色器（已在updateTransforms中缓存）
+        shader.setMat4("model", modelInfo.transform.getWorldMatrix());
+        shader.setMat3("normalMatrix", modelInfo.transform.getNormalMatrix());
 
         // 绘制模型
-        modelInfo.model->draw(shader, this->directionLightDepthMaps, isActiveTexture, this->d_d2_filter_maps, SHADOW_ALGORITHM == 3, BAKE, lightMap);
+        modelInfo.model->draw(shader, this->directionLightDepthMapArray, this->shadowCompareSampler, isActiveTexture, getShadowMomentsArray(), usesShadowMoments(), BAKE, lightMap);
+    }
+}
+
+void Scene::renderShadowCasters(Shader& shader, RenderFilter filter, int instanceCount) {
+    shader.use();
+    // 每个模型只设置一次模型矩阵，然后连续绘制它的所有网格
+    for (const auto& modelInfo : modelInfos) {
+        // 按静态/动态筛选物体
+        if (filter == RenderFilter::Static && modelInfo.transform.isAnimated()) {
+            continue;
+        }
+        if (filter == RenderFilter::Dynamic && !modelInfo.transform.isAnimated()) {
+            continue;
+        }
+        shader.setMat4("model", modelInfo.transform.getWorldMatrix());
+        if (instanceCount > 0) {
+            modelInfo.model->drawDepthInstanced(instanceCount);
+        }
+        else {
+            modelInfo.model->drawDepth();
+        }
     }
+    // 解绑VAO
+    glBindVertexArray(0);
 }
 
-void Scene::processInputMoveDirLight() {
+Shader& Scene::getShadowCasterShader() {
+    if (usesShadowMoments()) {
+        return this->directionLightShadowShader;
+    }
+    return this->depthOnlyShader;
+}
+
+void Scene::updateTransforms() {
+    // 主线程模拟的结果，整帧只读取一次
+    const FrameSnapshot& frame = this->window->getFrame();
+    for (size_t i = 0; i < this->directionalLights.size() && i < frame.directionLightDirections.size(); ++i) {
+        this->directionalLights[i].direction = frame.directionLightDirections[i];
+    }
+    if (frame.transforms.size() != modelInfos.size()) {
+        return;
+    }
+    this->hasDynamicObjects = false;
+    bool boundsChanged = false;
+    for (size_t i = 0; i < modelInfos.size(); ++i) {
+        auto& modelInfo = modelInfos[i];
+        modelInfo.transform = frame.transforms[i];
+        bool changed = frame.transformsChanged[i];
+        boundsChanged = boundsChanged || changed;
+        if (modelInfo.transform.isAnimated()) {
+            this->hasDynamicObjects = true;
+        }
+        else if (changed) {
+            // 静态物体发生了变化，静态阴影缓存需要重建
+            invalidateStaticShadows();
+        }
+    }
+
+    // 更新场景包围盒（级联阴影用来确定深度范围）
+    if (boundsChanged && !modelInfos.empty()) {
+        this->sceneBoundsMin = glm::vec3(std::numeric_limits<float>::max());
+        this->sceneBoundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+        for (const auto& modelInfo : modelInfos) {
+            glm::vec3 worldMin, worldMax;
+            modelInfo.transform.getWorldBounds(modelInfo.model->boundsMin, modelInfo.model->boundsMax, worldMin, worldMax);
+            this->sceneBoundsMin = glm::min(this->sceneBoundsMin, worldMin);
+            this->sceneBoundsMax = glm::max(this->sceneBoundsMax, worldMax);
+        }
+    }
+}
+
+void Scene::setPointLightStressTest(bool enabled) {
+    this->pointLightStressTest = enabled;
+    // 点光源的序号会改变，释放所有阴影槽位
+    std::fill(this->pointShadowSlotLights.begin(), this->pointShadowSlotLights.end(), -1);
+    std::fill(this->pointShadowSlotValid.begin(), this->pointShadowSlotValid.end(), false);
+    if (!enabled) {
+        this->pointLights = this->configPointLights;
+        return;
+    }
+    this->pointLights = generateStressPointLights(STRESS_POINT_LIGHT_COUNT);
+}
+
+vector<Scene::PointLight> Scene::generateStressPointLights(unsigned int count) {
+    // 固定的随机种子，每次生成的场景相同，方便对比
+    std::mt19937 random(1037);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    vector<PointLight> lights;
+    for (unsigned int i = 0; i < count; ++i) {
+        PointLight light;
+        light.position = this->sceneBoundsMin + glm::vec3(unit(random), unit(random), unit(random)) * (this->sceneBoundsMax - this->sceneBoundsMin);
+        // 衰减较快的小光源（影响范围约10），不带环境光，避免上千个光源的环境光叠加
+        light.constant = 1.0f;
+        light.linear = 0.7f;
+        light.quadratic = 1.8f;
+        light.ambient = glm::vec3(0.0f);
+        light.diffuse = glm::vec3(1.0f);
+        light.specular = glm::vec3(0.5f);
+        // 饱和的随机颜色
+        float hue = unit(random) * 6.0f;
+        light.lightColor = glm::clamp(glm::vec3(std::abs(hue - 3.0f) - 1.0f, 2.0f - std::abs(hue - 2.0f), 2.0f - std::abs(hue - 4.0f)), 0.0f, 1.0f);
+        light.orbitSpeed = (unit(random) * 2.0f - 1.0f) * 30.0f;
+        lights.push_back(light);
+    }
+    return lights;
+}
+
+void Scene::animatePointLights() {
+    // 压力测试场景在场景包围盒内生成，第一帧更新变换之后包围盒才有效
+    if (POINT_LIGHT_STRESS_TEST && this->lastPointLightTime == 0.0f) {
+        setPointLightStressTest(true);
+    }
+    // 压力测试场景的点光源绕场景中心的y轴旋转，保证每帧都要重新分簇
+    float currentTime = this->window->getFrameTime();
+    float deltaTime = currentTime - this->lastPointLightTime;
+    this->lastPointLightTime = currentTime;
+    glm::vec3 center = (this->sceneBoundsMin + this->sceneBoundsMax) * 0.5f;
+    for (auto& light : this->pointLights) {
+        if (light.orbitSpeed != 0.0f) {
+            glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(light.orbitSpeed * deltaTime), glm::vec3(0.0f, 1.0f, 0.0f));
+            light.position = center + glm::vec3(rotation * glm::vec4(light.position - center, 1.0f));
+        }
+    }
+}
+
+LightClusters::Light Scene::getClusterLight(const PointLight& pointLight) {
+    LightClusters::Light light;
+    light.position = pointLight.position;
+    light.ambient = pointLight.ambient * pointLight.lightColor;
+    light.diffuse = pointLight.diffuse * pointLight.lightColor;
+    light.specular = pointLight.specular * pointLight.lightColor;
+    light.constant = pointLight.constant;
+    light.linear = pointLight.linear;
+    light.quadratic = pointLight.quadratic;
+    light.range = LightClusters::computeRange(light, POINT_LIGHT_CUTOFF, GLFWWindowFactory::CAMERA_FAR);
+    return light;
+}
+
+void Scene::updateLightClusters() {
+    Profiler::Scope profileScope(this->window->getProfiler(), "updateLightClusters", false);
+    vector<LightClusters::Light> lights(this->pointLights.size());
+    for (size_t i = 0; i < this->pointLights.size(); ++i) {
+        lights[i] = getClusterLight(this->pointLights[i]);
+    }
+    // 已经渲染过立方体阴影贴图的点光源投射阴影
+    for (size_t slot = 0; slot < this->pointShadowSlotLights.size(); ++slot) {
+        if (this->pointShadowSlotLights[slot] >= 0 && this->pointShadowSlotValid[slot]) {
+            lights[this->pointShadowSlotLights[slot]].shadowLayer = (int)slot * 6;
+        }
+    }
+    this->lightClusters.update(lights, this->window->getViewMatrix(), this->window->getProjectionMatrix(), GLFWWindowFactory::CAMERA_NEAR, GLFWWindowFactory::CAMERA_FAR);
+
+    // 定期输出分簇的统计
+    if (lights.empty()) {
+        return;
+    }
+    this->clusterCpuMs += this->lightClusters.getLastCpuMs();
+    if (++this->clusterStatsFrame >= SHADOW_STATS_INTERVAL) {
+        cout << "[cluster] " << this->lightClusters.getLightCount() << " point lights, "
+            << (float)this->lightClusters.getIndexCount() / (float)this->lightClusters.getClusterCount() << " lights per cluster (max "
+            << this->lightClusters.getMaxClusterLights() << "), cpu " << this->clusterCpuMs / this->clusterStatsFrame << " ms" << endl;
+        this->clusterStatsFrame = 0;
+        this->clusterCpuMs = 0.0;
+    }
+}
+
+void Scene::reportJobStats(JobSystem& jobs, const char* label) {
+    vector<JobSystem::WorkerStats> stats = jobs.getStats();
+    double elapsedMs = std::max(jobs.getStatsElapsedMs(), 1e-3);
+    cout << label << " utilization:";
+    for (size_t i = 0; i < stats.size(); ++i) {
+        // 最后一项是等待作业完成时帮忙执行的主线程/渲染线程
+        if (i + 1 == stats.size()) {
+            cout << " caller ";
+        }
+        else {
+            cout << " w" << i << " ";
+        }
+        cout << 100.0 * stats[i].busyMs / elapsedMs << "% (" << stats[i].jobs << " jobs, " << stats[i].steals << " stolen)";
+    }
+    cout << endl;
+    jobs.resetStats();
+}
+
+void Scene::createPointShadowMaps() {
+    this->pointShadowSlotLights.assign(MAX_SHADOWED_POINT_LIGHTS, -1);
+    this->pointShadowSlotValid.assign(MAX_SHADOWED_POINT_LIGHTS, false);
+    this->pointShadowSlotPositions.assign(MAX_SHADOWED_POINT_LIGHTS, glm::vec3(0.0f));
+    this->pointShadowSlotFrames.assign(MAX_SHADOWED_POINT_LIGHTS, 0);
+    // 立方体贴图数组需要OpenGL 4.0，这里用二维纹理数组存储6个面，着色器中按方向选择面
+    this->pointShadowArray = GpuResources::createTexture(GL_TEXTURE_2D_ARRAY, "point light shadow depth", "Scene");
+    glBindTexture(GL_TEXTURE_2D_ARRAY, this->pointShadowArray);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, POINT_SHADOW_SIZE, POINT_SHADOW_SIZE, MAX_SHADOWED_POINT_LIGHTS * 6, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    this->pointShadowFBO = GpuResources::createFramebuffer("point light shadow", "Scene");
+    glBindFramebuffer(GL_FRAMEBUFFER, this->pointShadowFBO);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->pointShadowArray, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Scene::renderPointLightShadows() {
+    Profiler::Scope profileScope(this->window->getProfiler(), "renderPointLightShadows");
+    if (!POINT_LIGHT_SHADOWS || BAKE) {
+        return;
+    }
+    auto cpuStart = std::chrono::high_resolution_clock::now();
+    this->pointShadowFrame++;
+
+    /// 按对屏幕的贡献估计每个点光源的重要性：亮度 * 影响范围在视野中所占的比例，视锥体之外的点光源为0
+    glm::mat4 viewProjection = window->getProjectionMatrix() * window->getViewMatrix();
+    glm::vec4 frustumPlanes[6];
+    for (int i = 0; i < 3; ++i) {
+        glm::vec4 row(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        glm::vec4 rowW(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+        frustumPlanes[i * 2] = rowW + row;
+        frustumPlanes[i * 2 + 1] = rowW - row;
+    }
+    glm::vec3 cameraPosition = window->getCameraPosition();
+    vector<LightClusters::Light> lights(this->pointLights.size());
+    vector<float> importance(this->pointLights.size(), 0.0f);
+    vector<int> candidates;
+    for (size_t i = 0; i < this->pointLights.size(); ++i) {
+        lights[i] = getClusterLight(this->pointLights[i]);
+        const LightClusters::Light& light = lights[i];
+        bool visible = light.range > 0.0f;
+        for (int p = 0; p < 6 && visible; ++p) {
+            visible = glm::dot(glm::vec3(frustumPlanes[p]), light.position) + frustumPlanes[p].w >= -light.range * glm::length(glm::vec3(frustumPlanes[p]));
+        }
+        if (!visible) {
+            continue;
+        }
+        glm::vec3 brightest = glm::max(light.diffuse, light.specular);
+        float coverage = light.range / std::max(glm::length(light.position - cameraPosition), light.range);
+        importance[i] = std::max(brightest.x, std::max(brightest.y, brightest.z)) * coverage * coverage;
+        candidates.push_back((int)i);
+    }
+    size_t shadowedCount = std::min<size_t>(candidates.size(), MAX_SHADOWED_POINT_LIGHTS);
+    std::partial_sort(candidates.begin(), candidates.begin() + shadowedCount, candidates.end(),
+        [&importance](int a, int b) { return importance[a] > importance[b]; });
+    candidates.resize(shadowedCount);
+
+    /// 释放不再是最重要的点光源的槽位，再把空闲槽位分配给新的点光源
+    for (size_t slot = 0; slot < MAX_SHADOWED_POINT_LIGHTS; ++slot) {
+        int lightIndex = this->pointShadowSlotLights[slot];
+        if (lightIndex >= 0 && std::find(candidates.begin(), candidates.end(), lightIndex) == candidates.end()) {
+            this->pointShadowSlotLights[slot] = -1;
+            this->pointShadowSlotValid[slot] = false;
+        }
+    }
+    for (int lightIndex : candidates) {
+        if (std::find(this->pointShadowSlotLights.begin(), this->pointShadowSlotLights.end(), lightIndex) != this->pointShadowSlotLights.end()) {
+            continue;
+        }
+        auto freeSlot = std::find(this->pointShadowSlotLights.begin(), this->pointShadowSlotLights.end(), -1);
+        size_t slot = freeSlot - this->pointShadowSlotLights.begin();
+        this->pointShadowSlotLights[slot] = lightIndex;
+        this->pointShadowSlotValid[slot] = false;
+    }
+
+    /// 选择需要更新的槽位：还没有渲染过的最优先，其次是光源移动了或者影响范围内有动态物体的，按重要性乘以距离上次更新的帧数排序
+    vector<std::pair<float, int>> updates;
+    for (size_t slot = 0; slot < MAX_SHADOWED_POINT_LIGHTS; ++slot) {
+        int lightIndex = this->pointShadowSlotLights[slot];
+        if (lightIndex < 0) {
+            continue;
+        }
+        const LightClusters::Light& light = lights[lightIndex];
+        bool stale = !this->pointShadowSlotValid[slot] || this->pointShadowSlotPositions[slot] != light.position;
+        for (const auto& modelInfo : modelInfos) {
+            if (stale) {
+                break;
+            }
+            if (!modelInfo.transform.isAnimated()) {
+                continue;
+            }
+            glm::vec3 worldMin, worldMax;
+            modelInfo.transform.getWorldBounds(modelInfo.model->boundsMin, modelInfo.model->boundsMax, worldMin, worldMax);
+            glm::vec3 offset = glm::clamp(light.position, worldMin, worldMax) - light.position;
+            stale = glm::dot(offset, offset) <= light.range * light.range;
+        }
+        if (!stale) {
+            continue;
+        }
+        float priority = !this->pointShadowSlotValid[slot] ? std::numeric_limits<float>::max()
+            : importance[lightIndex] * (float)(this->pointShadowFrame - this->pointShadowSlotFrames[slot]);
+        updates.push_back({ priority, (int)slot });
+    }
+    std::sort(updates.begin(), updates.end(), std::greater<std::pair<float, int>>());
+    if (updates.size() > POINT_SHADOW_UPDATES_PER_FRAME) {
+        updates.resize(POINT_SHADOW_UPDATES_PER_FRAME);
+    }
+
+    /// 渲染：每个点光源一次提交，几何着色器把三角形输出到与物体相交的面
+    if (!updates.empty()) {
+        // 立方体每个面的朝向和上方向（与场景着色器中的cubeFaceForward/cubeFaceUp相同）
+        static const glm::vec3 faceForward[6] = { {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1} };
+        static const glm::vec3 faceUp[6] = { {0, -1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}, {0, -1, 0}, {0, -1, 0} };
+        this->pointShadowTimer.begin();
+        glBindFramebuffer(GL_FRAMEBUFFER, this->pointShadowFBO);
+        glViewport(0, 0, POINT_SHADOW_SIZE, POINT_SHADOW_SIZE);
+        this->pointShadowShader.use();
+        for (const auto& update : updates) {
+            int slot = update.second;
+            const LightClusters::Light& light = lights[this->pointShadowSlotLights[slot]];
+            // 清除分层附件会清除所有层，逐层绑定只清除这个槽位的6个面
+            for (int face = 0; face < 6; ++face) {
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->pointShadowArray, 0, slot * 6 + face);
+                glClear(GL_DEPTH_BUFFER_BIT);
+            }
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->pointShadowArray, 0);
+
+            glm::mat4 faceProjection = glm::perspective(glm::radians(90.0f), 1.0f, POINT_SHADOW_NEAR, light.range);
+            glm::vec3 sidePlanes[6][4];
+            for (int face = 0; face < 6; ++face) {
+                this->pointShadowShader.setMat4("faceMatrices[" + std::to_string(face) + "]",
+                    faceProjection * glm::lookAt(light.position, light.position + faceForward[face], faceUp[face]));
+                // 面的视锥体的4个侧面（法线朝内），用来按面剔除物体
+                glm::vec3 side = glm::cross(faceForward[face], faceUp[face]);
+                glm::vec3 up = glm::cross(side, faceForward[face]);
+                sidePlanes[face][0] = faceForward[face] + side;
+                sidePlanes[face][1] = faceForward[face] - side;
+                sidePlanes[face][2] = faceForward[face] + up;
+                sidePlanes[face][3] = faceForward[face] - up;
+            }
+            this->pointShadowShader.setVec3("lightPos", light.position);
+            this->pointShadowShader.setFloat("lightRange", light.range);
+            this->pointShadowShader.setInt("layerOffset", slot * 6);
+            for (const auto& modelInfo : modelInfos) {
+                // 物体的包围盒与影响范围的球不相交时跳过
+                glm::vec3 worldMin, worldMax;
+                modelInfo.transform.getWorldBounds(modelInfo.model->boundsMin, modelInfo.model->boundsMax, worldMin, worldMax);
+                glm::vec3 offset = glm::clamp(light.position, worldMin, worldMax) - light.position;
+                if (glm::dot(offset, offset) > light.range * light.range) {
+                    continue;
+                }
+                // 包围盒的8个顶点都在某个侧面之外时，物体不在这个面的视锥体中
+                int faceMask = 0;
+                for (int face = 0; face < 6; ++face) {
+                    bool inside = true;
+                    for (int p = 0; p < 4 && inside; ++p) {
+                        float maxDistance = std::numeric_limits<float>::lowest();
+                        for (int k = 0; k < 8; ++k) {
+                            glm::vec3 corner((k & 1) ? worldMax.x : worldMin.x, (k & 2) ? worldMax.y : worldMin.y, (k & 4) ? worldMax.z : worldMin.z);
+                            maxDistance = std::max(maxDistance, glm::dot(sidePlanes[face][p], corner - light.position));
+                        }
+                        inside = maxDistance >= 0.0f;
+                    }
+                    faceMask |= inside ? (1 << face) : 0;
+                }
+                if (faceMask == 0) {
+                    continue;
+                }
+                this->pointShadowShader.setInt("faceMask", faceMask);
+                this->pointShadowShader.setMat4("model", modelInfo.transform.getWorldMatrix());
+                modelInfo.model->drawDepth();
+            }
+            this->pointShadowSlotValid[slot] = true;
+            this->pointShadowSlotPositions[slot] = light.position;
+            this->pointShadowSlotFrames[slot] = this->pointShadowFrame;
+        }
+        glBindVertexArray(0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        this->pointShadowTimer.end();
+    }
+    auto cpuEnd = std::chrono::high_resolution_clock::now();
+    this->pointShadowCpuMs += std::chrono::duration<double, std::milli>(cpuEnd - cpuStart).count();
+    this->pointShadowUpdates += updates.size();
+
+    /// 定期输出每帧的点光源阴影更新开销与预算的对比
+    if (++this->pointShadowStatsFrame >= SHADOW_STATS_INTERVAL) {
+        float gpuMsPerFrame = this->pointShadowTimer.getAverageMs() * this->pointShadowTimer.getSampleCount() / this->pointShadowStatsFrame;
+        cout << "[point shadow] " << shadowedCount << " shadowed lights, " << this->pointShadowUpdates << " cube updates in " << this->pointShadowStatsFrame
+            << " frames (budget " << POINT_SHADOW_UPDATES_PER_FRAME << " per frame), gpu " << gpuMsPerFrame << " ms per frame (budget " << POINT_SHADOW_BUDGET_MS << " ms"
+            << (gpuMsPerFrame > POINT_SHADOW_BUDGET_MS ? ", over budget" : "") << "), cpu " << this->pointShadowCpuMs / this->pointShadowStatsFrame << " ms per frame" << endl;
+        this->pointShadowTimer.reset();
+        this->pointShadowCpuMs = 0.0;
+        this->pointShadowUpdates = 0;
+        this->pointShadowStatsFrame = 0;
+    }
+}
+
+void Scene::processInputMoveDirLight(const FrameSnapshot& frame) {
+    if (this->simulationLightDirections.empty()) {
+        return;
+    }
     // 定义方向变化的步长
     float step = 0.01f;
+    // 在主线程修改模拟用的方向，渲染线程通过快照得到
+    glm::vec3& direction = this->simulationLightDirections[0];
 
-    // 监听按键事件
-    if (glfwGetKey(this->window->window, GLFW_KEY_UP) == GLFW_PRESS) {
-        directionalLights[0].direction.y -= step;
+    // 监听按键事件（使用快照中的按键状态，回放录制的输入时也能重现）
+    if (frame.keys.test(GLFW_KEY_UP)) {
+        direction.y -= step;
     }
-    if (glfwGetKey(this->window->window, GLFW_KEY_DOWN) == GLFW_PRESS) {
-        directionalLights[0].direction.y += step;
+    if (frame.keys.test(GLFW_KEY_DOWN)) {
+        direction.y += step;
     }
-    if (glfwGetKey(this->window->window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-        directionalLights[0].direction.z -= step;
+    if (frame.keys.test(GLFW_KEY_LEFT)) {
+        direction.z -= step;
     }
-    if (glfwGetKey(this->window->window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-        directionalLights[0].direction.z += step;
+    if (frame.keys.test(GLFW_KEY_RIGHT)) {
+        direction.z += step;
     }
 
     // 限制y和z坐标的范围
-    if (directionalLights[0].direction.y < -2.0f) {
-        directionalLights[0].direction.y = -2.0f;
+    if (direction.y < -2.0f) {
+        direction.y = -2.0f;
     }
-    if (directionalLights[0].direction.y > 2.0f) {
-        directionalLights[0].direction.y = 2.0f;
+    if (direction.y > 2.0f) {
+        direction.y = 2.0f;
     }
-    if (directionalLights[0].direction.z < -3.0f) {
-        directionalLights[0].direction.z = -3.0f;
+    if (direction.z < -3.0f) {
+        direction.z = -3.0f;
     }
-    if (directionalLights[0].direction.z > 3.0f) {
-        directionalLights[0].direction.z = 3.0f;
+    if (direction.z > 3.0f) {
+        direction.z = 3.0f;
     }
 
     // 监听按键事件
@@ -471,9 +1899,9 @@ void Scene::renderQuad() {
              1.0f,  1.0f, 0.0f,  1.0f, 1.0f, // 右上角
         };
         // 生成VAO
-        glGenVertexArrays(1, &this->quadVAO);
+        this->quadVAO = GpuResources::createVertexArray("fullscreen quad", "Scene");
         // 生成VBO
-        glGenBuffers(1, &this->quadVBO);
+        this->quadVBO = GpuResources::createBuffer("fullscreen quad", "Scene");
         // 将VAO绑定到当前上下文
         glBindVertexArray(this->quadVAO);
         // 将VBO绑定到GL_ARRAY_BUFFER
@@ -496,66 +1924,351 @@ void Scene::renderQuad() {
     // 绘制四边形
     glBindVertexArray(this->quadVAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    RenderStats::recordDraw(2);
     glBindVertexArray(0);
 }
 
-void Scene::setupSceneUniform() {
+void Scene::buildSceneUniformNames(int lightCount, SceneUniformNames& names) {
+    names.directionalLights.resize(std::max(lightCount, 0));
+    for (auto i = 0; i < lightCount; i++) {
+        std::string prefix = "directionalLights[" + std::to_string(i) + "].";
+        DirectionalLightUniformNames& light = names.directionalLights[i];
+        light.direction = prefix + "direction";
+        light.ambient = prefix + "ambient";
+        light.diffuse = prefix + "diffuse";
+        light.specular = prefix + "specular";
+        light.lightColor = prefix + "lightColor";
+        light.lightSpaceMatrices.resize(CASCADE_COUNT);
+        for (unsigned int c = 0; c < CASCADE_COUNT; c++) {
+            light.lightSpaceMatrices[c] = prefix + "lightSpaceMatrices[" + std::to_string(c) + "]";
+        }
+    }
+    names.cascadePlaneDistances.resize(CASCADE_COUNT);
+    for (unsigned int c = 0; c < CASCADE_COUNT; c++) {
+        names.cascadePlaneDistances[c] = "cascadePlaneDistances[" + std::to_string(c) + "]";
+    }
+}
+
+void Scene::setupSceneUniform(Shader& shader) {
+    Profiler::Scope profileScope(this->window->getProfiler(), "setupSceneUniform");
     // -- 场景着色器配置 -- 
-    this->shader.use();
+    shader.use();
     // 传递方向光数量给着色器
-    this->shader.setInt("numDirectionalLights", this->numDirectionalLights);
+    shader.setInt("numDirectionalLights", this->numDirectionalLights);
     // 传递每个方向光的属性给着色器
+    SceneUniformNames names;
+    buildSceneUniformNames(this->numDirectionalLights, names);
     for (auto i = 0; i < this->numDirectionalLights; i++) {
-        std::string number = std::to_string(i);
-        this->shader.setVec3("directionalLights[" + number + "].direction", this->directionalLights[i].direction);
-        this->shader.setVec3("directionalLights[" + number + "].ambient", this->directionalLights[i].ambient);
-        this->shader.setVec3("directionalLights[" + number + "].diffuse", this->directionalLights[i].diffuse);
-        this->shader.setVec3("directionalLights[" + number + "].specular", this->directionalLights[i].specular);
-        this->shader.setVec3("directionalLights[" + number + "].lightColor", this->directionalLights[i].lightColor);
-        // 将阴影矩阵传递给着色器
-        this->shader.setMat4("directionalLights[" + number + "].lightSpaceMatrix", this->directionalLights[i].lightSpaceMatrix);
-    }
-    // 传递点光源数量给着色器
-    this->shader.setInt("numPointLights", pointLights.size());
-    // 传递每个点光源的属性给着色器
-    for (auto i = 0; i < pointLights.size(); i++) {
-        std::string number = std::to_string(i);
-        this->shader.setVec3("pointLights[" + number + "].position", pointLights[i].position);
-        this->shader.setVec3("pointLights[" + number + "].ambient", pointLights[i].ambient);
-        this->shader.setVec3("pointLights[" + number + "].diffuse", pointLights[i].diffuse);
-        this->shader.setVec3("pointLights[" + number + "].specular", pointLights[i].specular);
-        this->shader.setFloat("pointLights[" + number + "].constant", pointLights[i].constant);
-        this->shader.setFloat("pointLights[" + number + "].linear", pointLights[i].linear);
-        this->shader.setFloat("pointLights[" + number + "].quadratic", pointLights[i].quadratic);
-        this->shader.setVec3("pointLights[" + number + "].lightColor", pointLights[i].lightColor);
+        const DirectionalLightUniformNames& light = names.directionalLights[i];
+        shader.setVec3(light.direction, this->directionalLights[i].direction);
+        shader.setVec3(light.ambient, this->directionalLights[i].ambient);
+        shader.setVec3(light.diffuse, this->directionalLights[i].diffuse);
+        shader.setVec3(light.specular, this->directionalLights[i].specular);
+        shader.setVec3(light.lightColor, this->directionalLights[i].lightColor);
+        // 将每个级联的阴影矩阵传递给着色器
+        for (unsigned int c = 0; c < CASCADE_COUNT; c++) {
+            shader.setMat4(light.lightSpaceMatrices[c], this->directionalLights[i].lightSpaceMatrices[c]);
+        }
     }
+    // 传递级联数量和每个级联的远平面距离给着色器
+    shader.setInt("cascadeCount", CASCADE_COUNT);
+    for (unsigned int c = 0; c < CASCADE_COUNT; c++) {
+        shader.setFloat(names.cascadePlaneDistances[c], this->cascadeSplits[c]);
+    }
+    // 传递点光源和簇的数据给着色器（簇的屏幕块按当前视口划分，离屏渲染时也正确）
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    this->lightClusters.bind(shader, CLUSTER_TEXTURE_UNIT, viewport[2], viewport[3]);
+    // 点光源的立方体阴影贴图数组
+    glActiveTexture(GL_TEXTURE0 + POINT_SHADOW_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, this->pointShadowArray);
+    glActiveTexture(GL_TEXTURE0);
+    shader.setInt("pointShadowMaps", POINT_SHADOW_TEXTURE_UNIT);
     // 当按下键1时，切换Blinn-Phong着色模式(将blinn传递给着色器)
-    if (window->blinn) {
-        this->shader.setInt("blinn", 1);
+    if (window->isBlinn()) {
+        shader.setInt("blinn", 1);
     }
     else {
-        this->shader.setInt("blinn", 0);
+        shader.setInt("blinn", 0);
     }
     // 传递投影矩阵和视图矩阵给着色器
-    this->shader.setMat4("projection", window->getProjectionMatrix());
-    this->shader.setMat4("view", window->getViewMatrix());
-    auto camera = window->camera;
+    shader.setMat4("projection", window->getProjectionMatrix());
+    shader.setMat4("view", window->getViewMatrix());
     // 传递摄像机位置给着色器
-    this->shader.setVec3("viewPos", camera.Position);
+    shader.setVec3("viewPos", window->getCameraPosition());
     // 传递光源宽度给着色器
-    this->shader.setFloat("lightWidth", this->lightWidth);
+    shader.setFloat("lightWidth", this->lightWidth);
     // 将PCF采样半径传递给着色器
-    this->shader.setFloat("PCFSampleRadius", this->PCFSampleRadius);
+    shader.setFloat("PCFSampleRadius", this->PCFSampleRadius);
     // 设置阴影映射算法类型
-    this->shader.setInt("shadowMapType", SHADOW_ALGORITHM);
+    shader.setInt("shadowMapType", this->shadowAlgorithm);
+    // 设置硬件PCF的采样点数量、采样图案和滤波半径
+    shader.setInt("pcfTaps", HW_PCF_TAPS);
+    shader.setInt("pcfPattern", HW_PCF_PATTERN);
+    shader.setFloat("hwPCFRadius", HW_PCF_RADIUS);
+    // 设置PCSS分层遮挡物搜索使用的最小/最大深度层级
+    glActiveTexture(GL_TEXTURE0 + SHADOW_MIN_MAX_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, this->shadowMinMaxArray);
+    glActiveTexture(GL_TEXTURE0);
+    shader.setInt("shadowMinMaxArray", SHADOW_MIN_MAX_TEXTURE_UNIT);
+    shader.setInt("shadowMinMaxLevels", this->shadowMinMaxLevels);
+    shader.setBool("pcssHierarchical", this->pcssHierarchical);
+    // 设置VSM的EVSM指数和最小方差（16位浮点的矩精度较低，需要更大的最小方差避免数值误差造成的噪点）
+    shader.setFloat("vsmExponent", getVSMExponent());
+    shader.setFloat("vsmMinVariance", VSM_16BIT_MOMENTS ? 1e-4f : 1e-6f);
+    // 设置ESM的指数和MSM的矩偏移量
+    shader.setFloat("esmExponent", getESMExponent());
+    shader.setFloat("msmMomentBias", VSM_16BIT_MOMENTS ? MSM_MOMENT_BIAS_16BIT : MSM_MOMENT_BIAS_32BIT);
+    shader.setBool("msmQuantized", VSM_16BIT_MOMENTS);
     // 将近平面和远平面传递给着色器
-    this->shader.setFloat("near_plane", NEAR_PLANE);
-    this->shader.setFloat("far_plane", FAR_PLANE);
+    shader.setFloat("near_plane", NEAR_PLANE);
+    shader.setFloat("far_plane", FAR_PLANE);
+}
+
+vector<string> Scene::getLightingShaderDefines() {
+    vector<string> defines = {
+        "SHADOW_ALGORITHM " + std::to_string(this->shadowAlgorithm),
+        "PCF_TAP_COUNT " + std::to_string(HW_PCF_TAPS),
+        "PCF_PATTERN " + std::to_string(HW_PCF_PATTERN),
+        "NUM_DIRECTIONAL_LIGHTS " + std::to_string(this->numDirectionalLights),
+        std::string("PCSS_HIERARCHICAL ") + (this->pcssHierarchical ? "1" : "0"),
+    };
+    // 统计采样次数的变体只在对比时使用
+    if (this->outputFetchCount) {
+        defines.push_back("OUTPUT_FETCH_COUNT 1");
+    }
+    return defines;
+}
+
+vector<string> Scene::getSceneShaderDefines(const Mesh& mesh) {
+    vector<string> defines = getLightingShaderDefines();
+    defines.push_back(std::string("HAS_NORMAL_MAP ") + (mesh.hasNormalMap ? "1" : "0"));
+    defines.push_back(std::string("HAS_SPECULAR_MAP ") + (mesh.hasSpecularMap ? "1" : "0"));
+    defines.push_back(std::string("USE_LIGHT_MAP ") + (BAKE ? "1" : "0"));
+    return defines;
+}
+
+void Scene::renderScenePermutations() {
+    Profiler::Scope profileScope(this->window->getProfiler(), "renderScenePermutations");
+    // 本帧已经设置过场景uniform的变体（uniform属于程序对象，每个变体都需要设置一次）
+    std::set<unsigned int> preparedVariants;
+    for (const auto& modelInfo : modelInfos) {
+        for (auto& mesh : modelInfo.model->meshes) {
+            Shader& variant = this->sceneShaders.get(getSceneShaderDefines(mesh));
+            variant.use();
+            if (preparedVariants.insert(variant.ID).second) {
+                setupSceneUniform(variant);
+            }
+            // 传递模型矩阵和法线矩阵给着色器（已在updateTransforms中缓存）
+            variant.setMat4("model", modelInfo.transform.getWorldMatrix());
+            variant.setMat3("normalMatrix", modelInfo.transform.getNormalMatrix());
+            mesh.draw(variant, this->directionLightDepthMapArray, this->shadowCompareSampler, true, getShadowMomentsArray(), usesShadowMoments(), BAKE, lightMap);
+        }
+    }
+}
+
+void Scene::getGBufferDescs(int width, int height, FrameGraphTextureDesc descs[4]) const {
+    // 漫反射颜色、镜面反射颜色、法线和光泽度（光泽度可能大于1，法线需要符号，使用浮点格式）、深度（光照pass从深度重建位置）
+    GLenum formats[4] = { GL_RGBA8, GL_RGBA8, GL_RGBA16F, GL_DEPTH_COMPONENT24 };
+    for (int i = 0; i < 4; ++i) {
+        descs[i] = FrameGraphTextureDesc();
+        descs[i].width = width;
+        descs[i].height = height;
+        descs[i].internalFormat = formats[i];
+    }
+}
+
+void Scene::attachGBuffer(const unsigned int textures[4], int width, int height) {
+    if (this->gBufferFBO == 0) {
+        this->gBufferFBO = GpuResources::createFramebuffer("G-buffer", "Scene");
+        glBindFramebuffer(GL_FRAMEBUFFER, this->gBufferFBO);
+        GLenum drawBuffers[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+        glDrawBuffers(3, drawBuffers);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, this->gBufferFBO);
+    for (int i = 0; i < 3; ++i) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, textures[i], 0);
+    }
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[3], 0);
+    // 池通常每帧返回同样的纹理，只在绑定的纹理改变时检查完整性
+    if (textures[0] != this->gAlbedo || textures[1] != this->gSpecular || textures[2] != this->gNormalShininess || textures[3] != this->gDepth) {
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+        }
+        this->gAlbedo = textures[0];
+        this->gSpecular = textures[1];
+        this->gNormalShininess = textures[2];
+        this->gDepth = textures[3];
+    }
+    this->gBufferWidth = width;
+    this->gBufferHeight = height;
+}
+
+void Scene::renderDeferredPass() {
+    Profiler::Scope profileScope(this->window->getProfiler(), "renderDeferredPass");
+    // 光照pass输出到调用者绑定的帧缓冲和视口（对比时的离屏帧缓冲）
+    GLint targetFBO = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFBO);
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    // 与目标视口一样大的G-buffer，重复调用时池返回同样的纹理
+    FrameGraphTextureDesc descs[4];
+    getGBufferDescs(viewport[2], viewport[3], descs);
+    unsigned int textures[4];
+    for (int i = 0; i < 4; ++i) {
+        textures[i] = this->renderTargetPool.acquire(descs[i], "G-buffer");
+    }
+    attachGBuffer(textures, viewport[2], viewport[3]);
+    renderGBufferPass(viewport[2], viewport[3]);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    renderDeferredLighting();
+    for (int i = 0; i < 4; ++i) {
+        this->renderTargetPool.release(textures[i]);
+    }
+}
+
+void Scene::renderGBufferPass(int width, int height) {
+    Profiler::Scope profileScope(this->window->getProfiler(), "renderGBufferPass");
+    // 只使用G-buffer的左下角区域（动态分辨率时渲染分辨率小于G-buffer）
+    glBindFramebuffer(GL_FRAMEBUFFER, this->gBufferFBO);
+    glViewport(0, 0, width, height);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glm::mat4 projection = window->getProjectionMatrix();
+    glm::mat4 view = window->getViewMatrix();
+    std::set<unsigned int> preparedVariants;
+    for (const auto& modelInfo : modelInfos) {
+        for (auto& mesh : modelInfo.model->meshes) {
+            vector<string> defines = {
+                std::string("HAS_NORMAL_MAP ") + (mesh.hasNormalMap ? "1" : "0"),
+                std::string("HAS_SPECULAR_MAP ") + (mesh.hasSpecularMap ? "1" : "0"),
+            };
+            Shader& variant = this->gBufferShaders.get(defines);
+            variant.use();
+            if (preparedVariants.insert(variant.ID).second) {
+                variant.setMat4("projection", projection);
+                variant.setMat4("view", view);
+            }
+            variant.setMat4("model", modelInfo.transform.getWorldMatrix());
+            variant.setMat3("normalMatrix", modelInfo.transform.getNormalMatrix());
+            mesh.draw(variant, this->directionLightDepthMapArray, this->shadowCompareSampler, true, getShadowMomentsArray(), usesShadowMoments(), false, lightMap);
+        }
+    }
+}
+
+void Scene::renderDeferredLighting() {
+    Profiler::Scope profileScope(this->window->getProfiler(), "renderDeferredLighting");
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glm::mat4 projection = window->getProjectionMatrix();
+    glm::mat4 view = window->getViewMatrix();
+    vector<string> defines = USE_SHADER_PERMUTATIONS ? getLightingShaderDefines() : vector<string>();
+    defines.push_back("DEFERRED_LIGHTING 1");
+    Shader& lighting = this->deferredLightingShaders.get(defines);
+    setupSceneUniform(lighting);
+    lighting.setMat4("inverseViewProjection", glm::inverse(projection * view));
+    lighting.setVec2("gBufferUVScale", glm::vec2((float)viewport[2] / (float)this->gBufferWidth, (float)viewport[3] / (float)this->gBufferHeight));
+    // G-buffer占用0~3号纹理单元
+    unsigned int gBufferTextures[4] = { this->gAlbedo, this->gSpecular, this->gNormalShininess, this->gDepth };
+    const char* gBufferNames[4] = { "gAlbedo", "gSpecular", "gNormalShininess", "gDepth" };
+    for (int i = 0; i < 4; ++i) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, gBufferTextures[i]);
+        lighting.setInt(gBufferNames[i], i);
+    }
+    // 阴影贴图数组（或者矩贴图数组）使用4号纹理单元，硬件比较的阴影贴图使用5号纹理单元，与Mesh::draw中的绑定方式相同
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, usesShadowMoments() ? getShadowMomentsArray() : this->directionLightDepthMapArray);
+    lighting.setInt("shadowMapArray", 4);
+    lighting.setInt("d_d2_filterArray", 4);
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, this->directionLightDepthMapArray);
+    glBindSampler(5, this->shadowCompareSampler);
+    lighting.setInt("shadowMapArrayCompare", 5);
+    if (OVERDRAW_STATS) {
+        this->shadedFragmentCounter.begin();
+    }
+    renderQuad();
+    if (OVERDRAW_STATS) {
+        this->shadedFragmentCounter.end();
+    }
+    glBindSampler(5, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void Scene::createShadowMinMaxPyramid() {
+    // 第0级是阴影贴图的一半分辨率，一直到1x1，层的排列与深度贴图数组相同
+    int layers = std::max(this->numDirectionalLights, 1) * CASCADE_COUNT;
+    this->shadowMinMaxFBO = GpuResources::createFramebuffer("shadow min/max", "Scene");
+    this->shadowMinMaxArray = GpuResources::createTexture(GL_TEXTURE_2D_ARRAY, "shadow min/max depth", "Scene");
+    glBindTexture(GL_TEXTURE_2D_ARRAY, this->shadowMinMaxArray);
+    int levelWidth = std::max((int)this->shadowWidth / 2, 1);
+    int levelHeight = std::max((int)this->shadowHeight / 2, 1);
+    this->shadowMinMaxLevels = 0;
+    while (true) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, this->shadowMinMaxLevels, GL_RG32F, levelWidth, levelHeight, layers, 0, GL_RG, GL_FLOAT, NULL);
+        this->shadowMinMaxLevels++;
+        if (levelWidth == 1 && levelHeight == 1) {
+            break;
+        }
+        levelWidth = std::max(levelWidth / 2, 1);
+        levelHeight = std::max(levelHeight / 2, 1);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, this->shadowMinMaxLevels - 1);
+}
+
+void Scene::buildShadowMinMaxPyramid() {
+    Profiler::Scope profileScope(this->window->getProfiler(), "buildShadowMinMaxPyramid");
+    if (this->shadowMinMaxArray == 0) {
+        createShadowMinMaxPyramid();
+    }
+    this->shadowMinMaxTimer.begin();
+    int layers = this->numDirectionalLights * CASCADE_COUNT;
+    glBindFramebuffer(GL_FRAMEBUFFER, this->shadowMinMaxFBO);
+    this->minMaxDepthShader.use();
+    this->minMaxDepthShader.setInt("sourceMap", 0);
+    glActiveTexture(GL_TEXTURE0);
+    int levelWidth = std::max((int)this->shadowWidth / 2, 1);
+    int levelHeight = std::max((int)this->shadowHeight / 2, 1);
+    for (int level = 0; level < this->shadowMinMaxLevels; ++level) {
+        if (level == 0) {
+            // 第0级从深度贴图数组构建
+            glBindTexture(GL_TEXTURE_2D_ARRAY, this->directionLightDepthMapArray);
+        }
+        else {
+            // 其他级从上一级构建，把可采样的级别限制为上一级，避免读写同一个纹理形成反馈回路
+            glBindTexture(GL_TEXTURE_2D_ARRAY, this->shadowMinMaxArray);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, level - 1);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, level - 1);
+        }
+        this->minMaxDepthShader.setBool("fromDepth", level == 0);
+        glViewport(0, 0, levelWidth, levelHeight);
+        for (int layer = 0; layer < layers; ++layer) {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, this->shadowMinMaxArray, level, layer);
+            this->minMaxDepthShader.setInt("layer", layer);
+            renderQuad();
+        }
+        levelWidth = std::max(levelWidth / 2, 1);
+        levelHeight = std::max(levelHeight / 2, 1);
+    }
+    // 恢复所有级别可采样
+    glBindTexture(GL_TEXTURE_2D_ARRAY, this->shadowMinMaxArray);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, this->shadowMinMaxLevels - 1);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    this->shadowMinMaxTimer.end();
+    this->shadowMinMaxValid = true;
 }
 
 void Scene::loadLightMap() {
     // 生成光照贴图
-    glGenTextures(1, &this->lightMap);
+    this->lightMap = GpuResources::createTexture(GL_TEXTURE_2D, "light map", "Scene");
     // 绑定光照贴图
     glBindTexture(GL_TEXTURE_2D, this->lightMap);
     // 设置光照贴图环绕和过滤方式
@@ -599,6 +2312,13 @@ int Scene::bakeLightMap() {
         LM_FLOAT, (unsigned char*)(vertices.data()) + offsetof(vertex_t, t), sizeof(vertex_t),
         indices.size(), LM_UNSIGNED_SHORT, indices.data());
 
+    // 烘焙使用通用场景着色器，先设置光源等uniform变量（视图和投影矩阵在每次迭代中覆盖）
+    this->shader.use();
+    this->shader.setBool("useLightMap", true);
+    setupSceneUniform(this->shader);
+    // 簇是按摄像机视锥体划分的，烘焙时的视角不同，不计算点光源
+    this->shader.setInt("numPointLights", 0);
+
     int vp[4];
     float view[16], projection[16];
     double lastUpdateTime = 0.0;
@@ -630,16 +2350,16 @@ int Scene::bakeLightMap() {
     // 销毁光照贴图上下文
     lmDestroy(ctx);
 
-    // 后处理纹理
+    // 后处理纹理（按行分块交给作业系统，结果与lmImageDilate/lmImageSmooth相同）
     float* temp = (float*)calloc(LIGHT_MAP_WIDTH * LIGHT_MAP_HEIGHT * 4, sizeof(float));
     for (int i = 0; i < 16; i++) {
-        lmImageDilate(data, temp, LIGHT_MAP_WIDTH, LIGHT_MAP_HEIGHT, 4);
-        lmImageDilate(temp, data, LIGHT_MAP_WIDTH, LIGHT_MAP_HEIGHT, 4);
+        parallelImageDilate(this->jobSystem, data, temp, LIGHT_MAP_WIDTH, LIGHT_MAP_HEIGHT, 4);
+        parallelImageDilate(this->jobSystem, temp, data, LIGHT_MAP_WIDTH, LIGHT_MAP_HEIGHT, 4);
     }
-    lmImageSmooth(data, temp, LIGHT_MAP_WIDTH, LIGHT_MAP_HEIGHT, 4);
-    lmImageSmooth(data, temp, LIGHT_MAP_WIDTH, LIGHT_MAP_HEIGHT, 4);
+    parallelImageSmooth(this->jobSystem, data, temp, LIGHT_MAP_WIDTH, LIGHT_MAP_HEIGHT, 4);
+    parallelImageSmooth(this->jobSystem, data, temp, LIGHT_MAP_WIDTH, LIGHT_MAP_HEIGHT, 4);
 
-    lmImageDilate(temp, data, LIGHT_MAP_WIDTH, LIGHT_MAP_HEIGHT, 4);
+    parallelImageDilate(this->jobSystem, temp, data, LIGHT_MAP_WIDTH, LIGHT_MAP_HEIGHT, 4);
     lmImagePower(data, LIGHT_MAP_WIDTH, LIGHT_MAP_HEIGHT, 4, 1.0f / 2.2f, 0x7); // 伽马矫正颜色通道
     free(temp);
 
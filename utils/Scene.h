@@ -15,6 +15,15 @@
 
 #include "windowFactory.h"
 #include "model.h"
+#include "Transform.h"
+#include "GpuTimer.h"
+#include "GLUtils.h"
+#include "ShaderPermutations.h"
+#include "LightClusters.h"
+#include "DynamicResolution.h"
+#include "JobSystem.h"
+#include "GpuResources.h"
+#include "FrameGraph.h"
 
 
 using std::vector;
@@ -42,8 +51,8 @@ class Scene {
         glm::vec3 specular;
         // 光的颜色
         glm::vec3 lightColor;
-        // 光空间矩阵
-        glm::mat4 lightSpaceMatrix;
+        // 每个级联的光空间矩阵
+        vector<glm::mat4> lightSpaceMatrices;
     };
     struct PointLight {
         std::string path;
@@ -57,99 +66,428 @@ class Scene {
         float constant;
         float linear;
         float quadratic;
+        // 绕场景中心的y轴旋转的角速度（度/秒），压力测试场景使用
+        float orbitSpeed = 0.0f;
+    };
+    /// 渲染时选择哪些物体
+    enum class RenderFilter {
+        // 所有物体
+        All,
+        // 只渲染静态物体
+        Static,
+        // 只渲染动态（带动画的）物体
+        Dynamic
     };
     struct ModelInfo {
-        glm::vec3 position;
-        glm::vec3 rotation;
-        glm::vec3 scale;
+        // 变换组件（位置、旋转、缩放以及缓存的矩阵）
+        Transform transform;
         std::string path;
         Model* model = nullptr;
         Material material;
     };
 public:
+    // 一个定向光在场景着色器中的uniform名称
+    struct DirectionalLightUniformNames {
+        std::string direction;
+        std::string ambient;
+        std::string diffuse;
+        std::string specular;
+        std::string lightColor;
+        // 每个级联的光源空间矩阵
+        vector<std::string> lightSpaceMatrices;
+    };
+    // setupSceneUniform按名称设置的数组元素uniform
+    struct SceneUniformNames {
+        vector<DirectionalLightUniformNames> directionalLights;
+        // 每个级联的远平面距离
+        vector<std::string> cascadePlaneDistances;
+    };
     // 定向光数组
     vector<DirectionalLight> directionalLights;
 
     /// @brief 构造函数，初始化窗口和加载配置文件
     /// @param window  opengl窗口
-    Scene(GLFWWindowFactory* window);
+    /// @param sceneFile 场景配置文件
+    Scene(GLFWWindowFactory* window, const std::string& sceneFile = "config/scene.yaml");
 
-    /// @brief 绘制函数，用于渲染场景
+    /// @brief 模拟函数（主线程）：处理移动光源的输入，更新模型变换，把结果写入本帧的快照
+    /// @param frame 本帧的快照
+    void simulate(FrameSnapshot& frame);
+
+    /// @brief 绘制函数，用于渲染场景（拥有上下文的线程，只读取当前快照和渲染状态）
     void draw();
 
+    /// @brief 加载场景配置文件（只解析配置，不加载模型，基准测试也会单独调用）
+    /// @param fileName 文件名
+    /// @return 模型信息
+    static vector<ModelInfo> loadScene(const std::string& fileName);
+
+    /// @brief 拼接setupSceneUniform使用的定向光和级联的uniform名称（不访问OpenGL，微基准测试也会单独调用）
+    /// @param lightCount 定向光数量
+    /// @param names 输出的名称
+    static void buildSceneUniformNames(int lightCount, SceneUniformNames& names);
+
+    /// @brief 固定渲染分辨率的缩放比例，不再由动态分辨率控制（基准测试需要可重复的结果）
+    /// @param scale 缩放比例，0表示恢复动态分辨率
+    void setFixedResolutionScale(float scale);
+
+    /// @brief 运行一项对比测试（每项连续渲染数百帧，只由离屏基准测试的--compare参数调用，实现在SceneBenchmarks.cpp）
+    /// @param name 对比测试的名称
+    /// @return 没有这个对比测试时输出所有名称并返回false
+    bool runComparison(const std::string& name);
+
+    /// @brief 释放模型和所有渲染目标（拥有上下文的线程，在上下文销毁之前调用）
+    void release();
+
     ~Scene();
 private:
-    // 屏幕的宽度和
-    static const unsigned int SCR_WIDTH = 800;
-    // 屏幕的高度
-    static const unsigned int SCR_HEIGHT = 600;
-    // 阴影贴图的宽度
-    static const unsigned int SHADOW_WIDTH = 1024;
-    // 阴影贴图的高度
-    static const unsigned int SHADOW_HEIGHT = 1024;
-    // 阴影贴图能够覆盖的最近距离
+    // 作业系统，需要在分簇光照之前构造
+    JobSystem jobSystem;
+    // 每个级联阴影贴图的宽度
+    static const unsigned int SHADOW_WIDTH = 512;
+    // 每个级联阴影贴图的高度
+    static const unsigned int SHADOW_HEIGHT = 512;
+    // 级联数量（不能超过着色器中的MAX_CASCADES）
+    static const unsigned int CASCADE_COUNT = 3;
+    // 级联分割方式：0为均匀分割，1为对数分割，中间值为两者的混合（practical split scheme）
+    static constexpr float CASCADE_SPLIT_LAMBDA = 0.8f;
+    // 阴影能够覆盖的最远距离（视空间），实际距离还会被场景包围盒裁剪
+    static constexpr float SHADOW_DISTANCE = 150.0f;
+    // 阴影贴图能够覆盖的最近距离（PCSS使用）
     static constexpr float NEAR_PLANE = 2.0f;
-    // 阴影贴图能够覆盖的最远距离
+    // 阴影贴图能够覆盖的最远距离（PCSS使用）
     static constexpr float FAR_PLANE = 120.0f;
     // 光源宽度，影响阴影的柔和度，较大的光源宽度会导致阴影边缘更加柔和
     static constexpr float lightWidth = 0.132f;
     // PCF采样半径
     static constexpr float PCFSampleRadius = 0.588f;
-    // 阴影算法类型
+    // 初始阴影算法类型（运行时按F2切换）
     // 0: SM
     // 1: PCF
     // 2: PCSS
     // 3: VSM
+    // 4: 硬件比较PCF（sampler2DArrayShadow + 泊松圆盘/旋转网格采样）
+    // 5: ESM
+    // 6: MSM（4个矩，Hamburger 4MSM）
     static const unsigned int SHADOW_ALGORITHM = 1;
+    // 阴影算法数量
+    static const unsigned int SHADOW_ALGORITHM_COUNT = 7;
+    // 阴影算法名称，下标与阴影算法类型对应
+    static constexpr const char* SHADOW_ALGORITHM_NAMES[SHADOW_ALGORITHM_COUNT] = { "SM", "PCF", "PCSS", "VSM", "PCF (hardware)", "ESM", "MSM" };
+    // 硬件PCF的采样点数量（8~32）
+    static const unsigned int HW_PCF_TAPS = 16;
+    // 硬件PCF的采样图案：0为泊松圆盘（每个像素随机旋转），1为旋转网格
+    static const unsigned int HW_PCF_PATTERN = 0;
+    // 硬件PCF的滤波半径（纹素），默认与PCF的13x13邻域覆盖的范围相当
+    static constexpr float HW_PCF_RADIUS = 6.5f;
+    // VSM/ESM/MSM的矩是否使用16位格式，false时使用32位浮点
+    // VSM为GL_RG16F，ESM为GL_R16F，MSM为经过优化量化的GL_RGBA16（16位浮点的精度不足以存储4个矩）
+    static const bool VSM_16BIT_MOMENTS = true;
+    // VSM是否存储指数变换后的深度的矩（EVSM，减少漏光），指数会被限制在矩的格式能表示的范围内
+    static const bool VSM_EXPONENTIAL = false;
+    // EVSM的指数（16位浮点时最大约5.5，32位浮点时最大约42）
+    static constexpr float EVSM_EXPONENT = 5.0f;
+    // ESM的指数，越大漏光越少但是越容易溢出（会被限制在格式能表示的范围内，16位浮点时最大约11，32位浮点时最大约88）
+    static constexpr float ESM_EXPONENT = 40.0f;
+    // MSM的矩偏移量（16位定点数/32位浮点），越大越稳定但是漏光越多
+    static constexpr float MSM_MOMENT_BIAS_16BIT = 6e-5f;
+    static constexpr float MSM_MOMENT_BIAS_32BIT = 3e-6f;
+    // VSM的矩的初始过滤方式（运行时按F6切换）：true为硬件mipmap+各向异性过滤，false为两次11个采样点的盒式模糊
+    static const bool VSM_MIPMAP_FILTER = true;
+    // mipmap过滤时采样的最小mip级别，决定最小的滤波范围（1约等于2x2纹素的平均）
+    static constexpr float VSM_MIN_FILTER_LOD = 1.0f;
+    // mipmap过滤时的最大各向异性（不支持各向异性过滤时忽略）
+    static constexpr float VSM_MAX_ANISOTROPY = 8.0f;
+    // PCSS是否使用最小/最大深度层级做分层遮挡物搜索，并按半影大小自适应缩小滤波核
+    static const bool PCSS_HIERARCHICAL = true;
+    // 最小/最大深度层级使用的纹理单元（固定使用最后一个保证可用的纹理单元，不与网格的纹理冲突）
+    static const unsigned int SHADOW_MIN_MAX_TEXTURE_UNIT = 15;
+    // 场景着色器是否使用特化变体（按阴影算法、光源数量、材质贴图和光照贴图编译），false时使用运行时分支的通用着色器
+    static const bool USE_SHADER_PERMUTATIONS = true;
+    // 是否使用延迟渲染（G-buffer + 全屏光照pass，阴影每个可见像素只计算一次），运行时按F8切换；烘焙光照贴图时总是使用前向渲染
+    static const bool DEFERRED_SHADING = false;
+    // 分簇光照：视锥体在屏幕x、y方向和深度方向（按指数划分）上的簇数量
+    static const unsigned int CLUSTER_X = 16;
+    static const unsigned int CLUSTER_Y = 9;
+    static const unsigned int CLUSTER_Z = 24;
+    // 每个簇最多的点光源数量
+    static const unsigned int MAX_LIGHTS_PER_CLUSTER = 256;
+    // 作业系统的工作线程数（加载、模型变换、分簇和光照贴图后处理使用），0为硬件线程数减一
+    static const int JOB_WORKER_COUNT = 0;
+    // 按3录制的帧数（导出为profile_trace.json）
+    static const unsigned int PROFILE_CAPTURE_FRAMES = 120;
+    // 并行更新模型变换时每个作业最少的模型数量
+    static const size_t TRANSFORM_GRAIN_SIZE = 16;
+    // 点光源的影响范围：光照强度衰减到这个值以下的距离
+    static constexpr float POINT_LIGHT_CUTOFF = 1.0f / 256.0f;
+    // 是否默认使用点光源压力测试场景（代替pointLights.yaml中的点光源），运行时按F10切换
+    static const bool POINT_LIGHT_STRESS_TEST = false;
+    // 压力测试场景的点光源数量
+    static const unsigned int STRESS_POINT_LIGHT_COUNT = 1000;
+    // 分簇光照使用的第一个纹理单元（占用3个，位于最小/最大深度层级的纹理单元之前）
+    static const unsigned int CLUSTER_TEXTURE_UNIT = 12;
+    // 是否使用动态分辨率：场景渲染到内部渲染目标，渲染分辨率按GPU帧时间自动调整，再放大到窗口
+    static const bool DYNAMIC_RESOLUTION = true;
+    // GPU帧时间预算（ms），动态分辨率按这个预算调整渲染分辨率
+    static constexpr float FRAME_TIME_BUDGET_MS = 16.0f;
+    // 渲染分辨率缩放的范围（每个方向）
+    static constexpr float MIN_RESOLUTION_SCALE = 0.5f;
+    static constexpr float MAX_RESOLUTION_SCALE = 1.0f;
+    // 放大到窗口时的锐化强度，0为只做双线性过滤
+    static constexpr float UPSCALE_SHARPNESS = 0.5f;
+    // 是否在渲染分辨率较低时把阴影贴图的分辨率也减半（缩放低于0.6时减半，高于0.85时恢复）
+    static const bool DYNAMIC_SHADOW_RESOLUTION = false;
+    // 临时渲染目标（帧图的纹理池）连续多少帧没有使用时删除
+    static const unsigned int TRANSIENT_TARGET_IDLE_FRAMES = 120;
+    // 前向渲染时是否先用只包含位置的顶点数据渲染一遍深度，主pass使用GL_EQUAL且不写深度，每个像素只着色一次，运行时按F11切换
+    static const bool DEPTH_PREPASS = true;
+    // 是否统计主pass着色的片段数量和有几何体覆盖的像素数量（每帧多一次全屏的遮挡查询pass，只用于诊断，默认关闭）
+    static const bool OVERDRAW_STATS = false;
+    // 是否为点光源渲染立方体阴影贴图
+    static const bool POINT_LIGHT_SHADOWS = true;
+    // 最多有阴影的点光源数量（按对屏幕的贡献选择最重要的点光源）
+    static const unsigned int MAX_SHADOWED_POINT_LIGHTS = 4;
+    // 每帧最多更新的点光源阴影数量（全局预算），其他点光源复用缓存的面
+    static const unsigned int POINT_SHADOW_UPDATES_PER_FRAME = 2;
+    // 每帧点光源阴影更新的GPU时间预算（ms），统计输出时与实际耗时对比
+    static constexpr float POINT_SHADOW_BUDGET_MS = 1.0f;
+    // 点光源立方体阴影贴图每个面的分辨率
+    static const unsigned int POINT_SHADOW_SIZE = 256;
+    // 点光源立方体阴影贴图的近平面
+    static constexpr float POINT_SHADOW_NEAR = 0.05f;
+    // 点光源立方体阴影贴图使用的纹理单元
+    static const unsigned int POINT_SHADOW_TEXTURE_UNIT = 11;
+    // 是否缓存静态物体的阴影贴图：只在光源或静态物体变化时重新渲染静态物体，每帧只渲染动态物体
+    static const bool SHADOW_CACHE = true;
+    // 是否在一次几何提交中渲染所有定向光的所有级联（实例化分层渲染），false时逐个光源逐个级联渲染
+    static const bool SHADOW_SINGLE_PASS = true;
+    // 分层阴影着色器支持的最大层数（与layeredShadowShader中的MAX_SHADOW_LAYERS保持一致）
+    static const unsigned int MAX_SHADOW_LAYERS = 16;
+    // 阴影更新开销的统计输出间隔（帧）
+    static const unsigned int SHADOW_STATS_INTERVAL = 300;
     // 光照贴图的宽度
     unsigned int LIGHT_MAP_WIDTH = 1024;
     // 光照贴图的高度
     unsigned int LIGHT_MAP_HEIGHT = 1024;
     // 是否使用光线烘焙
-    const bool BAKE = false;
+    static const bool BAKE = false;
 
 
-    // 场景渲染着色器
+    // 场景渲染着色器（通用版本，所有特性都是运行时分支）
     Shader shader;
-    // 方向光阴影渲染着色器
+    // 场景渲染着色器的特化变体
+    ShaderPermutations sceneShaders;
+    // 是否使用延迟渲染
+    bool deferredShading = DEFERRED_SHADING;
+    // 延迟渲染几何pass的着色器变体（按法线/镜面光贴图特化）
+    ShaderPermutations gBufferShaders;
+    // 延迟渲染光照pass的着色器变体（场景着色器定义DEFERRED_LIGHTING，按阴影算法和光源数量特化）
+    ShaderPermutations deferredLightingShaders;
+    // G-buffer帧缓冲对象
+    unsigned int gBufferFBO = 0;
+    // G-buffer：漫反射颜色（RGBA8）、镜面反射颜色（RGBA8）、世界空间法线和反射光泽度（RGBA16F）、深度
+    // 纹理是从临时渲染目标池中取出的，这里只记录当前绑定到G-buffer帧缓冲的纹理
+    unsigned int gAlbedo = 0;
+    unsigned int gSpecular = 0;
+    unsigned int gNormalShininess = 0;
+    unsigned int gDepth = 0;
+    // G-buffer的分辨率
+    int gBufferWidth = 0;
+    int gBufferHeight = 0;
+    // 当前使用的阴影算法
+    unsigned int shadowAlgorithm = SHADOW_ALGORITHM;
+    // 方向光阴影渲染着色器（VSM，输出深度的均值和方差）
     Shader directionLightShadowShader;
+    // 只写深度的阴影渲染着色器（SM/PCF/PCSS）
+    Shader depthOnlyShader;
+    // 分层阴影渲染着色器，一次提交渲染阴影贴图数组的所有层
+    Shader layeredShadowShader;
+    // 顶点着色器能否直接写gl_Layer，不能时分层阴影着色器使用几何着色器
+    bool vertexShaderLayer = false;
+    // 是否使用单次提交渲染阴影（SHADOW_SINGLE_PASS开启且层数不超过MAX_SHADOW_LAYERS）
+    bool shadowSinglePass = false;
     // 均值和方差计算着色器
     Shader d_d2_filter_shader;
+    // 最小/最大深度层级构建着色器
+    Shader minMaxDepthShader;
     // 光照贴图着色器
     Shader lightMapShader;
 
     GLFWWindowFactory* window;
     // 定向光帧缓冲对象
-    vector<unsigned int> directionLightDepthMapFBOs;
-    // 定向光深度贴图
-    vector<unsigned int> directionLightDepthMaps;
-    // 定向光深度的方差和均值贴图
-    vector<unsigned int> directionLightDepthMeanVarMaps;
-    vector<unsigned int> d_d2_filter_FBO;
-    vector<unsigned int> d_d2_filter_maps;
+    unsigned int directionLightDepthMapFBO = 0;
+    // 所有定向光共用的深度贴图数组，第i个定向光的第c个级联位于第i*CASCADE_COUNT+c层
+    unsigned int directionLightDepthMapArray = 0;
+    // 定向光深度的方差和均值贴图数组（VSM），层的排列与深度贴图数组相同
+    unsigned int directionLightDepthMeanVarArray = 0;
+    // 深度比较采样器对象（GL_COMPARE_REF_TO_TEXTURE + 线性过滤），与深度贴图数组一起绑定给硬件PCF使用
+    unsigned int shadowCompareSampler = 0;
+    // 阴影贴图的最小/最大深度层级（PCSS分层遮挡物搜索使用），第0级是阴影贴图的一半分辨率
+    unsigned int shadowMinMaxFBO = 0;
+    unsigned int shadowMinMaxArray = 0;
+    // 最小/最大深度层级的级数
+    int shadowMinMaxLevels = 0;
+    // 最小/最大深度层级是否与阴影贴图一致
+    bool shadowMinMaxValid = false;
+    // 本帧阴影贴图是否有更新
+    bool shadowMapsUpdated = false;
+    // PCSS是否使用分层遮挡物搜索
+    bool pcssHierarchical = PCSS_HIERARCHICAL;
+    // 场景着色器变体是否输出PCSS的采样次数（统计用）
+    bool outputFetchCount = false;
+    // 构建最小/最大深度层级的GPU耗时
+    GpuTimer shadowMinMaxTimer;
+    // VSM的矩是否使用mipmap过滤（false时使用两次模糊）
+    bool vsmMipmapFilter = VSM_MIPMAP_FILTER;
+    // VSM的矩的过滤（生成mipmap或者两次模糊）的GPU耗时
+    GpuTimer vsmFilterTimer;
+    // 本帧有更新的阴影贴图层
+    vector<int> updatedShadowLayers;
+    // 两次模糊的帧缓冲对象（VSM，只在模糊过滤时创建）
+    unsigned int d_d2_filter_FBO[2] = { 0, 0 };
+    // 第二次模糊的结果，跨帧保留（只有更新的层重新过滤）；第一次模糊的结果是临时渲染目标
+    unsigned int d_d2_filter_map = 0;
+    // 帧图中阴影pass取出的第一次模糊的临时渲染目标，为0时（帧图之外的调用）直接从池中借用
+    unsigned int momentsBlurScratch = 0;
+    // 静态物体阴影缓存的帧缓冲对象
+    unsigned int staticShadowFBO = 0;
+    // 静态物体阴影缓存的深度贴图数组
+    unsigned int staticShadowDepthArray = 0;
+    // 静态物体阴影缓存的均值和方差贴图数组（VSM）
+    unsigned int staticShadowMeanVarArray = 0;
+    // 静态物体阴影缓存对应的光空间矩阵（每个定向光的每个级联）
+    vector<glm::mat4> staticShadowLightSpaceMatrices;
+    // 静态物体阴影缓存是否有效（每个定向光的每个级联）
+    vector<bool> staticShadowValid;
+    // 上一帧每个定向光每个级联的光空间矩阵，失效的级联与上一帧相同（不再移动）时才重建静态阴影缓存
+    vector<glm::mat4> previousLightSpaceMatrices;
+    // 每个级联在视空间中的远平面距离
+    vector<float> cascadeSplits;
+    // 场景包围盒（世界空间）
+    glm::vec3 sceneBoundsMin = glm::vec3(0.0f);
+    glm::vec3 sceneBoundsMax = glm::vec3(0.0f);
+    // 场景中是否存在动态物体
+    bool hasDynamicObjects = false;
+    // 每个定向光阴影更新的GPU耗时（逐光源渲染时使用）
+    vector<GpuTimer> shadowUpdateTimers;
+    // 每个定向光阴影更新的CPU耗时累计（ms）（逐光源渲染时使用）
+    vector<double> shadowUpdateCpuMs;
+    // 单次提交渲染所有定向光阴影的GPU耗时
+    GpuTimer shadowSinglePassTimer;
+    // 单次提交渲染所有定向光阴影的CPU耗时累计（ms）
+    double shadowSinglePassCpuMs = 0.0;
+    // 每个定向光静态阴影缓存的重建次数
+    vector<unsigned int> staticShadowRebuilds;
+    // 每个定向光因为级联还在移动而跳过静态阴影缓存的级联数
+    vector<unsigned int> staticShadowBypasses;
+    // 阴影统计的帧计数
+    unsigned int shadowStatsFrame = 0;
 
     // 模型信息
     vector<ModelInfo> modelInfos;
+    // 主线程模拟使用的定向光方向（只在主线程访问）
+    vector<glm::vec3> simulationLightDirections;
+    // 主线程模拟使用的模型变换（只在主线程访问，渲染线程使用快照中的副本）
+    vector<Transform> simulationTransforms;
     // 定向光数量
     int numDirectionalLights;
     // 点光源数组
     vector<PointLight> pointLights;
+    // 配置文件中的点光源（退出压力测试场景时恢复）
+    vector<PointLight> configPointLights;
+    // 是否使用点光源压力测试场景
+    bool pointLightStressTest = false;
+    // 上一次更新点光源动画的时间（s）
+    float lastPointLightTime = 0.0f;
+    // 点光源的分簇剔除
+    LightClusters lightClusters;
+    // 分簇光照统计的帧计数
+    unsigned int clusterStatsFrame = 0;
+    // 作业系统利用率统计的帧计数
+    unsigned int jobStatsFrame = 0;
+    // 分簇光照统计期间分配光源的CPU耗时累计（ms）
+    double clusterCpuMs = 0.0;
+    // 当前每个级联阴影贴图的分辨率（动态阴影分辨率时可能是SHADOW_WIDTH/SHADOW_HEIGHT的一半）
+    unsigned int shadowWidth = SHADOW_WIDTH;
+    unsigned int shadowHeight = SHADOW_HEIGHT;
+    // 内部渲染目标（颜色可以线性过滤，深度在放大时写回默认帧缓冲），大小与窗口的帧缓冲相同
+    // 颜色和深度是从临时渲染目标池中取出的，这里只记录当前绑定到帧缓冲的纹理
+    unsigned int sceneFBO = 0;
+    unsigned int sceneColorTexture = 0;
+    unsigned int sceneDepthTexture = 0;
+    int sceneTargetWidth = 0;
+    int sceneTargetHeight = 0;
+    // 本帧的渲染分辨率（每帧按窗口帧缓冲的大小更新）
+    int renderWidth = 0;
+    int renderHeight = 0;
+    // 按帧时间调整渲染分辨率的控制器
+    DynamicResolution resolutionController;
+    // 整帧的GPU耗时（时间戳查询，可以包含其他GpuTimer计时的区间）
+    GpuTimestampTimer frameTimer;
+    // 放大到窗口的着色器
+    Shader upscaleShader;
+    // 动态分辨率统计的帧计数
+    unsigned int resolutionStatsFrame = 0;
+    // 临时渲染目标池（内部渲染目标、G-buffer、矩的模糊中间结果），帧图和帧图之外的对比函数共用
+    TransientTexturePool renderTargetPool = TransientTexturePool(TRANSIENT_TARGET_IDLE_FRAMES);
+    // 每帧声明的渲染pass，临时资源从上面的池中取出
+    FrameGraph frameGraph = FrameGraph(&this->renderTargetPool);
+    // 帧图统计的帧计数
+    unsigned int frameGraphStatsFrame = 0;
+    // 统计期间渲染分辨率缩放的累计
+    double resolutionScaleSum = 0.0;
+    // 固定的渲染分辨率缩放比例，大于0时代替动态分辨率控制器
+    float fixedResolutionScale = 0.0f;
+    // 是否使用深度预pass
+    bool depthPrepass = DEPTH_PREPASS;
+    // 是否显示overdraw（每个像素着色的片段数量，暗红 -> 红 -> 黄 -> 白），运行时按F12切换
+    bool overdrawView = false;
+    // 深度预pass着色器（与场景着色器的顶点变换完全相同）
+    Shader depthPrepassShader;
+    // overdraw可视化着色器（加法混合输出固定颜色）
+    Shader overdrawShader;
+    // 统计有几何体覆盖的像素的着色器（全屏四边形，只做深度测试）
+    Shader coveredPixelsShader;
+    // 主pass着色的片段数量
+    SampleCounter shadedFragmentCounter;
+    // 有几何体覆盖的像素数量
+    SampleCounter coveredPixelCounter;
+    // overdraw统计的帧计数
+    unsigned int overdrawStatsFrame = 0;
+    // 点光源立方体阴影渲染着色器（几何着色器一次输出到6个面）
+    Shader pointShadowShader;
+    // 点光源阴影的帧缓冲对象
+    unsigned int pointShadowFBO = 0;
+    // 点光源立方体阴影贴图数组，第s个槽位占用第6s~6s+5层
+    unsigned int pointShadowArray = 0;
+    // 每个阴影槽位对应的点光源序号，-1表示空闲
+    vector<int> pointShadowSlotLights;
+    // 每个阴影槽位是否已经渲染过（没有渲染过的槽位不能被采样）
+    vector<bool> pointShadowSlotValid;
+    // 每个阴影槽位上次渲染时光源的位置
+    vector<glm::vec3> pointShadowSlotPositions;
+    // 每个阴影槽位上次渲染的帧
+    vector<unsigned int> pointShadowSlotFrames;
+    // 点光源阴影的帧计数
+    unsigned int pointShadowFrame = 0;
+    // 点光源阴影更新的GPU耗时（每帧一个样本，只在有更新的帧计时）
+    GpuTimer pointShadowTimer;
+    // 点光源阴影统计期间的CPU耗时累计（ms）、更新次数和帧数
+    double pointShadowCpuMs = 0.0;
+    unsigned int pointShadowUpdates = 0;
+    unsigned int pointShadowStatsFrame = 0;
 
     // 屏幕的渲染数据
     GLuint quadVAO = 0;
     GLuint quadVBO = 0;
 
     // 光照贴图
-    unsigned int lightMap;
+    unsigned int lightMap = 0;
     // 顶点数据
     vector<vertex_t> vertices;
     // 索引数据
     vector<unsigned int> indices;
 
-    /// @brief 加载场景配置文件 
-    /// @param fileName 文件名
-    /// @return 模型信息
-    vector<ModelInfo> loadScene(const std::string& fileName);
     /// @brief 加载方向光配置文件
     /// @param fileName 文件名
     /// @return 返回方向光信息
@@ -160,17 +498,186 @@ private:
     vector<PointLight> loadPointLights(const std::string& fileName);
     /// @brief 加载定向光深度贴图
     void loadDirectionLightDepthMap();
+    /// @brief 释放定向光深度贴图及相关的帧缓冲对象
+    void releaseDirectionLightDepthMap();
+    /// @brief 按当前阴影算法创建分层阴影着色器
+    void loadLayeredShadowShader();
+    /// @brief 切换阴影算法，VSM与其他算法之间切换时重新创建阴影渲染目标
+    /// @param algorithm 阴影算法类型
+    void setShadowAlgorithm(unsigned int algorithm);
+    /// @brief 创建一个定向光阴影渲染目标（深度贴图数组，每层一个光源的一个级联，VSM时还包括均值和方差贴图数组）
+    /// @param label 显存统计中使用的名称
+    /// @param fbo 帧缓冲对象
+    /// @param depthMap 深度贴图数组
+    /// @param meanVarMap 均值和方差贴图数组，只在VSM时创建
+    /// @param layers 层数
+    /// @param mipmapped 均值和方差贴图数组是否带有完整的mipmap（VSM使用mipmap过滤时场景着色器直接采样渲染目标）
+    void createDirectionLightShadowTarget(const char* label, unsigned int& fbo, unsigned int& depthMap, unsigned int& meanVarMap, int layers, bool mipmapped = false);
+    /// @brief 把阴影贴图数组的某一层绑定到帧缓冲对象上
+    /// @param target GL_FRAMEBUFFER/GL_READ_FRAMEBUFFER/GL_DRAW_FRAMEBUFFER
+    /// @param fbo 帧缓冲对象
+    /// @param depthMap 深度贴图数组
+    /// @param meanVarMap 均值和方差贴图数组，只在VSM时使用
+    /// @param layer 层序号（光源序号 * CASCADE_COUNT + 级联序号），-1表示绑定整个数组（分层渲染）
+    void bindDirectionLightShadowLayer(GLenum target, unsigned int fbo, unsigned int depthMap, unsigned int meanVarMap, int layer);
+    /// @brief 根据摄像机视锥体和场景包围盒计算每个定向光每个级联的光空间矩阵
+    void updateCascades();
+    /// @brief 清空当前绑定的阴影渲染目标
+    void clearDirectionLightShadowTarget();
+    /// @brief 过滤本帧有更新的层的VSM矩（生成mipmap或者两次模糊）
+    void filterShadowMoments();
+    /// @brief 获取场景着色器采样的VSM矩贴图数组（mipmap过滤时是渲染目标本身，模糊过滤时是第二次模糊的结果）
+    unsigned int getShadowMomentsArray() const;
+    /// @brief 获取实际使用的EVSM指数，0表示普通VSM
+    float getVSMExponent() const;
+    /// @brief 获取实际使用的ESM指数
+    float getESMExponent() const;
+    /// @brief 当前阴影算法是否使用可过滤的矩贴图（VSM/ESM/MSM）
+    bool usesShadowMoments() const;
+    /// @brief 获取当前阴影算法的矩贴图格式
+    GLenum getShadowMomentsFormat() const;
+    /// @brief 获取当前阴影算法的矩贴图每个纹素的字节数
+    size_t getShadowMomentsBytes() const;
+    /// @brief 获取深度为1（没有遮挡物）时的矩，用于清空矩贴图和设置边框颜色
+    glm::vec4 getShadowMomentsClearValue() const;
+    /// @brief 获取输出矩的阴影渲染着色器的宏定义（EVSM/ESM的指数，MSM的量化方式）
+    vector<string> getShadowCasterDefines() const;
+    /// @brief 输出VSM/ESM/MSM每个定向光的显存占用
+    void reportShadowMemory() const;
+    /// @brief 对定向光的均值和方差贴图数组的某一层做两次模糊（VSM）
+    /// @param layer 层序号（光源序号 * CASCADE_COUNT + 级联序号）
+    /// @param scratch 第一次模糊的临时渲染目标
+    void filterDirectionLightMeanVar(int layer, unsigned int scratch);
+    /// @brief 获取第一次模糊的临时渲染目标的描述（与矩贴图数组的大小、层数和格式相同）
+    FrameGraphTextureDesc getMomentsBlurDesc() const;
+    /// @brief 逐个光源逐个级联渲染阴影贴图
+    /// @param casterShader 阴影渲染着色器
+    void renderShadowLayersPerLight(Shader& casterShader);
+    /// @brief 在一次几何提交中渲染所有定向光的所有级联（实例化分层渲染）
+    void renderShadowLayersSinglePass();
+    /// @brief 设置分层阴影着色器每一层的光空间矩阵
+    /// @param matrices 每一层的光空间矩阵
+    void setLayeredShadowMatrices(const vector<glm::mat4>& matrices);
+    /// @brief 对比逐光源渲染和单次提交渲染在1、2、4个定向光时的阴影渲染开销并输出（--compare shadow-passes）
+    void benchmarkShadowPasses();
+    /// @brief 使静态物体的阴影缓存失效
+    void invalidateStaticShadows();
+    /// @brief 输出阴影更新开销（逐光源渲染时按光源输出）
+    void reportShadowStats();
     /// @brief 加载光照贴图
     void loadLightMap();
     void renderSceneToDepthMap();
+    /// @brief 切换点光源压力测试场景（在场景包围盒内随机生成STRESS_POINT_LIGHT_COUNT个绕场景中心旋转的点光源）
+    /// @param enabled 是否使用压力测试场景
+    void setPointLightStressTest(bool enabled);
+    /// @brief 在场景包围盒内随机生成压力测试的点光源（固定的随机种子，每次生成的光源相同）
+    /// @param count 点光源数量
+    /// @return 点光源
+    vector<PointLight> generateStressPointLights(unsigned int count);
+    /// @brief 用1到N个线程运行分簇和光照贴图后处理，输出耗时、加速比和每个线程的利用率（--compare jobs）
+    void benchmarkJobSystem();
+    /// @brief 输出作业系统每个线程的利用率并清空统计
+    /// @param jobs 作业系统
+    /// @param label 输出的前缀
+    void reportJobStats(JobSystem& jobs, const char* label);
+    /// @brief 更新点光源动画（压力测试场景的点光源绕场景中心旋转），每帧只调用一次
+    void animatePointLights();
+    /// @brief 把点光源转换为分簇使用的数据（颜色乘上光的颜色，计算影响范围）
+    /// @param pointLight 点光源
+    LightClusters::Light getClusterLight(const PointLight& pointLight);
+    /// @brief 把点光源分配到簇中并上传，每帧只调用一次
+    void updateLightClusters();
+    /// @brief 创建点光源立方体阴影贴图数组（MAX_SHADOWED_POINT_LIGHTS个槽位，每个槽位6层）
+    void createPointShadowMaps();
+    /// @brief 选择最重要的点光源分配阴影槽位，在预算内更新其中最需要更新的点光源的立方体阴影贴图
+    void renderPointLightShadows();
     /// @brief 设置场景的统一变量
-    void setupSceneUniform();
+    /// @param shader 场景着色器（通用版本或者某个特化变体）
+    void setupSceneUniform(Shader& shader);
+    /// @brief 获取与网格无关的光照相关的宏定义（阴影算法、光源数量等），前向渲染和延迟渲染的光照pass共用
+    vector<string> getLightingShaderDefines();
+    /// @brief 获取网格对应的场景着色器变体的宏定义
+    /// @param mesh 网格
+    vector<string> getSceneShaderDefines(const Mesh& mesh);
+    /// @brief 使用特化的着色器变体渲染场景，每个网格选择对应的变体
+    void renderScenePermutations();
+    /// @brief 对比当前阴影算法下通用着色器和特化变体的场景渲染开销并输出（--compare shaders）
+    void benchmarkSceneShaders();
+    /// @brief 对比PCF和硬件PCF的GPU耗时和画面差异并输出，差异图保存为pcf_compare.tga（--compare pcf）
+    void comparePCFModes();
+    /// @brief 对比所有阴影算法的阴影渲染、过滤和主pass的GPU耗时并输出（--compare shadow-algorithms）
+    void compareShadowAlgorithms();
+    /// @brief 创建最小/最大深度层级（第一次构建时创建，不使用PCSS分层遮挡物搜索时不占用显存）
+    void createShadowMinMaxPyramid();
+    /// @brief 从阴影贴图数组构建最小/最大深度层级
+    void buildShadowMinMaxPyramid();
+    /// @brief 对比PCSS使用分层遮挡物搜索前后每个片段的平均采样次数和GPU耗时并输出（--compare pcss）
+    void comparePCSSModes();
+    /// @brief 获取G-buffer四个纹理（漫反射颜色、镜面反射颜色、法线和光泽度、深度）的描述
+    /// @param width 宽度
+    /// @param height 高度
+    /// @param descs 输出的四个描述
+    void getGBufferDescs(int width, int height, FrameGraphTextureDesc descs[4]) const;
+    /// @brief 把四个纹理绑定到G-buffer帧缓冲（第一次调用时创建帧缓冲）
+    /// @param textures 漫反射颜色、镜面反射颜色、法线和光泽度、深度
+    /// @param width 纹理的宽度
+    /// @param height 纹理的高度
+    void attachGBuffer(const unsigned int textures[4], int width, int height);
+    /// @brief 延迟渲染的几何pass：绑定G-buffer帧缓冲，只写表面属性，不计算光照和阴影
+    /// @param width 视口宽度（G-buffer只使用左下角的区域）
+    /// @param height 视口高度
+    void renderGBufferPass(int width, int height);
+    /// @brief 延迟渲染的光照pass：读取G-buffer，对每个有几何体的像素计算一次光照和阴影，输出到当前绑定的帧缓冲和视口
+    void renderDeferredLighting();
+    /// @brief 延迟渲染（帧图之外的对比使用）：从池中借用与当前视口一样大的G-buffer，几何pass之后用光照pass渲染到当前绑定的帧缓冲
+    void renderDeferredPass();
+    /// @brief 对比前向渲染和延迟渲染在1080p和4K时的GPU耗时并输出（--compare render-paths）
+    void compareRenderPaths();
+    /// @brief 渲染主pass（延迟渲染，或者按USE_SHADER_PERMUTATIONS选择通用着色器或特化变体的前向渲染，前向渲染时可以先渲染深度预pass）
+    void renderMainPass();
+    /// @brief 声明本帧的渲染pass（阴影、点光源阴影、G-buffer、主pass、放大），剔除没有用的pass之后执行，并定期输出临时渲染目标的显存统计
+    /// @param windowWidth 窗口帧缓冲的宽度
+    /// @param windowHeight 窗口帧缓冲的高度
+    void renderFrameGraph(int windowWidth, int windowHeight);
+    /// @brief 把颜色和深度纹理绑定到内部渲染目标的帧缓冲（第一次调用时创建帧缓冲）
+    void attachSceneTargets(unsigned int colorTexture, unsigned int depthTexture);
+    /// @brief 按上一帧可用的GPU帧时间更新渲染分辨率（以及可选的阴影贴图分辨率），并定期输出统计
+    /// @param windowWidth 窗口帧缓冲的宽度
+    /// @param windowHeight 窗口帧缓冲的高度
+    void updateRenderResolution(int windowWidth, int windowHeight);
+    /// @brief 把内部渲染目标的有效区域放大到默认帧缓冲（双线性过滤+锐化），同时写回深度
+    /// @param windowWidth 窗口帧缓冲的宽度
+    /// @param windowHeight 窗口帧缓冲的高度
+    /// @param colorTexture 内部渲染目标的颜色
+    /// @param depthTexture 内部渲染目标的深度
+    void upscaleToWindow(int windowWidth, int windowHeight, unsigned int colorTexture, unsigned int depthTexture);
+    /// @brief 渲染深度预pass，之后深度测试为GL_EQUAL且不写深度，直到调用endDepthPrepass
+    void renderDepthPrepass();
+    /// @brief 恢复默认的深度测试（GL_LESS）和深度写入
+    void endDepthPrepass();
+    /// @brief 代替主pass显示overdraw：每个着色的片段叠加一次颜色（与主pass使用相同的深度预pass设置）
+    void renderOverdraw();
+    /// @brief 统计有几何体覆盖的像素数量，并定期输出主pass着色的片段数量与像素数量的对比
+    void reportOverdrawStats();
+    /// @brief 处理渲染相关的按键：F2切换阴影算法，F6切换VSM/ESM/MSM的过滤方式，F8切换延迟渲染，F10切换点光源压力测试场景，F11切换深度预pass，F12切换overdraw显示
+    void processInputShadowOptions();
     /// @brief 渲染场景
     /// @param shader 使用的着色器
     /// @param isActiveTexture 是否激活纹理，一般是开启的，在渲染深度贴图时不开启（也就是从光源的视角渲染场景时
-    void renderScene(Shader& shader, bool isActiveTexture);
-    /// @brief 处理输入，移动定向光
-    void processInputMoveDirLight();
+    /// @param filter 渲染哪些物体
+    void renderScene(Shader& shader, bool isActiveTexture, RenderFilter filter = RenderFilter::All);
+    /// @brief 渲染阴影投射者，只使用位置数据流，不绑定纹理和材质
+    /// @param shader 使用的着色器（只需要model和lightSpaceMatrix）
+    /// @param filter 渲染哪些物体
+    /// @param instanceCount 实例数量（分层渲染时等于层数），0表示不使用实例化绘制
+    void renderShadowCasters(Shader& shader, RenderFilter filter, int instanceCount = 0);
+    /// @brief 获取当前阴影算法使用的阴影渲染着色器
+    Shader& getShadowCasterShader();
+    /// @brief 从当前快照更新定向光方向和所有模型的变换矩阵，每帧只调用一次，所有渲染pass共用结果
+    void updateTransforms();
+    /// @brief 处理输入，移动定向光（主线程，修改模拟用的方向）
+    /// @param frame 本帧的快照（读取其中的按键状态）
+    void processInputMoveDirLight(const FrameSnapshot& frame);
     /// @brief 渲染整个屏幕，一般用于图像后期处理
     void renderQuad();
     /// @brief 光照贴图烘培函数
@@ -0,0 +1,489 @@
+#include "Scene.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include "lightmapper.h"
+#include "ParallelImage.h"
+
+// 场景的对比测试：每项连续渲染数百帧并输出对比结果，只在离屏基准测试中运行（--compare），不会阻塞交互运行的渲染线程
+
+bool Scene::runComparison(const std::string& name) {
+    struct Comparison {
+        const char* name;
+        void (Scene::*run)();
+    };
+    static const Comparison comparisons[] = {
+        { "shadow-passes", &Scene::benchmarkShadowPasses },
+        { "shaders", &Scene::benchmarkSceneShaders },
+        { "pcf", &Scene::comparePCFModes },
+        { "pcss", &Scene::comparePCSSModes },
+        { "shadow-algorithms", &Scene::compareShadowAlgorithms },
+        { "render-paths", &Scene::compareRenderPaths },
+        { "jobs", &Scene::benchmarkJobSystem },
+    };
+    for (const Comparison& comparison : comparisons) {
+        if (name == comparison.name) {
+            (this->*comparison.run)();
+            return true;
+        }
+    }
+    cout << "[compare] unknown comparison " << name << ", available:";
+    for (const Comparison& comparison : comparisons) {
+        cout << " " << comparison.name;
+    }
+    cout << endl;
+    return false;
+}
+
+void Scene::benchmarkShadowPasses() {
+    if (this->numDirectionalLights == 0) {
+        return;
+    }
+    // 每种配置重复渲染的次数
+    const int ITERATIONS = 100;
+    const int lightCounts[3] = { 1, 2, 4 };
+    Shader& casterShader = getShadowCasterShader();
+
+    cout << "[shadow benchmark] " << this->shadowWidth << "x" << this->shadowHeight << ", " << CASCADE_COUNT << " cascades, "
+        << ITERATIONS << " iterations, layered path: " << (this->vertexShaderLayer ? "vertex shader gl_Layer" : "geometry shader") << endl;
+
+    glCullFace(GL_FRONT);
+    glViewport(0, 0, this->shadowWidth, this->shadowHeight);
+    if (!usesShadowMoments()) {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    }
+    for (int lightCount : lightCounts) {
+        int layers = lightCount * CASCADE_COUNT;
+        // 临时渲染目标，光源不够时循环使用已配置的光源方向
+        unsigned int fbo = 0, depthMap = 0, meanVarMap = 0;
+        createDirectionLightShadowTarget("shadow benchmark", fbo, depthMap, meanVarMap, layers);
+        vector<glm::mat4> matrices(layers);
+        for (int i = 0; i < lightCount; ++i) {
+            for (unsigned int c = 0; c < CASCADE_COUNT; ++c) {
+                matrices[i * CASCADE_COUNT + c] = this->directionalLights[i % this->numDirectionalLights].lightSpaceMatrices[c];
+            }
+        }
+
+        // 逐光源逐级联渲染
+        GpuTimer loopTimer;
+        glFinish();
+        auto cpuStart = std::chrono::high_resolution_clock::now();
+        for (int it = 0; it < ITERATIONS; ++it) {
+            loopTimer.begin();
+            for (int layer = 0; layer < layers; ++layer) {
+                bindDirectionLightShadowLayer(GL_FRAMEBUFFER, fbo, depthMap, meanVarMap, layer);
+                clearDirectionLightShadowTarget();
+                casterShader.use();
+                casterShader.setMat4("lightSpaceMatrix", matrices[layer]);
+                renderShadowCasters(casterShader, RenderFilter::All);
+            }
+            loopTimer.end();
+        }
+        glFinish();
+        double loopCpuMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - cpuStart).count() / ITERATIONS;
+        cout << "[shadow benchmark] " << lightCount << " light(s), per-light loop: gpu " << loopTimer.getAverageMs() << " ms"
+            << ", cpu+sync " << loopCpuMs << " ms, " << layers << " submissions" << endl;
+        loopTimer.release();
+
+        // 单次提交分层渲染
+        if (layers <= (int)MAX_SHADOW_LAYERS) {
+            GpuTimer singlePassTimer;
+            glFinish();
+            cpuStart = std::chrono::high_resolution_clock::now();
+            for (int it = 0; it < ITERATIONS; ++it) {
+                singlePassTimer.begin();
+                setLayeredShadowMatrices(matrices);
+                bindDirectionLightShadowLayer(GL_FRAMEBUFFER, fbo, depthMap, meanVarMap, -1);
+                clearDirectionLightShadowTarget();
+                renderShadowCasters(this->layeredShadowShader, RenderFilter::All, layers);
+                singlePassTimer.end();
+            }
+            glFinish();
+            double singlePassCpuMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - cpuStart).count() / ITERATIONS;
+            cout << "[shadow benchmark] " << lightCount << " light(s), single pass:    gpu " << singlePassTimer.getAverageMs() << " ms"
+                << ", cpu+sync " << singlePassCpuMs << " ms, 1 submission" << endl;
+            singlePassTimer.release();
+        }
+        else {
+            cout << "[shadow benchmark] " << lightCount << " light(s), single pass skipped: " << layers << " layers exceed MAX_SHADOW_LAYERS" << endl;
+        }
+
+        GpuResources::deleteFramebuffer(fbo);
+        GpuResources::deleteTexture(depthMap);
+        GpuResources::deleteTexture(meanVarMap);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glCullFace(GL_BACK);
+}
+
+void Scene::benchmarkSceneShaders() {
+    // 重复渲染的次数
+    const int ITERATIONS = 100;
+    // 渲染到默认帧缓冲，使用窗口帧缓冲的实际大小，结束时恢复调用前的视口
+    ViewportScope viewportScope;
+    int width = this->window->getFramebufferWidth(), height = this->window->getFramebufferHeight();
+    glViewport(0, 0, width, height);
+
+    // 通用着色器：所有特性都是运行时分支
+    GpuTimer uberTimer;
+    for (int it = 0; it < ITERATIONS; ++it) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        uberTimer.begin();
+        this->shader.use();
+        this->shader.setBool("useLightMap", BAKE);
+        setupSceneUniform(this->shader);
+        renderScene(this->shader, true);
+        uberTimer.end();
+    }
+    glFinish();
+
+    // 特化变体（先渲染一次，保证变体已经编译，不把编译时间计入）
+    renderScenePermutations();
+    GpuTimer variantTimer;
+    for (int it = 0; it < ITERATIONS; ++it) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        variantTimer.begin();
+        renderScenePermutations();
+        variantTimer.end();
+    }
+    glFinish();
+
+    cout << "[shader benchmark] " << SHADOW_ALGORITHM_NAMES[this->shadowAlgorithm] << ", " << width << "x" << height
+        << ", " << ITERATIONS << " iterations: uber-shader gpu " << uberTimer.getAverageMs() << " ms"
+        << ", specialized variants gpu " << variantTimer.getAverageMs() << " ms"
+        << " (" << this->sceneShaders.size() << " variants compiled)" << endl;
+    uberTimer.release();
+    variantTimer.release();
+}
+
+void Scene::comparePCFModes() {
+    // 重复渲染的次数
+    const int ITERATIONS = 100;
+    const unsigned int modes[2] = { 1, 4 };
+    // 渲染到默认帧缓冲并读回画面，使用窗口帧缓冲的实际大小，结束时恢复调用前的视口
+    ViewportScope viewportScope;
+    int width = this->window->getFramebufferWidth(), height = this->window->getFramebufferHeight();
+    vector<unsigned char> images[2];
+    float gpuMs[2] = { 0.0f, 0.0f };
+
+    // 两种模式共用当前帧的深度贴图数组，VSM时深度附件同样是最新的
+    unsigned int savedAlgorithm = this->shadowAlgorithm;
+    glViewport(0, 0, width, height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    for (int m = 0; m < 2; ++m) {
+        this->shadowAlgorithm = modes[m];
+        // 先渲染一次，保证变体已经编译
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderMainPass();
+        GpuTimer timer;
+        for (int it = 0; it < ITERATIONS; ++it) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            timer.begin();
+            renderMainPass();
+            timer.end();
+        }
+        glFinish();
+        gpuMs[m] = timer.getAverageMs();
+        timer.release();
+        // 读取最后一次渲染的画面
+        images[m].resize(width * height * 3);
+        glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, images[m].data());
+    }
+    this->shadowAlgorithm = savedAlgorithm;
+
+    // 统计画面差异，并把PCF、硬件PCF和放大8倍的差异图并排保存
+    double sumDiff = 0.0;
+    int maxDiff = 0;
+    int changedPixels = 0;
+    vector<unsigned char> sideBySide(width * 3 * height * 3);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            int pixelMaxDiff = 0;
+            for (int c = 0; c < 3; ++c) {
+                int src = (y * width + x) * 3 + c;
+                int diff = std::abs((int)images[0][src] - (int)images[1][src]);
+                sumDiff += diff;
+                pixelMaxDiff = std::max(pixelMaxDiff, diff);
+                sideBySide[(y * width * 3 + x) * 3 + c] = images[0][src];
+                sideBySide[(y * width * 3 + width + x) * 3 + c] = images[1][src];
+                sideBySide[(y * width * 3 + width * 2 + x) * 3 + c] = (unsigned char)std::min(diff * 8, 255);
+            }
+            maxDiff = std::max(maxDiff, pixelMaxDiff);
+            // 任意通道相差超过8/255的像素认为有可见差异
+            if (pixelMaxDiff > 8) {
+                changedPixels++;
+            }
+        }
+    }
+    cout << "[pcf compare] " << ITERATIONS << " iterations, " << width << "x" << height
+        << ": PCF gpu " << gpuMs[0] << " ms (13x13 fetches)"
+        << ", hardware PCF gpu " << gpuMs[1] << " ms (" << HW_PCF_TAPS << " taps, " << (HW_PCF_PATTERN == 0 ? "poisson" : "rotated grid") << ")" << endl;
+    cout << "[pcf compare] image difference: mean " << sumDiff / (width * height * 3.0) << "/255, max " << maxDiff << "/255, "
+        << 100.0 * changedPixels / (width * height) << "% pixels differ by more than 8/255" << endl;
+    if (lmImageSaveTGAub("pcf_compare.tga", sideBySide.data(), width * 3, height, 3)) {
+        cout << "[pcf compare] saved pcf_compare.tga (PCF | hardware PCF | difference x8)" << endl;
+    }
+}
+
+void Scene::comparePCSSModes() {
+    // 重复渲染的次数
+    const int ITERATIONS = 100;
+    // 离屏渲染目标与窗口帧缓冲一样大，结束时恢复调用前的视口
+    ViewportScope viewportScope;
+    int width = this->window->getFramebufferWidth(), height = this->window->getFramebufferHeight();
+    unsigned int savedAlgorithm = this->shadowAlgorithm;
+    bool savedHierarchical = this->pcssHierarchical;
+    this->shadowAlgorithm = 2;
+
+    // 统计采样次数用的浮点渲染目标，避免8位颜色的精度损失
+    unsigned int fbo, colorTexture, depthRenderbuffer;
+    fbo = GpuResources::createFramebuffer("PCSS sample count", "Scene");
+    colorTexture = GpuResources::createTexture(GL_TEXTURE_2D, "PCSS sample count", "Scene");
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    depthRenderbuffer = GpuResources::createRenderbuffer("PCSS sample count depth", "Scene");
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+    }
+
+    const char* names[2] = { "PCSS", "PCSS (hierarchical)" };
+    vector<float> pixels(width * height * 4);
+    for (int m = 0; m < 2; ++m) {
+        this->pcssHierarchical = m == 1;
+        // 深度层级的构建开销单独统计
+        float pyramidMs = 0.0f;
+        if (this->pcssHierarchical) {
+            this->shadowMinMaxTimer.reset();
+            for (int it = 0; it < ITERATIONS; ++it) {
+                buildShadowMinMaxPyramid();
+            }
+            glFinish();
+            pyramidMs = this->shadowMinMaxTimer.getAverageMs();
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, width, height);
+        // 先渲染一次，保证变体已经编译
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderMainPass();
+        GpuTimer timer;
+        for (int it = 0; it < ITERATIONS; ++it) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            timer.begin();
+            renderMainPass();
+            timer.end();
+        }
+        glFinish();
+
+        // 用输出采样次数的变体再渲染一次，统计被着色像素的平均采样次数
+        double averageFetches = 0.0;
+        if (USE_SHADER_PERMUTATIONS) {
+            this->outputFetchCount = true;
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            renderMainPass();
+            this->outputFetchCount = false;
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_FLOAT, pixels.data());
+            double totalFetches = 0.0;
+            int shadedPixels = 0;
+            for (int k = 0; k < width * height; ++k) {
+                // alpha为1的是场景中的像素，背景为0
+                if (pixels[k * 4 + 3] > 0.5f) {
+                    totalFetches += pixels[k * 4];
+                    shadedPixels++;
+                }
+            }
+            averageFetches = shadedPixels > 0 ? totalFetches / shadedPixels : 0.0;
+        }
+
+        cout << "[pcss compare] " << names[m] << ": gpu " << timer.getAverageMs() << " ms";
+        if (this->pcssHierarchical) {
+            cout << " + min/max pyramid " << pyramidMs << " ms";
+        }
+        if (USE_SHADER_PERMUTATIONS) {
+            cout << ", " << averageFetches << " shadow fetches per shaded pixel (all lights)";
+        }
+        cout << endl;
+        timer.release();
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GpuResources::deleteFramebuffer(fbo);
+    GpuResources::deleteTexture(colorTexture);
+    GpuResources::deleteRenderbuffer(depthRenderbuffer);
+    this->shadowAlgorithm = savedAlgorithm;
+    this->pcssHierarchical = savedHierarchical;
+}
+
+void Scene::compareShadowAlgorithms() {
+    // 重复渲染的次数
+    const int ITERATIONS = 100;
+    // 主pass渲染到默认帧缓冲，使用窗口帧缓冲的实际大小，结束时恢复调用前的视口
+    ViewportScope viewportScope;
+    int width = this->window->getFramebufferWidth(), height = this->window->getFramebufferHeight();
+    unsigned int savedAlgorithm = this->shadowAlgorithm;
+    for (unsigned int algorithm = 0; algorithm < SHADOW_ALGORITHM_COUNT; ++algorithm) {
+        setShadowAlgorithm(algorithm);
+        // 清空阴影统计，避免循环中途输出并重置计时器
+        this->shadowStatsFrame = 0;
+        this->shadowSinglePassTimer.reset();
+        for (auto& timer : this->shadowUpdateTimers) {
+            timer.reset();
+        }
+        this->vsmFilterTimer.reset();
+        this->shadowMinMaxTimer.reset();
+        GpuTimer mainPassTimer;
+        for (int it = 0; it < ITERATIONS; ++it) {
+            // 每次都完整地重新渲染阴影贴图，不使用静态阴影缓存
+            invalidateStaticShadows();
+            renderSceneToDepthMap();
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, width, height);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            mainPassTimer.begin();
+            renderMainPass();
+            mainPassTimer.end();
+        }
+        glFinish();
+
+        // 阴影渲染的计时器在renderSceneToDepthMap内部，过滤和深度层级的构建在阴影渲染之后单独计时
+        float shadowMs = this->shadowSinglePassTimer.getAverageMs();
+        if (!this->shadowSinglePass) {
+            shadowMs = 0.0f;
+            for (const auto& timer : this->shadowUpdateTimers) {
+                shadowMs += timer.getAverageMs();
+            }
+        }
+        float filterMs = usesShadowMoments() ? this->vsmFilterTimer.getAverageMs() : 0.0f;
+        if (algorithm == 2 && this->pcssHierarchical) {
+            filterMs = this->shadowMinMaxTimer.getAverageMs();
+        }
+        float mainMs = mainPassTimer.getAverageMs();
+        cout << "[shadow algorithms] " << SHADOW_ALGORITHM_NAMES[algorithm] << ": shadow pass " << shadowMs << " ms"
+            << ", filter " << filterMs << " ms, main pass " << mainMs << " ms, total " << shadowMs + filterMs + mainMs << " ms" << endl;
+        mainPassTimer.release();
+    }
+    this->shadowStatsFrame = 0;
+    setShadowAlgorithm(savedAlgorithm);
+}
+
+void Scene::compareRenderPaths() {
+    // 结束时恢复调用前的视口
+    ViewportScope viewportScope;
+    // 重复渲染的次数
+    const int ITERATIONS = 100;
+    const int resolutions[2][2] = { { 1920, 1080 }, { 3840, 2160 } };
+    bool savedDeferred = this->deferredShading;
+    for (const auto& resolution : resolutions) {
+        int width = resolution[0], height = resolution[1];
+        // 与对比分辨率相同的离屏渲染目标（延迟渲染时G-buffer从池中借用）
+        unsigned int fbo, colorRenderbuffer, depthRenderbuffer;
+        fbo = GpuResources::createFramebuffer("render path comparison", "Scene");
+        colorRenderbuffer = GpuResources::createRenderbuffer("render path comparison color", "Scene");
+        glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        depthRenderbuffer = GpuResources::createRenderbuffer("render path comparison depth", "Scene");
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+        }
+
+        float ms[2] = { 0.0f, 0.0f };
+        for (int deferred = 0; deferred < 2; ++deferred) {
+            this->deferredShading = deferred == 1;
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            glViewport(0, 0, width, height);
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            // 先渲染一次，保证变体已经编译
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            renderMainPass();
+            GpuTimer timer;
+            for (int it = 0; it < ITERATIONS; ++it) {
+                glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                timer.begin();
+                renderMainPass();
+                timer.end();
+            }
+            glFinish();
+            ms[deferred] = timer.getAverageMs();
+            timer.release();
+        }
+        cout << "[render compare] " << width << "x" << height << ", " << SHADOW_ALGORITHM_NAMES[this->shadowAlgorithm]
+            << ": forward " << ms[0] << " ms, deferred " << ms[1] << " ms (g-buffer + lighting)" << endl;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GpuResources::deleteFramebuffer(fbo);
+        GpuResources::deleteRenderbuffer(colorRenderbuffer);
+        GpuResources::deleteRenderbuffer(depthRenderbuffer);
+    }
+    this->deferredShading = savedDeferred;
+}
+
+void Scene::benchmarkJobSystem() {
+    const int ITERATIONS = 20;
+    vector<PointLight> pointLights = generateStressPointLights(STRESS_POINT_LIGHT_COUNT);
+    vector<LightClusters::Light> lights(pointLights.size());
+    for (size_t i = 0; i < pointLights.size(); ++i) {
+        lights[i] = getClusterLight(pointLights[i]);
+    }
+    // 光照贴图后处理的图像：稀疏的非零像素，与烘焙结果类似
+    size_t pixels = (size_t)LIGHT_MAP_WIDTH * LIGHT_MAP_HEIGHT;
+    vector<float> image(pixels * 4, 0.0f), temp(pixels * 4, 0.0f);
+    std::mt19937 random(1037);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (size_t p = 0; p < pixels; ++p) {
+        if (unit(random) < 0.3f) {
+            for (int c = 0; c < 4; ++c) {
+                image[p * 4 + c] = unit(random);
+            }
+        }
+    }
+
+    int maxThreads = JobSystem::defaultWorkerCount() + 1;
+    double baselineClusterMs = 0.0, baselineImageMs = 0.0;
+    for (int threads = 1; threads <= maxThreads; ++threads) {
+        // 调用线程在等待时也会执行作业，threads个线程需要threads - 1个工作线程
+        JobSystem jobs(threads - 1);
+        LightClusters clusters(CLUSTER_X, CLUSTER_Y, CLUSTER_Z, MAX_LIGHTS_PER_CLUSTER, &jobs);
+        jobs.resetStats();
+        double clusterMs = 0.0;
+        for (int it = 0; it < ITERATIONS; ++it) {
+            clusters.update(lights, this->window->getViewMatrix(), this->window->getProjectionMatrix(), GLFWWindowFactory::CAMERA_NEAR, GLFWWindowFactory::CAMERA_FAR);
+            clusterMs += clusters.getLastCpuMs();
+        }
+        clusters.release();
+        clusterMs /= ITERATIONS;
+
+        auto imageStart = std::chrono::high_resolution_clock::now();
+        for (int it = 0; it < 4; ++it) {
+            parallelImageDilate(jobs, image.data(), temp.data(), LIGHT_MAP_WIDTH, LIGHT_MAP_HEIGHT, 4);
+            parallelImageSmooth(jobs, temp.data(), image.data(), LIGHT_MAP_WIDTH, LIGHT_MAP_HEIGHT, 4);
+        }
+        double imageMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - imageStart).count() / 4;
+
+        if (threads == 1) {
+            baselineClusterMs = clusterMs;
+            baselineImageMs = imageMs;
+        }
+        cout << "[job benchmark] " << threads << " threads: clusters (" << lights.size() << " lights) " << clusterMs << " ms (x"
+            << baselineClusterMs / std::max(clusterMs, 1e-6) << "), lightmap dilate+smooth " << LIGHT_MAP_WIDTH << "x" << LIGHT_MAP_HEIGHT << " "
+            << imageMs << " ms (x" << baselineImageMs / std::max(imageMs, 1e-6) << ")" << endl;
+        reportJobStats(jobs, "[job benchmark]  ");
+    }
+}
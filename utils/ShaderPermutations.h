@@ -0,0 +1,64 @@
+#ifndef SHADER_PERMUTATIONS_H
+#define SHADER_PERMUTATIONS_H
+
+// 定义了ShaderPermutations类，按宏定义集合按需编译同一组着色器源码的特化变体并缓存
+// 例如场景着色器按阴影算法、光源数量、材质贴图和光照贴图特化，避免每个片段都做运行时分支
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "shader.h"
+
+class ShaderPermutations {
+public:
+    ShaderPermutations() {}
+
+    /// @brief 构造函数
+    /// @param vertexPath 顶点着色器路径
+    /// @param fragmentPath 片段着色器路径
+    ShaderPermutations(const std::string& vertexPath, const std::string& fragmentPath) :
+        vertexPath(vertexPath), fragmentPath(fragmentPath) {}
+
+    /// @brief 获取一个变体，第一次使用时编译
+    /// @param defines 宏定义集合（例如"SHADOW_ALGORITHM 1"），与顺序无关
+    /// @return 变体着色器
+    Shader& get(const std::vector<std::string>& defines) {
+        std::vector<std::string> sorted = defines;
+        std::sort(sorted.begin(), sorted.end());
+        std::string key;
+        for (const auto& define : sorted) {
+            key += define + ";";
+        }
+        auto it = this->variants.find(key);
+        if (it != this->variants.end()) {
+            return it->second;
+        }
+        cout << "[shader] compiling " << this->fragmentPath << " variant: " << (key.empty() ? "<uber>" : key) << endl;
+        return this->variants.emplace(key, Shader(this->vertexPath.c_str(), this->fragmentPath.c_str(), nullptr, sorted)).first->second;
+    }
+
+    /// @brief 已经编译的变体数量
+    size_t size() const {
+        return this->variants.size();
+    }
+
+    /// @brief 删除所有已经编译的变体
+    void release() {
+        for (auto& variant : this->variants) {
+            glDeleteProgram(variant.second.ID);
+        }
+        this->variants.clear();
+    }
+
+private:
+    // 顶点着色器路径
+    std::string vertexPath;
+    // 片段着色器路径
+    std::string fragmentPath;
+    // 已经编译的变体，键为排序后的宏定义集合
+    std::map<std::string, Shader> variants;
+};
+
+#endif // SHADER_PERMUTATIONS_H
@@ -1,5 +1,6 @@
 #include "SkyBox.h"
 #include "stb_image.h"
+#include "RenderStats.h"
 
 // public
 
@@ -25,6 +26,7 @@ SkyBox::SkyBox(GLFWWindowFactory* window) : window(window) {
 /// @brief 绘制天空盒
 /// @param shader 天空盒着色器
 void SkyBox::draw() {
+    Profiler::Scope profileScope(this->window->getProfiler(), "SkyBox::draw");
     // 设置深度测试的比较函数
     // Gl_LEQUAL表示深度值小于或等于深度缓冲区值的像素能够通过深度测试
     glDepthFunc(GL_LEQUAL);
@@ -54,19 +56,27 @@ void SkyBox::draw() {
 
     // 绘制
     glDrawArrays(GL_TRIANGLES, 0, 36);
+    RenderStats::recordDraw(12);
     // 解绑VAO
     glBindVertexArray(0);
     // 将深度测试的比较函数设置回默认值
     glDepthFunc(GL_LESS);
 }
 
+/// @brief 释放纹理和渲染数据（在上下文销毁之前调用）
+void SkyBox::release() {
+    GpuResources::deleteTexture(this->textureID);
+    GpuResources::deleteVertexArray(this->VAO);
+    GpuResources::deleteBuffer(this->VBO);
+}
+
 // private
 
 /// @brief 加载纹理
 /// @param faces 纹理路径
 void SkyBox::loadTexture(vector<string> faces) {
     // 生成一个纹理
-    glGenTextures(1, &this->textureID);
+    this->textureID = GpuResources::createTexture(GL_TEXTURE_CUBE_MAP, "skybox", "SkyBox");
     // 在上下文中绑定该纹理
     glBindTexture(GL_TEXTURE_CUBE_MAP, this->textureID);
 
@@ -136,9 +146,9 @@ void SkyBox::setupVertices() {
     };
 
     // 生成VAO
-    glGenVertexArrays(1, &this->VAO);
+    this->VAO = GpuResources::createVertexArray("skybox cube", "SkyBox");
     // 生成VBO
-    glGenBuffers(1, &this->VBO);
+    this->VBO = GpuResources::createBuffer("skybox cube", "SkyBox");
     // 将VAO绑定到当前上下文
     glBindVertexArray(this->VAO);
     // 将VBO绑定到GL_ARRAY_BUFFER
@@ -4,6 +4,7 @@
 #include <glad/glad.h>
 #include "shader.h"
 #include "WindowFactory.h"
+#include "GpuResources.h"
 
 #include <vector>
 #include <string>
@@ -22,11 +23,14 @@ public:
     // 绘制天空盒
     void draw();
 
+    // 释放纹理和渲染数据
+    void release();
+
 private:
     // 渲染数据
-    unsigned int VAO, VBO;
+    unsigned int VAO = 0, VBO = 0;
     // 纹理ID
-    unsigned int textureID;
+    unsigned int textureID = 0;
     // 窗口指针
     GLFWWindowFactory* window;
     // 着色器
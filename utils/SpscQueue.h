@@ -0,0 +1,60 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+// 定义了SpscQueue类，固定容量的单生产者单消费者无锁队列
+// 只允许一个线程push、另一个线程pop，读写位置各自只由一个线程修改，通过acquire/release保证元素的可见性
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+template <typename T, size_t Capacity>
+class SpscQueue {
+public:
+    static_assert(Capacity > 0, "SpscQueue capacity must be positive");
+
+    SpscQueue() {}
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /// @brief 尝试放入一个元素（只能由生产者线程调用）
+    /// @param item 元素，只有成功时才会被移动
+    /// @return 队列已满时返回false
+    bool tryPush(T&& item) {
+        size_t tail = this->tail.load(std::memory_order_relaxed);
+        if (tail - this->head.load(std::memory_order_acquire) >= Capacity) {
+            return false;
+        }
+        this->items[tail % Capacity] = std::move(item);
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief 尝试取出一个元素（只能由消费者线程调用）
+    /// @param item 取出的元素
+    /// @return 队列为空时返回false
+    bool tryPop(T& item) {
+        size_t head = this->head.load(std::memory_order_relaxed);
+        if (head == this->tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(this->items[head % Capacity]);
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief 获取队列中的元素数量（另一个线程同时操作时只是近似值）
+    size_t size() const {
+        return this->tail.load(std::memory_order_acquire) - this->head.load(std::memory_order_acquire);
+    }
+
+private:
+    // 元素
+    T items[Capacity];
+    // 读位置（只由消费者修改），与写位置放在不同的缓存行，避免伪共享
+    alignas(64) std::atomic<size_t> head{ 0 };
+    // 写位置（只由生产者修改）
+    alignas(64) std::atomic<size_t> tail{ 0 };
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,127 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+// 定义了Transform组件，缓存模型的局部矩阵、世界矩阵和法线矩阵
+// 只有在属性被修改（脏标记）或者物体带有动画（自转）时才会重新计算矩阵
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <limits>
+
+class Transform {
+public:
+    Transform() {}
+
+    /// @brief 设置位置
+    void setPosition(const glm::vec3& position) {
+        this->position = position;
+        this->dirty = true;
+    }
+    /// @brief 设置静态旋转（欧拉角，单位：度）
+    void setRotation(const glm::vec3& rotation) {
+        this->rotation = rotation;
+        this->dirty = true;
+    }
+    /// @brief 设置缩放
+    void setScale(const glm::vec3& scale) {
+        this->scale = scale;
+        this->dirty = true;
+    }
+    /// @brief 设置绕z轴的倾斜角（单位：度），例如地球仪的23°26'
+    void setTilt(float tilt) {
+        this->tilt = tilt;
+        this->dirty = true;
+    }
+    /// @brief 设置绕y轴的自转速度（单位：度/秒），0表示静态物体
+    void setSpinSpeed(float spinSpeed) {
+        this->spinSpeed = spinSpeed;
+        this->dirty = true;
+    }
+
+    const glm::vec3& getPosition() const { return this->position; }
+    const glm::vec3& getRotation() const { return this->rotation; }
+    const glm::vec3& getScale() const { return this->scale; }
+    float getTilt() const { return this->tilt; }
+    float getSpinSpeed() const { return this->spinSpeed; }
+    /// @brief 是否是带动画的物体
+    bool isAnimated() const { return this->spinSpeed != 0.0f; }
+
+    /// @brief 更新矩阵，只有在脏标记或者带动画时才会重新计算
+    /// @param time 当前帧的时间（s），同一帧内所有渲染pass共用
+    /// @return 世界矩阵是否发生了变化
+    bool update(float time) {
+        if (!this->dirty && !this->isAnimated()) {
+            return false;
+        }
+
+        if (this->dirty) {
+            // 局部矩阵：平移 * 静态旋转 * 倾斜
+            this->localMatrix = glm::translate(glm::mat4(1.0f), this->position);
+            this->localMatrix = glm::rotate(this->localMatrix, glm::radians(this->rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+            this->localMatrix = glm::rotate(this->localMatrix, glm::radians(this->rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+            this->localMatrix = glm::rotate(this->localMatrix, glm::radians(this->rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+            this->localMatrix = glm::rotate(this->localMatrix, glm::radians(this->tilt), glm::vec3(0.0f, 0.0f, 1.0f));
+            this->dirty = false;
+        }
+
+        // 世界矩阵：局部矩阵 * 自转 * 缩放
+        glm::mat4 world = this->localMatrix;
+        if (this->isAnimated()) {
+            world = glm::rotate(world, glm::radians(time * this->spinSpeed), glm::vec3(0.0f, 1.0f, 0.0f));
+        }
+        world = glm::scale(world, this->scale);
+        this->worldMatrix = world;
+        // 法线矩阵在CPU端计算一次，避免在顶点着色器中对每个顶点求逆
+        this->normalMatrix = glm::mat3(glm::transpose(glm::inverse(world)));
+        return true;
+    }
+
+    /// @brief 获取局部矩阵（不含自转和缩放）
+    const glm::mat4& getLocalMatrix() const { return this->localMatrix; }
+    /// @brief 获取世界矩阵
+    const glm::mat4& getWorldMatrix() const { return this->worldMatrix; }
+    /// @brief 获取法线矩阵
+    const glm::mat3& getNormalMatrix() const { return this->normalMatrix; }
+
+    /// @brief 把模型空间的包围盒变换到世界空间（取8个顶点变换后的包围盒）
+    /// @param localMin 模型空间包围盒最小点
+    /// @param localMax 模型空间包围盒最大点
+    /// @param worldMin 输出世界空间包围盒最小点
+    /// @param worldMax 输出世界空间包围盒最大点
+    void getWorldBounds(const glm::vec3& localMin, const glm::vec3& localMax, glm::vec3& worldMin, glm::vec3& worldMax) const {
+        worldMin = glm::vec3(std::numeric_limits<float>::max());
+        worldMax = glm::vec3(std::numeric_limits<float>::lowest());
+        for (int k = 0; k < 8; ++k) {
+            glm::vec3 corner(
+                (k & 1) ? localMax.x : localMin.x,
+                (k & 2) ? localMax.y : localMin.y,
+                (k & 4) ? localMax.z : localMin.z);
+            glm::vec3 worldCorner = glm::vec3(this->worldMatrix * glm::vec4(corner, 1.0f));
+            worldMin = glm::min(worldMin, worldCorner);
+            worldMax = glm::max(worldMax, worldCorner);
+        }
+    }
+
+private:
+    // 位置
+    glm::vec3 position = glm::vec3(0.0f);
+    // 静态旋转（欧拉角，单位：度）
+    glm::vec3 rotation = glm::vec3(0.0f);
+    // 缩放
+    glm::vec3 scale = glm::vec3(1.0f);
+    // 绕z轴的倾斜角（单位：度）
+    float tilt = 0.0f;
+    // 绕y轴的自转速度（单位：度/秒）
+    float spinSpeed = 0.0f;
+    // 脏标记，属性被修改后置为true
+    bool dirty = true;
+
+    // 局部矩阵
+    glm::mat4 localMatrix = glm::mat4(1.0f);
+    // 世界矩阵
+    glm::mat4 worldMatrix = glm::mat4(1.0f);
+    // 法线矩阵
+    glm::mat3 normalMatrix = glm::mat3(1.0f);
+};
+
+#endif // TRANSFORM_H
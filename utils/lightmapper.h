@@ -98,6 +98,8 @@ void lmImageScale(float *image, int w, int h, int c, float factor, int m LM_DEFA
 void lmImagePower(float *image, int w, int h, int c, float exponent, int m LM_DEFAULT_VALUE(LM_ALL_CHANNELS));         // in-place powf(v, exponent) of the specified channels (for gamma)
 void lmImageDilate(const float *image, float *outImage, int w, int h, int c);                                          // widen the populated non-zero areas by 1 pixel.
 void lmImageSmooth(const float *image, float *outImage, int w, int h, int c);                                          // simple box filter on only the non-zero values.
+void lmImageDilateRows(const float *image, float *outImage, int w, int h, int c, int y0, int y1);                     // lmImageDilate restricted to output rows [y0..y1) (rows are independent, used to run it in parallel).
+void lmImageSmoothRows(const float *image, float *outImage, int w, int h, int c, int y0, int y1);                     // lmImageSmooth restricted to output rows [y0..y1).
 void lmImageDownsample(const float *image, float *outImage, int w, int h, int c);                                      // downsamples [0..w]x[0..h] to [0..w/2]x[0..h/2] by avereging only the non-zero values
 void lmImageFtoUB(const float *image, unsigned char *outImage, int w, int h, int c, float max LM_DEFAULT_VALUE(0.0f)); // casts a floating point image to an 8bit/channel image
 
@@ -1589,9 +1591,15 @@ void lmImagePower(float *image, int w, int h, int c, float exponent, int m)
 }
 
 void lmImageDilate(const float *image, float *outImage, int w, int h, int c)
+{
+	lmImageDilateRows(image, outImage, w, h, c, 0, h);
+}
+
+void lmImageDilateRows(const float *image, float *outImage, int w, int h, int c, int y0, int y1)
 {
 	assert(c > 0 && c <= 4);
-	for (int y = 0; y < h; y++)
+	assert(y0 >= 0 && y1 <= h);
+	for (int y = y0; y < y1; y++)
 	{
 		for (int x = 0; x < w; x++)
 		{
@@ -1642,9 +1650,15 @@ void lmImageDilate(const float *image, float *outImage, int w, int h, int c)
 }
 
 void lmImageSmooth(const float *image, float *outImage, int w, int h, int c)
+{
+	lmImageSmoothRows(image, outImage, w, h, c, 0, h);
+}
+
+void lmImageSmoothRows(const float *image, float *outImage, int w, int h, int c, int y0, int y1)
 {
 	assert(c > 0 && c <= 4);
-	for (int y = 0; y < h; y++)
+	assert(y0 >= 0 && y1 <= h);
+	for (int y = y0; y < y1; y++)
 	{
 		for (int x = 0; x < w; x++)
 		{
@@ -8,6 +8,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 
 using std::string;
 using std::ifstream;
@@ -20,18 +21,22 @@ public:
     // 默认构造函数
     Shader() {}
     // 着色器程序ID
-    unsigned int ID;
+    unsigned int ID = 0;
 
-    // 构造函数
-    Shader(const char* vertexPath, const char* fragmentPath) {
+    // 构造函数，geometryPath为空时不使用几何着色器
+    // defines中的每一项（例如"SHADOW_ALGORITHM 1"）会以#define的形式插入到每个着色器的#version之后，用来编译特化的变体
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const std::vector<string>& defines = {}) {
         string vertexCode;
         string fragmentCode;
+        string geometryCode;
         ifstream vShaderFile;
         ifstream fShaderFile;
+        ifstream gShaderFile;
 
         // 确保ifstream对象可以抛出异常
         vShaderFile.exceptions(ifstream::failbit | ifstream::badbit);
         fShaderFile.exceptions(ifstream::failbit | ifstream::badbit);
+        gShaderFile.exceptions(ifstream::failbit | ifstream::badbit);
         try {
             // 打开文件
             vShaderFile.open(vertexPath);
@@ -44,15 +49,23 @@ public:
             vShaderFile.close();
             fShaderFile.close();
             // 将stream转换为字符串
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
+            vertexCode = injectDefines(vShaderStream.str(), defines);
+            fragmentCode = injectDefines(fShaderStream.str(), defines);
+            // 几何着色器
+            if (geometryPath != nullptr) {
+                gShaderFile.open(geometryPath);
+                stringstream gShaderStream;
+                gShaderStream << gShaderFile.rdbuf();
+                gShaderFile.close();
+                geometryCode = injectDefines(gShaderStream.str(), defines);
+            }
         } catch (ifstream::failure& e) {
             cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << endl;
         }
         const char* vShaderCode = vertexCode.c_str();
         const char* fShaderCode = fragmentCode.c_str();
         // 编译着色器
-        unsigned int vertex, fragment;
+        unsigned int vertex, fragment, geometry = 0;
         // 顶点着色器
         vertex = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(vertex, 1, &vShaderCode, NULL);
@@ -63,15 +76,29 @@ public:
         glShaderSource(fragment, 1, &fShaderCode, NULL);
         glCompileShader(fragment);
         checkCompileErrors(fragment, "FRAGMENT");
+        // 几何着色器
+        if (geometryPath != nullptr) {
+            const char* gShaderCode = geometryCode.c_str();
+            geometry = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(geometry, 1, &gShaderCode, NULL);
+            glCompileShader(geometry);
+            checkCompileErrors(geometry, "GEOMETRY");
+        }
         // 着色器程序
         ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
+        if (geometryPath != nullptr) {
+            glAttachShader(ID, geometry);
+        }
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
         // 删除着色器
         glDeleteShader(vertex);
         glDeleteShader(fragment);
+        if (geometryPath != nullptr) {
+            glDeleteShader(geometry);
+        }
     }
 
     // 激活着色器
@@ -139,6 +166,30 @@ public:
     }
 
 private:
+    // 在#version之后插入宏定义，并用#line恢复原来的行号，保证编译错误的行号和源文件一致
+    static string injectDefines(const string& code, const std::vector<string>& defines) {
+        if (defines.empty()) {
+            return code;
+        }
+        string header;
+        for (const auto& define : defines) {
+            header += "#define " + define + "\n";
+        }
+        size_t versionEnd = 0;
+        if (code.compare(0, 8, "#version") == 0) {
+            versionEnd = code.find('\n');
+            if (versionEnd == string::npos) {
+                return code + "\n" + header;
+            }
+            versionEnd++;
+            header += "#line 2\n";
+        }
+        else {
+            header += "#line 1\n";
+        }
+        return code.substr(0, versionEnd) + header + code.substr(versionEnd);
+    }
+
     // 检查着色器编译/链接错误
     void checkCompileErrors(GLuint shader, string type) {
         GLint success;
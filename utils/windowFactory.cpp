@@ -6,6 +6,11 @@ Camera GLFWWindowFactory::camera = Camera(glm::vec3(0.0f, 0.0f, 25.0f));
 float GLFWWindowFactory::lastX = GLFWWindowFactory::SCR_WIDTH / 2.0f;
 // 初始化鼠标的最后Y位置为屏幕高度的一半
 float GLFWWindowFactory::lastY = GLFWWindowFactory::SCR_HEIGHT / 2.0f;
+// 帧缓冲的大小，创建窗口后按实际大小更新
+int GLFWWindowFactory::framebufferWidth = GLFWWindowFactory::SCR_WIDTH;
+int GLFWWindowFactory::framebufferHeight = GLFWWindowFactory::SCR_HEIGHT;
+// 所有键的状态
+std::bitset<GLFW_KEY_LAST + 1> GLFWWindowFactory::keyStates;
 // 标记是否为第一次鼠标输入
 bool GLFWWindowFactory::firstMouse = true;
 // 初始化帧间隔时间
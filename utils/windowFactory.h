@@ -2,9 +2,29 @@
 #define WINDOW_FACTORY_H
 #include <glad/glad.h> // gald前面不能包含任何opengl头文件
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cstring>
+#include <bitset>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include "QuaternionCamera.h"
+#include "FramePacer.h"
+#include "FrameSnapshot.h"
+#include "GpuResources.h"
+#include "InputRecording.h"
+#include "Profiler.h"
+#include "SpscQueue.h"
+
+// 离屏（无窗口）运行使用EGL创建上下文，目前只在Linux上启用（Mesa的llvmpipe也可以运行）
+#if defined(__linux__) && !defined(TELLURION_NO_EGL)
+#define TELLURION_HAS_EGL 1
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 
 using std::cout;
 using std::endl;
@@ -50,9 +70,157 @@ public:
         glfwSetScrollCallback(this->window, scroll_callback);
         // 设置鼠标按钮的回调函数
         glfwSetMouseButtonCallback(this->window, mouse_button_callback);
+        // 设置键盘的回调函数（记录所有键的状态，复制到每帧的快照中）
+        glfwSetKeyCallback(this->window, key_callback);
         // 默认不捕获鼠标
         glfwSetInputMode(this->window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+        // 帧缓冲的实际大小（高DPI显示器上可能大于窗口大小）
+        glfwGetFramebufferSize(this->window, &framebufferWidth, &framebufferHeight);
+        // 帧节奏：同步方式、帧率上限和CPU领先GPU的帧数
+        this->framePacer = FramePacer(SWAP_MODE, FRAME_RATE_LIMIT, MAX_FRAMES_IN_FLIGHT);
+        // 每个渲染pass的CPU/GPU耗时，与帧时间统计同样的间隔输出
+        this->profiler = Profiler(PROFILER_REPORT ? FRAME_STATS_INTERVAL : 0);
+    }
+
+    /// @brief 不创建窗口，使用EGL的pbuffer创建离屏上下文（优先使用Mesa的surfaceless平台，不需要显示器）
+    /// @param width 离屏帧缓冲的宽度
+    /// @param height 离屏帧缓冲的高度
+    /// @return 是否创建成功
+    bool initHeadless(int width, int height) {
+#ifdef TELLURION_HAS_EGL
+        this->window = NULL;
+        // surfaceless平台不需要X11/Wayland，不支持时使用默认显示
+        const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (clientExtensions != NULL && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != NULL && getPlatformDisplay != NULL) {
+            this->eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        }
+        if (this->eglDisplay == EGL_NO_DISPLAY) {
+            this->eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+        if (this->eglDisplay == EGL_NO_DISPLAY || !eglInitialize(this->eglDisplay, NULL, NULL)) {
+            cout << "Failed to initialize EGL display" << endl;
+            return false;
+        }
+        const EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+            EGL_DEPTH_SIZE, 24,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint configCount = 0;
+        if (!eglChooseConfig(this->eglDisplay, configAttributes, &config, 1, &configCount) || configCount == 0) {
+            cout << "Failed to choose EGL config" << endl;
+            return false;
+        }
+        const EGLint surfaceAttributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+        this->eglSurface = eglCreatePbufferSurface(this->eglDisplay, config, surfaceAttributes);
+        // 与窗口模式相同：OpenGL 3.3核心模式
+        eglBindAPI(EGL_OPENGL_API);
+        const EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        this->eglContext = eglCreateContext(this->eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+        if (this->eglSurface == EGL_NO_SURFACE || this->eglContext == EGL_NO_CONTEXT
+            || !eglMakeCurrent(this->eglDisplay, this->eglSurface, this->eglSurface, this->eglContext)) {
+            cout << "Failed to create EGL context" << endl;
+            return false;
+        }
+        if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+            cout << "Failed to initialize GLAD" << endl;
+            return false;
+        }
+        framebufferWidth = width;
+        framebufferHeight = height;
+        glEnable(GL_DEPTH_TEST);
+        // 离屏时不交换缓冲区，不限制帧率也不插入栅栏；每个渲染pass的耗时照常统计
+        this->framePacer = FramePacer();
+        this->profiler = Profiler(PROFILER_REPORT ? FRAME_STATS_INTERVAL : 0);
+        return true;
+#else
+        cout << "Headless mode requires EGL, which is not available in this build" << endl;
+        return false;
+#endif
+    }
 
+    /// @brief 离屏运行一帧：按帧序号和固定的时间步长生成快照（没有输入），然后渲染
+    /// @param timeStep 每帧的时间步长（s）
+    /// @param simulateFunc 模拟函数
+    /// @param renderFunc 渲染函数
+    void runHeadlessFrame(float timeStep, const std::function<void(FrameSnapshot&)>& simulateFunc, const std::function<void()>& renderFunc) {
+        runHeadlessFrameAt(this->frameCount * timeStep, simulateFunc, renderFunc);
+    }
+
+    /// @brief 离屏运行一帧，动画使用给定的时间（回归测试在同一时刻渲染多帧，等待阴影缓存等稳定）
+    /// @param time 本帧的时间（s）
+    /// @param simulateFunc 模拟函数
+    /// @param renderFunc 渲染函数
+    void runHeadlessFrameAt(float time, const std::function<void(FrameSnapshot&)>& simulateFunc, const std::function<void()>& renderFunc) {
+        this->deltaTime = time - this->lastFrame;
+        this->lastFrame = time;
+        this->frame.keys.reset();
+        applyInputReplay(this->frame);
+        fillSnapshot(this->frame, time);
+        recordInput(this->frame);
+        simulateFunc(this->frame);
+        renderFrame(renderFunc);
+    }
+
+    /// @brief 设置摄像机的姿态（只能在主线程或者离屏运行时调用）
+    /// @param position 位置
+    /// @param front 前方向
+    /// @param up 上方向
+    /// @param zoom 视野（度）
+    void setCameraPose(const glm::vec3& position, const glm::vec3& front, const glm::vec3& up, float zoom) {
+        camera.Position = position;
+        camera.Front = glm::normalize(front);
+        camera.Up = glm::normalize(up);
+        camera.Right = glm::normalize(glm::cross(camera.Front, camera.Up));
+        camera.Zoom = zoom;
+    }
+
+    /// @brief 开始把每帧的摄像机姿态和按键状态录制到文件，程序结束时写完
+    /// @param path 录制文件
+    /// @return 是否成功打开文件
+    bool startInputRecording(const std::string& path) {
+        return this->inputRecorder.open(path);
+    }
+
+    /// @brief 回放录制的输入：摄像机姿态和按键状态使用录制的数据，时间按固定的步长REPLAY_TIME_STEP前进，回放结束后关闭窗口
+    /// @param path 录制文件
+    /// @return 是否读取成功
+    bool startInputReplay(const std::string& path) {
+        return this->inputReplay.open(path);
+    }
+
+    /// @brief 是否已经回放完录制的所有帧（没有回放时为false）
+    bool isInputReplayFinished() const {
+        return this->inputReplay.isActive() && this->inputReplay.isFinished();
+    }
+
+    /// @brief 释放离屏上下文
+    void releaseHeadless() {
+#ifdef TELLURION_HAS_EGL
+        if (this->eglDisplay != EGL_NO_DISPLAY) {
+            this->profiler.release();
+            eglMakeCurrent(this->eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (this->eglContext != EGL_NO_CONTEXT) {
+                eglDestroyContext(this->eglDisplay, this->eglContext);
+            }
+            if (this->eglSurface != EGL_NO_SURFACE) {
+                eglDestroySurface(this->eglDisplay, this->eglSurface);
+            }
+            eglTerminate(this->eglDisplay);
+            this->eglDisplay = EGL_NO_DISPLAY;
+            this->eglContext = EGL_NO_CONTEXT;
+            this->eglSurface = EGL_NO_SURFACE;
+        }
+#endif
     }
 
     // 获取窗口对象
@@ -60,52 +228,108 @@ public:
         return this->window;
     }
 
-    // 运行窗口，传入一个自定义的更新函数
-    void run(std::function<void()> updateFunc) {
+    // 运行窗口，传入模拟函数（主线程，把模拟结果写入快照）和渲染函数（拥有上下文的线程，只读取当前快照）
+    // 释放函数在窗口关闭之后、销毁上下文之前调用，用于释放场景的OpenGL对象，之后输出没有释放的对象
+    void run(std::function<void(FrameSnapshot&)> simulateFunc, std::function<void()> renderFunc, std::function<void()> releaseFunc = nullptr) {
         // 启用深度测试，opengl将在绘制每个像素之前比较其深度值，以确定该像素是否应该被绘制
         glEnable(GL_DEPTH_TEST);
 
-        // 循环渲染
-        while (!glfwWindowShouldClose(this->window)) { // 检查是否应该关闭窗口
-            // 清空屏幕所用的颜色
-            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-            // 清空颜色缓冲，主要目的是为每一帧的渲染准备一个干净的画布
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-            float currentFrame = glfwGetTime();
-            this->deltaTime = currentFrame - this->lastFrame;
-            this->lastFrame = currentFrame;
-            this->timeElapsed += this->deltaTime;
-            this->frameCount++;
-
-            // 处理输入
-            GLFWWindowFactory::process_input(this->window);
-
-            // 初始化投影矩阵和视图矩阵
-            this->projection =
-                glm::perspective(glm::radians(camera.Zoom),
-                    (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 1000.0f);
-            this->view = this->camera.GetViewMatrix();
-
-            // 执行更新函数
-            updateFunc();
+        if (!RENDER_THREAD) {
+            // 循环渲染
+            while (!glfwWindowShouldClose(this->window)) { // 检查是否应该关闭窗口
+                // 等待GPU追上以及帧率上限，之后再处理事件和采样时间，让这一帧使用尽量新的输入
+                this->framePacer.beginFrame();
+                // 处理所有待处理事件，去poll所有事件，看看哪个没处理的
+                glfwPollEvents();
+                simulateFrame(simulateFunc, this->frame);
+                renderFrame(renderFunc);
+            }
+        }
+        else {
+            // 上下文交给渲染线程，主线程只处理事件、输入和模拟
+            glfwMakeContextCurrent(NULL);
+            bool running = true;
+            // 渲染线程每完成一次帧节奏控制的等待就允许主线程生成一份快照，其余的额度让模拟最多领先渲染FRAME_QUEUE_SIZE帧
+            // 额度和队列中的快照总数不超过队列容量，主线程放入快照时队列不会满
+            this->frameRequests = FRAME_QUEUE_SIZE - 1;
+            std::thread renderThread([&]() {
+                glfwMakeContextCurrent(this->window);
+                while (true) {
+                    // 等待GPU追上以及帧率上限，之后才通知主线程处理事件和采样输入，让这一帧使用尽量新的输入
+                    this->framePacer.beginFrame();
+                    std::unique_lock<std::mutex> lock(this->frameMutex);
+                    this->frameRequests++;
+                    this->frameRequested.notify_one();
+                    // 等待主线程的下一份快照
+                    this->frameQueued.wait(lock, [&]() { return this->frameQueue.size() > 0 || !running; });
+                    if (!this->frameQueue.tryPop(this->frame)) {
+                        break;
+                    }
+                    lock.unlock();
+                    renderFrame(renderFunc);
+                }
+                this->framePacer.release();
+                this->profiler.release();
+                glfwMakeContextCurrent(NULL);
+                });
 
-            // 交换缓冲区
-            glfwSwapBuffers(this->window);
-            // 处理所有待处理事件，去poll所有事件，看看哪个没处理的
-            glfwPollEvents();
+            while (!glfwWindowShouldClose(this->window)) {
+                {
+                    std::unique_lock<std::mutex> lock(this->frameMutex);
+                    this->frameRequested.wait(lock, [&]() { return this->frameRequests > 0; });
+                    this->frameRequests--;
+                }
+                glfwPollEvents();
+                FrameSnapshot snapshot;
+                simulateFrame(simulateFunc, snapshot);
+                {
+                    std::lock_guard<std::mutex> lock(this->frameMutex);
+                    this->frameQueue.tryPush(std::move(snapshot));
+                }
+                this->frameQueued.notify_one();
+            }
+            {
+                std::lock_guard<std::mutex> lock(this->frameMutex);
+                running = false;
+            }
+            this->frameQueued.notify_one();
+            renderThread.join();
+            glfwMakeContextCurrent(this->window);
         }
 
+        this->inputRecorder.close();
+        this->framePacer.release();
+        this->profiler.release();
+        // 此时上下文在主线程中
+        if (releaseFunc) {
+            releaseFunc();
+        }
+        GpuResources::reportLeaks();
         // 终止GLFW，清理GLFW分配的资源
         glfwTerminate();
     }
 
     // 窗口大小改变的回调函数
     static void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-        // 确保视口与新窗口尺寸匹配，注意在视网膜显示器上，宽度和高度会显著大于指定值
-        glViewport(0, 0, width, height);
+        // 记录帧缓冲大小，投影矩阵和场景的渲染目标按这个大小更新（视口由渲染函数每帧设置，这里可能没有当前上下文）
+        framebufferWidth = width;
+        framebufferHeight = height;
     }
 
+    // 键盘的回调函数
+    static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+        if (key < 0 || key > GLFW_KEY_LAST) {
+            return;
+        }
+        if (action == GLFW_PRESS) {
+            keyStates.set(key);
+        }
+        else if (action == GLFW_RELEASE) {
+            keyStates.reset(key);
+        }
+    }
+
+
     // 鼠标移动的回调函数
     static void mouse_callback(GLFWwindow* window, double xposIn, double yposIn) {
         float xpos = static_cast<float>(xposIn);
@@ -189,35 +413,246 @@ public:
         }
     }
 
-    // 获取投影矩阵
+    // 获取投影矩阵（当前渲染的快照）
     const glm::mat4 getProjectionMatrix() {
-        return this->projection;
+        return this->frame.projection;
     }
 
-    // 获取视图矩阵
+    // 获取视图矩阵（当前渲染的快照）
     glm::mat4 getViewMatrix() {
-        return this->view;
+        return this->frame.view;
+    }
+
+    // 获取摄像机位置（当前渲染的快照）
+    glm::vec3 getCameraPosition() {
+        return this->frame.cameraPosition;
+    }
+
+    // 获取摄像机视野（度，当前渲染的快照）
+    float getCameraZoom() {
+        return this->frame.cameraZoom;
+    }
+
+    // 是否使用Blinn-Phong（当前渲染的快照）
+    bool isBlinn() {
+        return this->frame.blinn;
+    }
+
+    // 获取帧缓冲的宽度（当前渲染的快照）
+    int getFramebufferWidth() {
+        return this->frame.framebufferWidth;
+    }
+
+    // 获取帧缓冲的高度（当前渲染的快照）
+    int getFramebufferHeight() {
+        return this->frame.framebufferHeight;
+    }
+
+    // 某个键在当前渲染的快照中是否按下
+    bool isKeyPressed(int key) {
+        return key >= 0 && key <= GLFW_KEY_LAST && this->frame.keys.test(key);
+    }
+
+    // 某个键是否在当前渲染的快照中刚刚按下（上一份快照中没有按下），按住不放时只触发一次
+    bool wasKeyJustPressed(int key) {
+        return isKeyPressed(key) && !this->frame.previousKeys.test(key);
+    }
+
+    // 获取性能分析器（只能在拥有上下文的线程使用）
+    Profiler& getProfiler() {
+        return this->profiler;
+    }
+
+    // 获取当前渲染的快照
+    const FrameSnapshot& getFrame() {
+        return this->frame;
+    }
+
+    // 获取帧节奏控制（帧时间统计）
+    FramePacer& getFramePacer() {
+        return this->framePacer;
+    }
+
+    // 获取当前帧的时间（s），每帧只在主线程采样一次并写入快照，保证同一帧内所有渲染pass使用相同的时间
+    float getFrameTime() {
+        return this->frame.frameTime;
     }
 
 public:
-    // 投影矩阵
-    glm::mat4 projection;
-    // 视图矩阵
-    glm::mat4 view;
-    // 摄像机
+    // 摄像机（只能在主线程访问，渲染时使用快照中的数据）
     static Camera camera;
     // 屏幕宽度
     static const unsigned int SCR_WIDTH = 800;
     // 屏幕高度
     static const unsigned int SCR_HEIGHT = 600;
-    // 窗口对象
-    GLFWwindow* window;
+    // 帧缓冲的当前宽度和高度（窗口大小改变时更新，最小化时为0）
+    static int framebufferWidth;
+    static int framebufferHeight;
+    // 交换缓冲区的同步方式：SWAP_IMMEDIATE、SWAP_VSYNC或SWAP_ADAPTIVE（不支持时回退到垂直同步）
+    static const FramePacer::SwapMode SWAP_MODE = FramePacer::SWAP_VSYNC;
+    // 帧率上限，0为不限制（与垂直同步同时使用时取两者中较低的帧率）
+    static constexpr float FRAME_RATE_LIMIT = 0.0f;
+    // 允许CPU领先GPU的帧数，越小输入延迟越低，但CPU和GPU的并行越少，0为不限制（由驱动决定）
+    static const int MAX_FRAMES_IN_FLIGHT = 2;
+    // 帧时间统计的输出间隔（帧）
+    static const unsigned int FRAME_STATS_INTERVAL = 300;
+    // 固定的时间步长（s），大于0时动画按帧序号驱动（可复现），0为使用实际时间
+    static constexpr float FIXED_TIME_STEP = 0.0f;
+    // 回放录制的输入时每帧的时间步长（s）
+    static constexpr float REPLAY_TIME_STEP = 1.0f / 60.0f;
+    // 是否定期输出每个渲染pass的CPU/GPU耗时
+    static const bool PROFILER_REPORT = true;
+    // 是否使用独立的渲染线程：主线程处理事件、输入和模拟并生成快照，渲染线程拥有上下文并提交渲染命令
+    static const bool RENDER_THREAD = true;
+    // 快照队列的容量，即模拟最多领先渲染的帧数（越大越能吸收模拟的波动，但输入延迟越高）
+    static const size_t FRAME_QUEUE_SIZE = 1;
+    // 摄像机近平面
+    static constexpr float CAMERA_NEAR = 0.1f;
+    // 摄像机远平面
+    static constexpr float CAMERA_FAR = 1000.0f;
+    // 窗口对象（离屏运行时为NULL）
+    GLFWwindow* window = NULL;
 private:
+    /// @brief 在主线程生成一帧的快照：采样时间、处理输入、更新摄像机，然后执行模拟函数
+    void simulateFrame(const std::function<void(FrameSnapshot&)>& simulateFunc, FrameSnapshot& snapshot) {
+        // 固定时间步长（或者回放录制的输入）时动画由帧序号驱动，每次运行的结果相同
+        float timeStep = this->inputReplay.isActive() ? REPLAY_TIME_STEP : FIXED_TIME_STEP;
+        float currentFrame = timeStep > 0.0f ? this->frameCount * timeStep : (float)glfwGetTime();
+        this->deltaTime = currentFrame - this->lastFrame;
+        this->lastFrame = currentFrame;
+        this->timeElapsed += this->deltaTime;
+
+        // 处理输入
+        GLFWWindowFactory::process_input(this->window);
+
+        snapshot.keys = keyStates;
+        // 回放时用录制的摄像机姿态和按键代替实际输入，全部回放完之后关闭窗口
+        if (this->inputReplay.isActive() && this->inputReplay.isFinished()) {
+            glfwSetWindowShouldClose(this->window, true);
+        }
+        applyInputReplay(snapshot);
+        fillSnapshot(snapshot, currentFrame);
+        recordInput(snapshot);
+
+        // 执行模拟函数
+        simulateFunc(snapshot);
+    }
+
+    /// @brief 回放时把下一帧录制的摄像机姿态、着色模式和按键写入摄像机和快照
+    void applyInputReplay(FrameSnapshot& snapshot) {
+        InputFrame input;
+        if (!this->inputReplay.next(input)) {
+            return;
+        }
+        setCameraPose(input.position, input.front, input.up, input.zoom);
+        blinn = input.blinn;
+        snapshot.keys = input.keys;
+    }
+
+    /// @brief 录制时把摄像机姿态、着色模式和快照中的按键写入文件
+    void recordInput(const FrameSnapshot& snapshot) {
+        if (!this->inputRecorder.isRecording()) {
+            return;
+        }
+        InputFrame input;
+        input.position = camera.Position;
+        input.front = camera.Front;
+        input.up = camera.Up;
+        input.zoom = camera.Zoom;
+        input.blinn = blinn;
+        input.keys = snapshot.keys;
+        this->inputRecorder.record(input, this->deltaTime);
+    }
+
+    /// @brief 把时间、摄像机和窗口大小写入快照
+    void fillSnapshot(FrameSnapshot& snapshot, float currentFrame) {
+        snapshot.frameIndex = this->frameCount++;
+        snapshot.frameTime = currentFrame;
+        snapshot.deltaTime = this->deltaTime;
+        // 投影矩阵和视图矩阵
+        snapshot.projection =
+            glm::perspective(glm::radians(camera.Zoom),
+                (float)framebufferWidth / (float)std::max(framebufferHeight, 1), CAMERA_NEAR, CAMERA_FAR);
+        snapshot.view = this->camera.GetViewMatrix();
+        snapshot.cameraPosition = this->camera.Position;
+        snapshot.cameraZoom = this->camera.Zoom;
+        snapshot.blinn = blinn;
+        snapshot.framebufferWidth = framebufferWidth;
+        snapshot.framebufferHeight = framebufferHeight;
+        // 按键的边沿检测以上一份生成的快照为准（回放时为上一帧录制的按键）
+        snapshot.previousKeys = this->lastKeys;
+        this->lastKeys = snapshot.keys;
+    }
+
+    /// @brief 在拥有上下文的线程渲染当前快照并交换缓冲区
+    void renderFrame(const std::function<void()>& renderFunc) {
+        // 清空屏幕所用的颜色
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        // 清空颜色缓冲，主要目的是为每一帧的渲染准备一个干净的画布
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        this->profiler.beginFrame();
+        // 执行渲染函数
+        renderFunc();
+
+        // 交换缓冲区（只统计CPU阻塞的时间），离屏时pbuffer没有后缓冲，只提交命令
+        {
+            Profiler::Scope scope(this->profiler, "swap buffers", false);
+            if (this->window != NULL) {
+                glfwSwapBuffers(this->window);
+            }
+            else {
+                glFlush();
+            }
+        }
+        this->profiler.endFrame();
+        // 标记这一帧的命令，限制同时在GPU上的帧数
+        this->framePacer.endFrame();
+
+        // 定期输出帧时间统计
+        if (this->framePacer.getSampleCount() >= FRAME_STATS_INTERVAL) {
+            cout << "[frame pacing] swap mode " << this->framePacer.getSwapMode() << ", limit " << this->framePacer.getFrameRateLimit()
+                << " fps, frames in flight " << this->framePacer.getMaxFramesInFlight() << ": frame average " << this->framePacer.getAverageFrameMs()
+                << " ms, p99 " << this->framePacer.getPercentileFrameMs(0.99f) << " ms, max " << this->framePacer.getMaxFrameMs()
+                << " ms, fence wait " << this->framePacer.getAverageFenceWaitMs() << " ms, limiter wait " << this->framePacer.getAverageLimiterWaitMs()
+                << " ms" << endl;
+            this->framePacer.reset();
+        }
+    }
+
+    // 帧节奏控制
+    FramePacer framePacer;
+    // 每个渲染pass的CPU/GPU耗时
+    Profiler profiler;
+    // 当前渲染的快照（单线程时每帧直接写入，多线程时由渲染线程从队列中取出）
+    FrameSnapshot frame;
+    // 主线程到渲染线程的快照队列
+    SpscQueue<FrameSnapshot, FRAME_QUEUE_SIZE> frameQueue;
+    // 保护快照队列的等待和主线程生成快照的额度
+    std::mutex frameMutex;
+    // 渲染线程允许主线程生成下一份快照
+    std::condition_variable frameRequested;
+    // 主线程放入了一份快照
+    std::condition_variable frameQueued;
+    // 主线程还可以生成的快照数量
+    size_t frameRequests = 0;
+    // 输入的录制和回放（只在主线程使用）
+    InputRecorder inputRecorder;
+    InputReplay inputReplay;
+#ifdef TELLURION_HAS_EGL
+    // 离屏运行时的EGL对象
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    EGLSurface eglSurface = EGL_NO_SURFACE;
+    EGLContext eglContext = EGL_NO_CONTEXT;
+#endif
+
+    // 上一份快照中按下的键（只在主线程使用）
+    std::bitset<GLFW_KEY_LAST + 1> lastKeys;
 
     // 经过的时间
-    float timeElapsed;
+    float timeElapsed = 0.0f;
     // 帧计数
-    int frameCount;
+    unsigned long long frameCount = 0;
 
     // 上一次鼠标的X坐标
     static float lastX;
@@ -225,6 +660,8 @@ private:
     static float lastY;
     // 是否第一次鼠标移动
     static bool firstMouse;
+    // 所有键当前是否按下（主线程的键盘回调更新）
+    static std::bitset<GLFW_KEY_LAST + 1> keyStates;
 
     // 时间间隔
     static float deltaTime;